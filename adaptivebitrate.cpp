@@ -0,0 +1,124 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "adaptivebitrate.h"
+
+
+const int AdaptiveBitrate::LEVEL_KILOBITS[AdaptiveBitrate::LEVEL_COUNT] = { 0, 320, 192, 128, 96, 64 };
+
+
+AdaptiveBitrate::AdaptiveBitrate()
+{
+}
+
+
+AdaptiveBitrate *AdaptiveBitrate::instance()
+{
+    static AdaptiveBitrate adaptiveBitrate;
+    return &adaptiveBitrate;
+}
+
+
+bool AdaptiveBitrate::isEnabled()
+{
+    QSettings settings;
+    return settings.value("options/adaptive_bitrate", DEFAULT_ADAPTIVE_BITRATE).toBool();
+}
+
+
+// original's bitrate is learned from its downloads, until then it's assumed to be as much as lossless
+double AdaptiveBitrate::levelByteRate(Server server, int level)
+{
+    if (level == 0) {
+        return server.originalByteRate > 0 ? server.originalByteRate : ORIGINAL_BYTE_RATE;
+    }
+    return LEVEL_KILOBITS[level] * 125.0;
+}
+
+
+// called when a download is finished, one slow download steps down, a few fast ones step up
+void AdaptiveBitrate::reportThroughput(QString serverId, double bytesPerSecond, double streamBytesPerSecond, bool original)
+{
+    if (serverId.isEmpty() || (bytesPerSecond <= 0)) {
+        return;
+    }
+
+    mutex.lock();
+
+    Server server = servers.value(serverId, { bytesPerSecond, 0, 0, 0 });
+
+    server.throughput = server.throughput * (1.0 - RATE_SMOOTHING) + bytesPerSecond * RATE_SMOOTHING;
+    if (original && (streamBytesPerSecond > 0)) {
+        server.originalByteRate = streamBytesPerSecond;
+    }
+
+    if ((server.level < LEVEL_COUNT - 1) && (server.throughput < levelByteRate(server, server.level) * DOWNGRADE_MARGIN)) {
+        server.level++;
+        server.goodReports = 0;
+    }
+    else if ((server.level > 0) && (server.throughput > levelByteRate(server, server.level - 1) * UPGRADE_MARGIN)) {
+        server.goodReports++;
+        if (server.goodReports >= UPGRADE_REPORTS) {
+            server.level--;
+            server.goodReports = 0;
+        }
+    }
+    else {
+        server.goodReports = 0;
+    }
+
+    servers.insert(serverId, server);
+
+    mutex.unlock();
+}
+
+
+// playback ran out of data, the next track is requested at a lower bitrate
+void AdaptiveBitrate::reportUnderrun(QString serverId)
+{
+    if (serverId.isEmpty()) {
+        return;
+    }
+
+    mutex.lock();
+
+    Server server = servers.value(serverId, { 0, 0, 0, 0 });
+
+    server.level       = qMin(server.level + 1, LEVEL_COUNT - 1);
+    server.goodReports = 0;
+
+    servers.insert(serverId, server);
+
+    mutex.unlock();
+}
+
+
+QUrl AdaptiveBitrate::variantUrl(QString serverId, QUrl url)
+{
+    if (serverId.isEmpty() || url.isLocalFile() || !isEnabled()) {
+        return url;
+    }
+
+    mutex.lock();
+    int level = servers.value(serverId, { 0, 0, 0, 0 }).level;
+    mutex.unlock();
+
+    if (level == 0) {
+        return url;
+    }
+
+    QUrlQuery query(url);
+    query.removeAllQueryItems("format");
+    query.removeAllQueryItems("bitrate");
+    query.addQueryItem("format", "mp3");
+    query.addQueryItem("bitrate", QString::number(LEVEL_KILOBITS[level]));
+
+    QUrl variant(url);
+    variant.setQuery(query);
+
+    return variant;
+}
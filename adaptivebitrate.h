@@ -0,0 +1,65 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef ADAPTIVEBITRATE_H
+#define ADAPTIVEBITRATE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSettings>
+#include <QString>
+#include <QtGlobal>
+#include <QUrl>
+#include <QUrlQuery>
+
+#include "globals.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// chooses Ampache stream parameters per server from the throughput measured on earlier downloads
+class AdaptiveBitrate
+{
+    public:
+
+        static AdaptiveBitrate *instance();
+
+        bool isEnabled();
+        QUrl variantUrl(QString serverId, QUrl url);
+        void reportThroughput(QString serverId, double bytesPerSecond, double streamBytesPerSecond, bool original);
+        void reportUnderrun(QString serverId);
+
+
+    private:
+
+        // level zero is the stream as the server returned it, the rest are transcoded to these kilobits per second
+        static const     int    LEVEL_COUNT        = 6;
+        static const     int    LEVEL_KILOBITS[LEVEL_COUNT];
+        static constexpr double ORIGINAL_BYTE_RATE = 176400.0;
+        static constexpr double RATE_SMOOTHING     = 0.5;
+        static constexpr double DOWNGRADE_MARGIN   = 1.5;
+        static constexpr double UPGRADE_MARGIN     = 3.0;
+        static const     int    UPGRADE_REPORTS    = 3;
+
+        struct Server {
+            double throughput;
+            double originalByteRate;
+            int    level;
+            int    goodReports;
+        };
+
+        QMutex                 mutex;
+        QHash<QString, Server> servers;
+
+        AdaptiveBitrate();
+
+        double levelByteRate(Server server, int level);
+};
+
+#endif // ADAPTIVEBITRATE_H
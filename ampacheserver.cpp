@@ -25,7 +25,7 @@ AmpacheServer::AmpacheServer(QUrl host, QString user, QObject *parent) : QObject
 
     shuffled = 0;
 
-    connect(&networkAccessManager, &QNetworkAccessManager::finished, this, &AmpacheServer::networkFinished);
+    networkAccessManager = NetworkPool::instance()->manager();
 }
 
 
@@ -74,6 +74,7 @@ QNetworkRequest AmpacheServer::buildRequest(QUrlQuery query, QObject *extra)
     QNetworkRequest request(url);
     request.setRawHeader("User-Agent", QGuiApplication::instance()->applicationName().toUtf8());
     request.setOriginatingObject(extra);
+    NetworkPool::instance()->prepareRequest(&request);
 
     return request;
 }
@@ -277,6 +278,8 @@ void AmpacheServer::networkFinished(QNetworkReply *reply)
         "artist",
         "flag",
         "name",
+        "replaygain_album_gain",
+        "replaygain_track_gain",
         "tag",
         "genre",
         "summary",
@@ -721,7 +724,10 @@ void AmpacheServer::startHandshake()
     //query.addQueryItem("version", QString("%1").arg(SERVER_API_VERSION_MIN));
     query.addQueryItem("user", user);
 
-    networkAccessManager.get(buildRequest(query, nullptr));
+    QNetworkReply *reply = networkAccessManager->get(buildRequest(query, nullptr));
+    connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+        networkFinished(reply);
+    });
 }
 
 
@@ -1094,7 +1100,11 @@ void AmpacheServer::startOperations()
             query.addQueryItem("limit", "none");
         }
 
-        networkAccessManager.get(buildRequest(query, operation.extra));
+        // the manager is shared with the other servers, so replies are handled one by one
+        QNetworkReply *reply = networkAccessManager->get(buildRequest(query, operation.extra));
+        connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+            networkFinished(reply);
+        });
 
         opQueue.removeFirst();
 
@@ -38,6 +38,7 @@
 #endif
 
 #include "globals.h"
+#include "networkpool.h"
 #include "qt5keychain/keychain.h"
 
 
@@ -134,7 +135,7 @@ class AmpacheServer : public QObject
         WritePasswordJob *writeKeychainJob;
         ReadPasswordJob  *readKeychainJob;
 
-        QNetworkAccessManager networkAccessManager;
+        QNetworkAccessManager *networkAccessManager;
 
 
         QNetworkRequest buildRequest(QUrlQuery query, QObject *extra);
@@ -0,0 +1,125 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "analysiscache.h"
+
+
+AnalysisCache::AnalysisCache()
+{
+}
+
+
+AnalysisCache *AnalysisCache::instance()
+{
+    static AnalysisCache analysisCache;
+    return &analysisCache;
+}
+
+
+bool AnalysisCache::contains(QString key)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    mutex.lock();
+    bool exists = QFile::exists(filePath(key));
+    mutex.unlock();
+
+    return exists;
+}
+
+
+QString AnalysisCache::filePath(QString key)
+{
+    // mutex must be locked by caller
+
+    QString path = QString("%1/analysis").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+
+    QDir dir(path);
+    if (!dir.exists()) {
+        dir.mkpath(path);
+    }
+
+    return QString("%1/%2").arg(path, QString(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex()));
+}
+
+
+bool AnalysisCache::load(QString key, Analysis *analysis)
+{
+    if (key.isEmpty()) {
+        return false;
+    }
+
+    mutex.lock();
+
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::ReadOnly)) {
+        mutex.unlock();
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    quint32 magic;
+    quint32 version;
+    stream >> magic >> version;
+    if ((magic != FILE_MAGIC) || (version != FILE_VERSION)) {
+        file.close();
+        mutex.unlock();
+        return false;
+    }
+
+    qint32 silenceCount;
+    stream >> analysis->replayGain >> analysis->peak >> analysis->lengthMilliseconds >> silenceCount;
+
+    analysis->silences.clear();
+    for (int i = 0; (i < silenceCount) && (stream.status() == QDataStream::Ok); i++) {
+        qint32 type;
+        qint64 startMicroseconds;
+        qint64 endMicroseconds;
+        stream >> type >> startMicroseconds >> endMicroseconds;
+
+        analysis->silences.append({ static_cast<ReplayGainCalculator::SilenceType>(type), startMicroseconds, endMicroseconds });
+    }
+
+    bool success = stream.status() == QDataStream::Ok;
+
+    file.close();
+    mutex.unlock();
+
+    return success;
+}
+
+
+void AnalysisCache::store(QString key, Analysis analysis)
+{
+    if (key.isEmpty()) {
+        return;
+    }
+
+    mutex.lock();
+
+    QFile file(filePath(key));
+    if (!file.open(QIODevice::WriteOnly)) {
+        mutex.unlock();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_12);
+
+    stream << FILE_MAGIC << FILE_VERSION;
+    stream << analysis.replayGain << analysis.peak << analysis.lengthMilliseconds << static_cast<qint32>(analysis.silences.count());
+    foreach (ReplayGainCalculator::SilenceRange silence, analysis.silences) {
+        stream << static_cast<qint32>(silence.type) << silence.startMicroseconds << silence.endMicroseconds;
+    }
+
+    file.close();
+    mutex.unlock();
+}
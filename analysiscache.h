@@ -0,0 +1,59 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef ANALYSISCACHE_H
+#define ANALYSISCACHE_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QMutex>
+#include <QStandardPaths>
+#include <QString>
+#include <QtGlobal>
+
+#include "replaygaincalculator.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// results of finished analyses, so replay gain and silences are known before the next play begins
+class AnalysisCache
+{
+    public:
+
+        struct Analysis {
+            double                         replayGain;
+            double                         peak;
+            ReplayGainCalculator::Silences silences;
+            qint64                         lengthMilliseconds;
+        };
+
+        static AnalysisCache *instance();
+
+        bool contains(QString key);
+        bool load(QString key, Analysis *analysis);
+        void store(QString key, Analysis analysis);
+
+
+    private:
+
+        static const quint32 FILE_MAGIC   = 0x57414e41;
+        static const quint32 FILE_VERSION = 2;
+
+        QMutex mutex;
+
+        AnalysisCache();
+
+        QString filePath(QString key);
+};
+
+#endif // ANALYSISCACHE_H
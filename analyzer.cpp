@@ -12,9 +12,13 @@ Analyzer::Analyzer(QAudioFormat format, QObject *parent) : QObject(parent)
     this->format = format;
 
     decoderFinished      = false;
+    silenceOnly          = false;
+    engine               = ReplayGainEngine;
     resultLastCalculated = 0;
     replayGainFilter     = nullptr;
     replayGainCalculator = nullptr;
+    loudnessCalculator   = nullptr;
+    silenceScanner       = nullptr;
     sampleType           = IIRFilter::Unknown;
 }
 
@@ -27,6 +31,32 @@ Analyzer::~Analyzer()
     if (replayGainCalculator != nullptr) {
         delete replayGainCalculator;
     }
+    if (loudnessCalculator != nullptr) {
+        delete loudnessCalculator;
+    }
+    if (silenceScanner != nullptr) {
+        delete silenceScanner;
+    }
+}
+
+
+// merges the results of the next segment of the same track into this one, both must be done with their buffers
+void Analyzer::appendSegment(Analyzer *next)
+{
+    if (!isReady() || !next->isReady()) {
+        return;
+    }
+
+    if ((silenceScanner != nullptr) && (next->silenceScanner != nullptr)) {
+        silenceScanner->append(next->silenceScanner);
+    }
+
+    if ((replayGainCalculator != nullptr) && (next->replayGainCalculator != nullptr)) {
+        replayGainCalculator->append(next->replayGainCalculator);
+    }
+    if ((loudnessCalculator != nullptr) && (next->loudnessCalculator != nullptr)) {
+        loudnessCalculator->append(next->loudnessCalculator);
+    }
 }
 
 
@@ -35,13 +65,29 @@ void Analyzer::bufferAvailable()
     while (bufferQueue->count() > 0) {
         QAudioBuffer *buffer = bufferQueue->at(0);
 
-        if (replayGainFilter != nullptr) {
-            replayGainFilter->processPCMData(buffer->data(), buffer->byteCount(), sampleType, buffer->format().channelCount());
+        if (isReady()) {
+            if (silenceScanner != nullptr) {
+                silenceScanner->processPCMData(buffer->constData(), buffer->byteCount());
+            }
+
+            if (loudnessCalculator != nullptr) {
+                loudnessCalculator->processPCMData(buffer->constData(), buffer->byteCount());
+            }
+            else if (replayGainFilter != nullptr) {
+                replayGainFilter->processPCMData(buffer->data(), buffer->byteCount(), sampleType, buffer->format().channelCount());
+                replayGainCalculator->flushSilenceScanner();
+            }
 
             if ((!decoderFinished && (buffer->startTime() >= resultLastCalculated + REPLAY_GAIN_UPDATE_INTERVAL_MICROSECONDS)) || (decoderFinished && (bufferQueue->count() == 1))) {
                 resultLastCalculated = buffer->startTime();
-                emit replayGain(replayGainCalculator->calculateResult());
-                emit silences(replayGainCalculator->getSilences(decoderFinished));
+                if (!silenceOnly) {
+                    emit replayGain(calculateResult());
+                }
+
+                ReplayGainCalculator::Silences newSilences = getNewSilences(decoderFinished);
+                if (newSilences.count() > 0) {
+                    emit silences(newSilences);
+                }
             }
         }
 
@@ -54,15 +100,75 @@ void Analyzer::bufferAvailable()
 }
 
 
+double Analyzer::calculateResult()
+{
+    if (loudnessCalculator != nullptr) {
+        return loudnessCalculator->calculateResult();
+    }
+    if (replayGainCalculator != nullptr) {
+        return replayGainCalculator->calculateResult();
+    }
+    return 0.0;
+}
+
+
 void Analyzer::decoderDone()
 {
     decoderFinished = true;
+
+    // all buffers that arrived before the decoder finished are processed by now
+    if (isReady() && (bufferQueue->count() == 0)) {
+        ReplayGainCalculator::Silences finalSilences = getSilences(true);
+        double                         finalGain     = calculateResult();
+
+        if (!silenceOnly) {
+            emit replayGain(finalGain);
+        }
+        emit silences(getNewSilences(true));
+        emit analysisFinished(finalGain, getPeak(), finalSilences);
+    }
+}
+
+
+ReplayGainCalculator::Silences Analyzer::getNewSilences(bool addFinalSilence)
+{
+    if (loudnessCalculator != nullptr) {
+        return loudnessCalculator->getNewSilences(addFinalSilence);
+    }
+    return silenceScanner->getNewSilences(addFinalSilence);
+}
+
+
+double Analyzer::getPeak()
+{
+    // true peak if the R128 engine is in use
+    if (loudnessCalculator != nullptr) {
+        return loudnessCalculator->getPeak();
+    }
+    return silenceScanner->getPeak();
+}
+
+
+ReplayGainCalculator::Silences Analyzer::getSilences(bool addFinalSilence)
+{
+    if (loudnessCalculator != nullptr) {
+        return loudnessCalculator->getSilences(addFinalSilence);
+    }
+    return silenceScanner->getSilences(addFinalSilence);
+}
+
+
+bool Analyzer::isReady()
+{
+    return (loudnessCalculator != nullptr) || (silenceScanner != nullptr);
 }
 
 
 void Analyzer::silencesRequested(bool addFinalSilence)
 {
-    emit silences(replayGainCalculator->getSilences(addFinalSilence));
+    if (isReady()) {
+        emit silences(getNewSilences(addFinalSilence));
+    }
 }
 
 
@@ -71,6 +177,12 @@ void Analyzer::resetReplayGain()
     if (replayGainCalculator != nullptr) {
         replayGainCalculator->reset();
     }
+    if (loudnessCalculator != nullptr) {
+        loudnessCalculator->reset();
+    }
+    if (silenceScanner != nullptr) {
+        silenceScanner->reset();
+    }
 }
 
 
@@ -78,9 +190,29 @@ void Analyzer::run()
 {
     sampleType = IIRFilter::getSampleTypeFromAudioFormat(format);
 
-    if ((sampleType != IIRFilter::Unknown) && QVector<int>({ 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000 }).contains(format.sampleRate())) {
+    if (sampleType == IIRFilter::Unknown) {
+        return;
+    }
+
+    // replay gain is already known from tags, only silences are needed, they're found on the PCM data
+    if (silenceOnly) {
+        silenceScanner = new SilenceScanner(sampleType, format.sampleRate(), format.channelCount());
+        return;
+    }
+
+    if (engine == R128Engine) {
+        loudnessCalculator = new LoudnessCalculator(sampleType, format.sampleRate(), format.channelCount());
+        return;
+    }
+
+    if (QVector<int>({ 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000 }).contains(format.sampleRate())) {
         replayGainFilter     = new IIRFilterChain();
         replayGainCalculator = new ReplayGainCalculator(sampleType, format.sampleRate());
+        silenceScanner       = new SilenceScanner(sampleType, format.sampleRate(), format.channelCount());
+
+        // silences are found on the filter's output
+        silenceScanner->setFilteredInput(true);
+        replayGainCalculator->setSilenceScanner(silenceScanner);
 
         switch (format.sampleRate()) {
             case 96000:
@@ -143,3 +275,15 @@ void Analyzer::setBufferQueue(BufferQueue *bufferQueue, QMutex *bufferQueueMutex
     this->bufferQueue      = bufferQueue;
     this->bufferQueueMutex = bufferQueueMutex;
 }
+
+
+void Analyzer::setEngine(Engine engine)
+{
+    this->engine = engine;
+}
+
+
+void Analyzer::setSilenceOnly(bool silenceOnly)
+{
+    this->silenceOnly = silenceOnly;
+}
@@ -23,7 +23,9 @@
 #include <replaygaincoefficients.h>
 
 #include "globals.h"
+#include "loudnesscalculator.h"
 #include "replaygaincalculator.h"
+#include "silencescanner.h"
 
 
 #ifdef QT_DEBUG
@@ -37,10 +39,22 @@ class Analyzer : public QObject
 
     public:
 
+        enum Engine {
+            ReplayGainEngine,
+            R128Engine
+        };
+
         explicit Analyzer(QAudioFormat format, QObject *parent = nullptr);
         ~Analyzer();
 
         void setBufferQueue(BufferQueue *bufferQueue, QMutex *bufferQueueMutex);
+        void setEngine(Engine engine);
+        void setSilenceOnly(bool silenceOnly);
+
+        void                           appendSegment(Analyzer *next);
+        double                         calculateResult();
+        double                         getPeak();
+        ReplayGainCalculator::Silences getSilences(bool addFinalSilence);
 
 
     private:
@@ -53,10 +67,17 @@ class Analyzer : public QObject
         QAudioFormat format;
 
         bool                    decoderFinished;
+        bool                    silenceOnly;
+        Engine                  engine;
         qint64                  resultLastCalculated;
         IIRFilter::SampleTypes  sampleType;
         IIRFilterChain         *replayGainFilter;
         ReplayGainCalculator   *replayGainCalculator;
+        LoudnessCalculator     *loudnessCalculator;
+        SilenceScanner         *silenceScanner;
+
+        bool                           isReady();
+        ReplayGainCalculator::Silences getNewSilences(bool addFinalSilence);
 
 
     public slots:
@@ -73,7 +94,9 @@ class Analyzer : public QObject
     signals:
 
         void replayGain(double replayGain);
+        // only silences found since the previous emit
         void silences(ReplayGainCalculator::Silences silences);
+        void analysisFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences);
 };
 
 #endif // ANALYZER_H
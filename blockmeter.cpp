@@ -0,0 +1,103 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "blockmeter.h"
+
+
+BlockMeter::Levels BlockMeter::measure(const char *data, int byteCount, QAudioFormat format)
+{
+    int channelCount = qMax(format.channelCount(), 1);
+    int frameCount   = format.framesForBytes(byteCount);
+
+    if ((format.sampleType() == QAudioFormat::SignedInt) && (format.sampleSize() == 16) && (channelCount == 2)) {
+        return measureStereo16(reinterpret_cast<const qint16 *>(data), frameCount);
+    }
+
+    if (format.sampleType() == QAudioFormat::SignedInt) {
+        switch (format.sampleSize()) {
+            case 8:
+                return measure<qint8>(reinterpret_cast<const qint8 *>(data), frameCount, channelCount, 0, 1.0 / 128);
+            case 16:
+                return measure<qint16>(reinterpret_cast<const qint16 *>(data), frameCount, channelCount, 0, 1.0 / 32768);
+            case 32:
+                return measure<qint32>(reinterpret_cast<const qint32 *>(data), frameCount, channelCount, 0, 1.0 / 2147483648.0);
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::UnSignedInt) {
+        switch (format.sampleSize()) {
+            case 8:
+                return measure<quint8>(reinterpret_cast<const quint8 *>(data), frameCount, channelCount, 128, 1.0 / 128);
+            case 16:
+                return measure<quint16>(reinterpret_cast<const quint16 *>(data), frameCount, channelCount, 32768, 1.0 / 32768);
+            case 32:
+                return measure<quint32>(reinterpret_cast<const quint32 *>(data), frameCount, channelCount, 2147483648.0, 1.0 / 2147483648.0);
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::Float) {
+        return measure<float>(reinterpret_cast<const float *>(data), frameCount, channelCount, 0, 1.0);
+    }
+
+    return { 0, 0, 0, 0 };
+}
+
+
+// tracks play stereo 16 bit, four frames at a time with integer peaks and sums, lanes alternate between left and right
+BlockMeter::Levels BlockMeter::measureStereo16(const qint16 *samples, int frameCount)
+{
+    int       vectorFrames = frameCount - frameCount % 4;
+    ShortOcts highest      = octsBroadcast(std::numeric_limits<qint16>::min());
+    ShortOcts lowest       = octsBroadcast(std::numeric_limits<qint16>::max());
+    LongPair  squares      = longPairZero();
+
+    for (int frame = 0; frame < vectorFrames; frame += 4) {
+        ShortOcts octs = octsLoad(samples + frame * 2);
+        highest        = octsMax(highest, octs);
+        lowest         = octsMin(lowest, octs);
+        squares        = longPairAddSquares(squares, octs);
+    }
+
+    qint16 highestLanes[8];
+    qint16 lowestLanes[8];
+    qint64 sums[2];
+    octsStore(highestLanes, highest);
+    octsStore(lowestLanes, lowest);
+    longPairStore(sums, squares);
+
+    int lMax = 0;
+    int rMax = 0;
+    for (int lane = 0; lane < 8; lane += 2) {
+        lMax = qMax(lMax, qMax(static_cast<int>(highestLanes[lane]), -lowestLanes[lane]));
+        rMax = qMax(rMax, qMax(static_cast<int>(highestLanes[lane + 1]), -lowestLanes[lane + 1]));
+    }
+
+    qint64 lSum = sums[0];
+    qint64 rSum = sums[1];
+    for (int frame = vectorFrames; frame < frameCount; frame++) {
+        int left  = samples[frame * 2];
+        int right = samples[frame * 2 + 1];
+
+        lMax  = qMax(lMax, qAbs(left));
+        rMax  = qMax(rMax, qAbs(right));
+        lSum += left * left;
+        rSum += right * right;
+    }
+
+    return scaled(lMax, rMax, lSum, rSum, frameCount, 1.0 / 32768);
+}
+
+
+BlockMeter::Levels BlockMeter::scaled(double lMax, double rMax, double lSum, double rSum, int frameCount, double scale)
+{
+    Levels levels = { 0, 0, 0, 0 };
+    if (frameCount > 0) {
+        levels.lPeak = qMin(lMax * scale, 1.0);
+        levels.rPeak = qMin(rMax * scale, 1.0);
+        levels.lRms  = qMin(qSqrt(lSum / frameCount) * scale, 1.0);
+        levels.rRms  = qMin(qSqrt(rSum / frameCount) * scale, 1.0);
+    }
+    return levels;
+}
@@ -0,0 +1,67 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef BLOCKMETER_H
+#define BLOCKMETER_H
+
+#include <QAudioFormat>
+#include <QtGlobal>
+#include <QtMath>
+
+#include <limits>
+
+#include "simd.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// per-channel peak and RMS of a whole block of interleaved samples, in one pass
+class BlockMeter
+{
+    public:
+
+        // scaled to 0..1 of full scale
+        struct Levels {
+            double lPeak;
+            double rPeak;
+            double lRms;
+            double rRms;
+        };
+
+        static Levels measure(const char *data, int byteCount, QAudioFormat format);
+
+
+    private:
+
+        static Levels measureStereo16(const qint16 *samples, int frameCount);
+        static Levels scaled(double lMax, double rMax, double lSum, double rSum, int frameCount, double scale);
+
+        template <class T> static Levels measure(const T *samples, int frameCount, int channelCount, double offset, double scale)
+        {
+            int rightOffset = channelCount > 1 ? 1 : 0;
+
+            double lMax = 0;
+            double rMax = 0;
+            double lSum = 0;
+            double rSum = 0;
+            for (int frame = 0; frame < frameCount; frame++) {
+                double left  = static_cast<double>(samples[frame * channelCount]) - offset;
+                double right = static_cast<double>(samples[frame * channelCount + rightOffset]) - offset;
+
+                lMax  = qMax(lMax, qAbs(left));
+                rMax  = qMax(rMax, qAbs(right));
+                lSum += left * left;
+                rSum += right * right;
+            }
+
+            return scaled(lMax, rMax, lSum, rSum, frameCount, scale);
+        }
+};
+
+#endif // BLOCKMETER_H
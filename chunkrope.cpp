@@ -0,0 +1,164 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "chunkrope.h"
+
+
+ChunkRope::ChunkRope()
+{
+    firstChunk        = 0;
+    beginningPosition = 0;
+    endPosition       = 0;
+}
+
+
+void ChunkRope::append(QByteArray chunk)
+{
+    if (chunk.isEmpty()) {
+        return;
+    }
+
+    chunks.append(chunk);
+    chunkPositions.append(endPosition);
+
+    endPosition += chunk.size();
+}
+
+
+void ChunkRope::append(const char *data, int length)
+{
+    if (length <= 0) {
+        return;
+    }
+
+    append(QByteArray(data, length));
+}
+
+
+qint64 ChunkRope::beginning() const
+{
+    return beginningPosition;
+}
+
+
+qint64 ChunkRope::bytesFrom(qint64 position) const
+{
+    if (!contains(position)) {
+        return 0;
+    }
+    return endPosition - position;
+}
+
+
+// binary search among the chunks that are not released yet
+int ChunkRope::chunkIndex(qint64 position) const
+{
+    int low  = firstChunk;
+    int high = chunks.size() - 1;
+
+    while (low < high) {
+        int middle = (low + high + 1) / 2;
+        if (chunkPositions.at(middle) <= position) {
+            low = middle;
+        }
+        else {
+            high = middle - 1;
+        }
+    }
+
+    return low;
+}
+
+
+void ChunkRope::clear()
+{
+    chunks.clear();
+    chunkPositions.clear();
+
+    firstChunk        = 0;
+    beginningPosition = endPosition;
+}
+
+
+// released chunks are removed once they're the majority, so releasing is constant time on average
+void ChunkRope::compact()
+{
+    if ((firstChunk < COMPACT_MINIMUM) || (firstChunk < chunks.size() / 2)) {
+        return;
+    }
+
+    chunks.remove(0, firstChunk);
+    chunkPositions.remove(0, firstChunk);
+
+    firstChunk = 0;
+}
+
+
+bool ChunkRope::contains(qint64 position) const
+{
+    return (position >= beginningPosition) && (position < endPosition);
+}
+
+
+qint64 ChunkRope::end() const
+{
+    return endPosition;
+}
+
+
+bool ChunkRope::isEmpty() const
+{
+    return beginningPosition >= endPosition;
+}
+
+
+qint64 ChunkRope::read(qint64 position, char *data, qint64 maxLength) const
+{
+    if (!contains(position) || (maxLength <= 0)) {
+        return 0;
+    }
+
+    qint64 copied = 0;
+    int    index  = chunkIndex(position);
+
+    while ((copied < maxLength) && (index < chunks.size())) {
+        const QByteArray &chunk       = chunks.at(index);
+        qint64            chunkOffset = position + copied - chunkPositions.at(index);
+        qint64            copyCount   = qMin(maxLength - copied, chunk.size() - chunkOffset);
+
+        memcpy(data + copied, chunk.constData() + chunkOffset, copyCount);
+
+        copied += copyCount;
+        index++;
+    }
+
+    return copied;
+}
+
+
+// everything before the position is no longer needed, the partially released chunk is kept as it is
+void ChunkRope::release(qint64 position)
+{
+    position = qMin(position, endPosition);
+    if (position <= beginningPosition) {
+        return;
+    }
+
+    while ((firstChunk < chunks.size()) && (chunkPositions.at(firstChunk) + chunks.at(firstChunk).size() <= position)) {
+        chunks[firstChunk].clear();
+        firstChunk++;
+    }
+    beginningPosition = position;
+
+    compact();
+}
+
+
+qint64 ChunkRope::size() const
+{
+    return endPosition - beginningPosition;
+}
@@ -0,0 +1,59 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef CHUNKROPE_H
+#define CHUNKROPE_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <QVector>
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// downloaded bytes kept in the chunks they arrived in, addressed by position in the stream
+// not thread safe, the owner must lock
+class ChunkRope
+{
+    public:
+
+        ChunkRope();
+
+        void append(QByteArray chunk);
+        void append(const char *data, int length);
+        void release(qint64 position);
+        void clear();
+
+        qint64 read(qint64 position, char *data, qint64 maxLength) const;
+
+        qint64 beginning() const;
+        qint64 end() const;
+        qint64 size() const;
+        qint64 bytesFrom(qint64 position) const;
+        bool   contains(qint64 position) const;
+        bool   isEmpty() const;
+
+
+    private:
+
+        static const int COMPACT_MINIMUM = 64;
+
+        QVector<QByteArray> chunks;
+        QVector<qint64>     chunkPositions;
+
+        // chunks before this index are released, they're removed in batches
+        int    firstChunk;
+        qint64 beginningPosition;
+        qint64 endPosition;
+
+        int  chunkIndex(qint64 position) const;
+        void compact();
+};
+
+#endif // CHUNKROPE_H
@@ -13,15 +13,17 @@ DecoderGeneric::DecoderGeneric(RadioTitleCallback::RadioTitleCallbackInfo radioT
 
     audioDecoder           = nullptr;
     file                   = nullptr;
+    sourceDevice           = nullptr;
     networkSource          = nullptr;
     networkDeviceSet       = false;
     decodedMicroseconds    = 0;
     decodeDelay            = 2500;
     waitUnderBytes         = 4096;
     removeBeginningSilence = false;
-    silenceThreshold       = 0.0;
-
-    networkThread.setObjectName("decodernetwork");
+    rangeStart             = 0;
+    cacheKey               = "";
+    lengthMilliseconds     = 0;
+    silenceScanner         = nullptr;
 }
 
 
@@ -32,13 +34,24 @@ DecoderGeneric::~DecoderGeneric()
         audioDecoder->deleteLater();
     }
 
-    networkThread.quit();
-    networkThread.wait();
+    if (networkSource != nullptr) {
+        networkSource->releaseWaitCondition();
+        NetworkPool::instance()->deleteSource(networkSource);
+    }
 
     if (file != nullptr) {
         file->close();
         file->deleteLater();
     }
+
+    if (sourceDevice != nullptr) {
+        sourceDevice->close();
+        sourceDevice->deleteLater();
+    }
+
+    if (silenceScanner != nullptr) {
+        delete silenceScanner;
+    }
 }
 
 
@@ -55,69 +68,17 @@ void DecoderGeneric::decoderBufferReady()
         return;
     }
 
-    char   *data = bufferReady.data<char>();
-    int    i     = 0;
-    while (removeBeginningSilence && (silenceThreshold > 0.0) && (i < bufferReady.byteCount())) {
-        if (decodedFormat.sampleType() == QAudioFormat::SignedInt) {
-            switch (decodedFormat.sampleSize()) {
-                case 8:
-                    if (abs(*(qint8 *)(data + i)) > silenceThreshold) {
-                        removeBeginningSilence = false;
-                        continue;
-                    }
-                    i++;
-                    break;
-                case 16:
-                    if (abs(*(qint16 *)(data + i)) > silenceThreshold) {
-                        removeBeginningSilence = false;
-                        continue;
-                    }
-                    i += 2;
-                    break;
-                case 32:
-                    if (abs(*(qint32 *)(data + i)) > silenceThreshold) {
-                        removeBeginningSilence = false;
-                        continue;
-                    }
-                    i += 4;
-            }
-        }
-        else if (decodedFormat.sampleType() == QAudioFormat::UnSignedInt) {
-            switch (decodedFormat.sampleSize()) {
-                case 8:
-                    if (*(quint8 *)(data + i) > silenceThreshold) {
-                        removeBeginningSilence = false;
-                        continue;
-                    }
-                    i++;
-                    break;
-                case 16:
-                    if (*(quint16 *)(data + i) > silenceThreshold) {
-                        removeBeginningSilence = false;
-                        continue;
-                    }
-                    i += 2;
-                    break;
-                case 32:
-                    if (*(quint32 *)(data + i) > silenceThreshold) {
-                        removeBeginningSilence = false;
-                        continue;
-                    }
-                    i += 4;
-            }
-        }
-    }
-    if (i > 0) {
-        while (i % decodedFormat.bytesForFrames(1)) {
-            i++;
-        }
-        if (i >= bufferReady.byteCount()) {
+    if (removeBeginningSilence && (silenceScanner != nullptr)) {
+        int firstLoudFrame = silenceScanner->firstLoudFrame(bufferReady.constData(), bufferReady.byteCount());
+        if (firstLoudFrame < 0) {
             return;
         }
-        QByteArray temp(static_cast<const char *>(bufferReady.constData()), bufferReady.byteCount());
-        temp.remove(0, i);
+        if (firstLoudFrame > 0) {
+            QByteArray temp(static_cast<const char *>(bufferReady.constData()), bufferReady.byteCount());
+            temp.remove(0, decodedFormat.bytesForFrames(firstLoudFrame));
 
-        bufferReady = QAudioBuffer(temp, decodedFormat, decodedMicroseconds);
+            bufferReady = QAudioBuffer(temp, decodedFormat, decodedMicroseconds);
+        }
     }
     removeBeginningSilence = false;
 
@@ -214,6 +175,16 @@ qint64 DecoderGeneric::getDecodedMicroseconds()
 }
 
 
+// what's needed to restart decoding from the middle, available once the beginning of the download is parsed
+bool DecoderGeneric::getSeekInfo(SeekTable *seekTable, qint64 *totalBytes)
+{
+    if (networkSource == nullptr) {
+        return false;
+    }
+    return networkSource->getSeekInfo(seekTable, totalBytes);
+}
+
+
 bool DecoderGeneric::isFile()
 {
     return url.isLocalFile();
@@ -261,6 +232,12 @@ void DecoderGeneric::networkReady()
 }
 
 
+void DecoderGeneric::networkThroughputMeasured(double bytesPerSecond, double streamBytesPerSecond)
+{
+    emit networkThroughput(bytesPerSecond, streamBytesPerSecond);
+}
+
+
 void DecoderGeneric::run()
 {
     if (url.isEmpty()) {
@@ -269,12 +246,26 @@ void DecoderGeneric::run()
 }
 
 
+// remote tracks only, what's downloaded is kept in the compressed disk cache under this key
+void DecoderGeneric::setCacheKey(QString cacheKey)
+{
+    this->cacheKey = cacheKey;
+}
+
+
 void DecoderGeneric::setDecodeDelay(unsigned long microseconds)
 {
     decodeDelay = microseconds;
 }
 
 
+// remote tracks only, helps estimating how much must be downloaded before decoding can start
+void DecoderGeneric::setLengthMilliseconds(qint64 lengthMilliseconds)
+{
+    this->lengthMilliseconds = lengthMilliseconds;
+}
+
+
 void DecoderGeneric::setParameters(QUrl url, QAudioFormat decodedFormat, qint64 waitUnderBytes, bool isRadio, bool removeBeginningSilence)
 {
     // can be set only once
@@ -285,34 +276,36 @@ void DecoderGeneric::setParameters(QUrl url, QAudioFormat decodedFormat, qint64
         this->isRadio                = isRadio;
         this->removeBeginningSilence = removeBeginningSilence;
 
-        if (decodedFormat.sampleType() == QAudioFormat::SignedInt) {
-                switch (decodedFormat.sampleSize()) {
-                case 8:
-                    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<qint8>::max();
-                    break;
-                case 16:
-                    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<qint16>::max();
-                    break;
-                case 32:
-                    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<qint32>::max();
-                }
-        }
-        else if (decodedFormat.sampleType() == QAudioFormat::UnSignedInt) {
-                switch (decodedFormat.sampleSize()) {
-                case 8:
-                    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<quint8>::max();
-                    break;
-                case 16:
-                    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<quint16>::max();
-                    break;
-                case 32:
-                    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<quint32>::max();
-                }
+        if (removeBeginningSilence) {
+            silenceScanner = new SilenceScanner(IIRFilter::getSampleTypeFromAudioFormat(decodedFormat), decodedFormat.sampleRate(), decodedFormat.channelCount());
         }
     }
 }
 
 
+// remote tracks only, download starts from this byte
+void DecoderGeneric::setRangeStart(qint64 rangeStart)
+{
+    this->rangeStart = rangeStart;
+}
+
+
+// decoder reads this instead of the file the URL points to, takes ownership
+void DecoderGeneric::setSourceDevice(QIODevice *sourceDevice)
+{
+    if (this->sourceDevice == nullptr) {
+        this->sourceDevice = sourceDevice;
+    }
+}
+
+
+// replaces what was given in setParameters, must be called before start
+void DecoderGeneric::setUrl(QUrl url)
+{
+    this->url = url;
+}
+
+
 void DecoderGeneric::start()
 {
     if (url.isEmpty()) {
@@ -327,7 +320,12 @@ void DecoderGeneric::start()
     connect(audioDecoder, SIGNAL(finished()),                  this, SLOT(decoderFinished()));
     connect(audioDecoder, SIGNAL(error(QAudioDecoder::Error)), this, SLOT(decoderError(QAudioDecoder::Error)));
 
-    if (url.isLocalFile()) {
+    if (sourceDevice != nullptr) {
+        sourceDevice->open(QIODevice::ReadOnly);
+        audioDecoder->setSourceDevice(sourceDevice);
+        audioDecoder->start();
+    }
+    else if (url.isLocalFile()) {
         file = new QFile(url.toLocalFile());
         file->open(QFile::ReadOnly);
         audioDecoder->setSourceDevice(file);
@@ -336,20 +334,21 @@ void DecoderGeneric::start()
     else {
         networkSource = new DecoderGenericNetworkSource(url, &waitCondition, radioTitleCallbackInfo);
         networkSource->setErrorOnUnderrun(false);
-        networkSource->moveToThread(&networkThread);
-
-        connect(&networkThread, SIGNAL(started()),  networkSource, SLOT(run()));
-        connect(&networkThread, SIGNAL(finished()), networkSource, SLOT(deleteLater()));
+        networkSource->setRangeStart(rangeStart);
+        networkSource->setCacheKey(cacheKey);
+        networkSource->setLengthMilliseconds(lengthMilliseconds);
+        networkSource->moveToThread(NetworkPool::instance()->sourceThread());
 
         connect(networkSource, SIGNAL(ready()),             this, SLOT(networkReady()));
         connect(networkSource, SIGNAL(changed()),           this, SLOT(networkChanged()));
         connect(networkSource, SIGNAL(error(QString)),      this, SLOT(networkError(QString)));
         connect(networkSource, SIGNAL(info(QString)),       this, SLOT(networkInfo(QString)));
         connect(networkSource, SIGNAL(sessionExpired()),    this, SLOT(networkSessionExpired()));
+        connect(networkSource, SIGNAL(throughputMeasured(double,double)), this, SLOT(networkThroughputMeasured(double,double)));
 
         emit networkStarting(true);
 
-        networkThread.start();
+        QMetaObject::invokeMethod(networkSource, "run", Qt::QueuedConnection);
     }
 }
 
@@ -14,6 +14,8 @@
 #include <QByteArray>
 #include <QDateTime>
 #include <QFile>
+#include <QIODevice>
+#include <QMetaObject>
 #include <QMutex>
 #include <QObject>
 #include <QString>
@@ -26,7 +28,10 @@
 
 #include "decodergenericnetworksource.h"
 #include "globals.h"
+#include "networkpool.h"
 #include "radiotitlecallback.h"
+#include "seektable.h"
+#include "silencescanner.h"
 
 #ifdef QT_DEBUG
     #include <QDebug>
@@ -43,11 +48,17 @@ class DecoderGeneric : public QObject
         ~DecoderGeneric();
 
         void   setParameters(QUrl url, QAudioFormat decodedFormat, qint64 waitUnderBytes, bool isRadio, bool removeBeginningSilence);
+        void   setSourceDevice(QIODevice *sourceDevice);
+        void   setRangeStart(qint64 rangeStart);
+        void   setCacheKey(QString cacheKey);
+        void   setUrl(QUrl url);
+        void   setLengthMilliseconds(qint64 lengthMilliseconds);
         void   setDecodeDelay(unsigned long microseconds);
         qint64 getDecodedMicroseconds();
 
         double downloadPercent();
         bool   isFile();
+        bool   getSeekInfo(SeekTable *seekTable, qint64 *totalBytes);
 
 
     private:
@@ -59,9 +70,12 @@ class DecoderGeneric : public QObject
         qint64       waitUnderBytes;
         bool         isRadio;
         bool         removeBeginningSilence;
+        qint64       rangeStart;
+        QString      cacheKey;
+        qint64       lengthMilliseconds;
 
         QFile                       *file;
-        QThread                      networkThread;
+        QIODevice                   *sourceDevice;
         DecoderGenericNetworkSource *networkSource;
 
         QMutex         waitMutex;
@@ -70,7 +84,8 @@ class DecoderGeneric : public QObject
         bool          networkDeviceSet;
         unsigned long decodeDelay;
         qint64        decodedMicroseconds;
-        double        silenceThreshold;
+
+        SilenceScanner *silenceScanner;
 
         RadioTitleCallback::RadioTitleCallbackInfo radioTitleCallbackInfo;
 
@@ -82,6 +97,7 @@ class DecoderGeneric : public QObject
         void networkError(QString errorString);
         void networkInfo(QString infoString);
         void networkSessionExpired();
+        void networkThroughputMeasured(double bytesPerSecond, double streamBytesPerSecond);
 
         void decoderBufferReady();
         void decoderFinished();
@@ -103,6 +119,7 @@ class DecoderGeneric : public QObject
         void infoMessage(QString info);
         void sessionExpired();
         void networkStarting(bool starting);
+        void networkThroughput(double bytesPerSecond, double streamBytesPerSecond);
 
 };
 
@@ -15,28 +15,44 @@ DecoderGenericNetworkSource::DecoderGenericNetworkSource(QUrl url, QWaitConditio
     this->radioTitleCallbackInfo = radioTitleCallbackInfo;
 
     fakePosition          = 0;
-    firstBufferPosition   = 0;
     totalDownloadedBytes  = 0;
     maxRealBytesAvailable = 0;
     totalExpectedBytes    = std::numeric_limits<qint64>::max();
 
+    rangeStart     = 0;
+    requestOffset  = 0;
+    resumePosition = 0;
+    rangeSkip      = 0;
+    replyChecked   = false;
+    rangeIgnored   = false;
+    rangesAccepted = false;
+    seekHeadDone = false;
+
+    resourceEnd     = std::numeric_limits<qint64>::max();
+    mainEnd         = std::numeric_limits<qint64>::max();
+    segmentsChecked = false;
+    segmented       = false;
+
+    cacheKey    = "";
+    cacheFile   = nullptr;
+    cacheFailed = false;
+
+    lengthMilliseconds   = 0;
+    icyBitrate           = 0;
+    throughputFirstBytes = 0;
+
     networkAccessManager = nullptr;
     networkReply         = nullptr;
 
     connectionTimer = nullptr;
     preCacheTimer   = nullptr;
+    retryTimer      = nullptr;
 
     connectionAttempt = 0;
     downloadStarted   = false;
     downloadFinished  = false;
     readyEmitted      = false;
     errorOnUnderrun   = true;
-
-    rawChunkSize   = 0;
-    rawCount       = 0;
-    metaSize       = 0;
-    metaCount      = 0;
-    totalMetaBytes = 0;
 }
 
 
@@ -52,6 +68,11 @@ DecoderGenericNetworkSource::~DecoderGenericNetworkSource()
         delete preCacheTimer;
         preCacheTimer = nullptr;
     }
+    if (retryTimer != nullptr) {
+        retryTimer->stop();
+        delete retryTimer;
+        retryTimer = nullptr;
+    }
 
     if (networkReply != nullptr) {
         disconnect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
@@ -60,84 +81,159 @@ DecoderGenericNetworkSource::~DecoderGenericNetworkSource()
         networkReply->deleteLater();
         networkReply = nullptr;
     }
-    if (networkAccessManager != nullptr) {
-        delete networkAccessManager;
-        networkAccessManager = nullptr;
-    }
+    stopSegments();
+    networkAccessManager = nullptr;
 
-    foreach (QByteArray *bufferData, buffer) {
-        delete bufferData;
-    }
+    PrefetchScheduler::instance()->setForegroundActive(this, false);
+
+    // an incomplete download is not kept
+    cacheClose(false);
 }
 
 
-bool DecoderGenericNetworkSource::atEnd() const
+// falls back to a single connection, what the others downloaded beyond the buffer is thrown away
+void DecoderGenericNetworkSource::abandonSegments()
 {
+    stopSegments();
 
-    return (fakePosition >= totalExpectedBytes);
+    segmented = false;
+    mainEnd   = std::numeric_limits<qint64>::max();
+
+    // the first connection might have stopped at the end of its part already
+    if ((networkReply == nullptr) && !downloadFinished) {
+        downloadStarted = false;
+        startRequest();
+        connectionTimer->start(CONNECTION_TIMEOUT);
+    }
 }
 
 
-bool DecoderGenericNetworkSource::bufferIndexPositionFromPosition(qint64 position, int *bufferIndex, int *bufferPosition)
+// data in the order of the resource, no matter which connection downloaded it
+void DecoderGenericNetworkSource::appendDownloaded(QByteArray data)
 {
-    // this is a helper for the random access mode
-
-    *bufferIndex    = 0;
-    *bufferPosition = 0;
-
-    // some raw data possibly already deleted to keep memory usage low
-    qint64 bufferBytesCount = firstBufferPosition;
+    resumePosition += data.size();
+    cacheWrite(data);
 
+    // audio goes straight to the buffer, metadata is stripped on the way
     mutex.lock();
+    qint64                     bufferEnd = buffer.end();
+    QVector<IcyDemuxer::Title> titles    = icyDemuxer.demux(data, &buffer);
+    qint64                     audioSize = buffer.end() - bufferEnd;
+    mutex.unlock();
 
-    // save this for after the mutex is unlocked
-    int bufferCount = buffer.count();
+    foreach (IcyDemuxer::Title title, titles) {
+        radioTitlePositions.append({ title.position, title.title });
+    }
 
-    // find the byte array that contains the position we're looking for
-    while (*bufferIndex < bufferCount) {
-        if (bufferBytesCount + buffer.at(*bufferIndex)->count() >= position) {
-            break;
-        }
+    // for available bytes
+    totalDownloadedBytes += audioSize;
 
-        bufferBytesCount += buffer.at(*bufferIndex)->count();
-        *bufferIndex      = *bufferIndex + 1;
-    }
+    // seek table is in the first frame, after the tags
+    if ((rangeStart == 0) && !seekHeadDone && !icyDemuxer.isActive()) {
+        seekHead.append(data);
 
-    mutex.unlock();
+        mutex.lock();
+        seekHeadDone = seekTable.parse(seekHead) || (seekHead.size() >= SEEK_HEAD_LIMIT);
+        mutex.unlock();
 
-    // this means it's not found
-    if (*bufferIndex >= bufferCount) {
-        return false;
+        if (seekHeadDone) {
+            seekHead.clear();
+        }
     }
+}
 
-    // this is where the position is, inside the found byte array
-    *bufferPosition = position - bufferBytesCount;
 
-    return true;
+bool DecoderGenericNetworkSource::atEnd() const
+{
+
+    return (fakePosition >= totalExpectedBytes);
 }
 
 
 qint64 DecoderGenericNetworkSource::bytesAvailable() const
 {
-    if (downloadFinished && (buffer.count() < 1)) {
+    if (downloadFinished && buffer.isEmpty()) {
          return 0;
     }
     return totalDownloadedBytes - fakePosition;
 }
 
 
-QNetworkRequest DecoderGenericNetworkSource::buildNetworkRequest()
+// end is exclusive, negative means until the end of the resource
+QNetworkRequest DecoderGenericNetworkSource::buildNetworkRequest(qint64 offset, qint64 end)
 {
     QNetworkRequest networkRequest = QNetworkRequest(url);
     networkRequest.setRawHeader("User-Agent", QGuiApplication::instance()->applicationName().toUtf8());
     networkRequest.setRawHeader("Icy-MetaData", "1");
+    if (end >= 0) {
+        networkRequest.setRawHeader("Range", QString("bytes=%1-%2").arg(offset).arg(end - 1).toLatin1());
+    }
+    else if (offset > 0) {
+        networkRequest.setRawHeader("Range", QString("bytes=%1-").arg(offset).toLatin1());
+    }
     networkRequest.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
     networkRequest.setMaximumRedirectsAllowed(12);
+    NetworkPool::instance()->prepareRequest(&networkRequest);
 
     return networkRequest;
 }
 
 
+void DecoderGenericNetworkSource::cacheClose(bool complete)
+{
+    if (cacheFile == nullptr) {
+        return;
+    }
+
+    cacheFile->close();
+    delete cacheFile;
+    cacheFile = nullptr;
+
+    if (complete && !cacheFailed) {
+        DiskCache::compressedInstance()->commit(cacheKey);
+        return;
+    }
+    DiskCache::compressedInstance()->discard(cacheKey);
+}
+
+
+// what's written is exactly what the server sent, so the cached file can be decoded like the download
+void DecoderGenericNetworkSource::cacheWrite(QByteArray data)
+{
+    if (cacheKey.isEmpty() || cacheFailed || (rangeStart > 0) || data.isEmpty()) {
+        return;
+    }
+
+    // nothing to gain from keeping live streams
+    if (icyDemuxer.isActive()) {
+        cacheFailed = true;
+        cacheClose(false);
+        return;
+    }
+
+    if (cacheFile == nullptr) {
+        QString path = DiskCache::compressedInstance()->partialPath(cacheKey);
+        if (path.isEmpty()) {
+            cacheFailed = true;
+            return;
+        }
+
+        cacheFile = new QFile(path);
+        if (!cacheFile->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            delete cacheFile;
+            cacheFile   = nullptr;
+            cacheFailed = true;
+            return;
+        }
+    }
+
+    if (cacheFile->write(data) != data.size()) {
+        cacheFailed = true;
+        cacheClose(false);
+    }
+}
+
+
 void DecoderGenericNetworkSource::connectionTimeout()
 {
     if (downloadFinished) {
@@ -156,39 +252,58 @@ void DecoderGenericNetworkSource::connectionTimeout()
         connectionAttempt++;
         if (connectionAttempt >= CONNECTION_ATTEMPTS) {
             downloadFinished = true;
+            PrefetchScheduler::instance()->setForegroundActive(this, false);
             emit error(tr("Connection timeout, aborting"));
             return;
         }
 
-        emit info(tr("Connection timeout, retrying (delay: %1 seconds)").arg(connectionAttempt * 10));
-        QThread::currentThread()->sleep(connectionAttempt * 10);
-        emit info(tr("Connection attempt %1").arg(connectionAttempt + 1));
+        int delay = retryDelay();
+        emit info(tr("Connection timeout, retrying (delay: %1 seconds)").arg(delay / 1000.0, 0, 'f', 1));
+        retryTimer->start(delay);
+    }
+}
 
-        QNetworkRequest networkRequest = buildNetworkRequest();
 
-        if (networkReply != nullptr) {
-            disconnect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-            disconnect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
-            networkReply->deleteLater();
-        }
+qint64 DecoderGenericNetworkSource::downloadedSize()
+{
+    return totalDownloadedBytes;
+}
 
-        networkReply = networkAccessManager->get(networkRequest);
-        connect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-        connect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
 
-        if (connectionTimer != nullptr) {
-            connectionTimer->start(CONNECTION_TIMEOUT * 4 * connectionAttempt);
+// parts downloaded on the other connections follow the first connection's part, whatever is next in line is moved to the buffer
+void DecoderGenericNetworkSource::drainSegments()
+{
+    if (!segmented || downloadFinished) {
+        return;
+    }
+
+    while (!segments.isEmpty() && (segments.first().begin == resumePosition)) {
+        Segment &segment = segments.first();
+
+        foreach (QByteArray chunk, segment.chunks) {
+            appendDownloaded(chunk);
         }
-        if (preCacheTimer != nullptr) {
-            preCacheTimer->start(PRE_CACHE_TIMEOUT * 4 * connectionAttempt);
+        segment.chunks.clear();
+        segment.begin = segment.received;
+
+        // still downloading, the rest is moved as it arrives
+        if (segment.begin < segment.end) {
+            break;
         }
+
+        disconnect(segment.reply, nullptr, this, nullptr);
+        segment.reply->deleteLater();
+        segment.stallTimer->stop();
+        segment.stallTimer->deleteLater();
+        segments.removeFirst();
     }
-}
 
+    if (resumePosition >= resourceEnd) {
+        finishDownload(resumePosition - requestOffset);
+    }
 
-qint64 DecoderGenericNetworkSource::downloadedSize()
-{
-    return totalDownloadedBytes;
+    // wake up the decoder thread
+    wakeDecoder();
 }
 
 
@@ -198,6 +313,36 @@ void DecoderGenericNetworkSource::emitReady()
 }
 
 
+void DecoderGenericNetworkSource::finishDownload(qint64 bytesReceived)
+{
+    downloadFinished = true;
+    PrefetchScheduler::instance()->setForegroundActive(this, false);
+    cacheClose(totalDownloadedBytes == totalExpectedBytes);
+
+    // sustained throughput of the whole download, later tracks' bitrate is chosen by it
+    if (throughputTimer.isValid() && (bytesReceived - throughputFirstBytes >= THROUGHPUT_REPORT_BYTES)) {
+        emit throughputMeasured((bytesReceived - throughputFirstBytes) * 1000.0 / qMax(throughputTimer.elapsed(), static_cast<qint64>(1)), streamByteRate());
+    }
+}
+
+
+// only the source that downloads from the beginning knows these
+bool DecoderGenericNetworkSource::getSeekInfo(SeekTable *seekTable, qint64 *totalBytes)
+{
+    bool available = false;
+
+    mutex.lock();
+    if ((rangeStart == 0) && seekHeadDone && (totalExpectedBytes < std::numeric_limits<qint64>::max())) {
+        *seekTable  = this->seekTable;
+        *totalBytes = totalExpectedBytes;
+        available   = true;
+    }
+    mutex.unlock();
+
+    return available;
+}
+
+
 bool DecoderGenericNetworkSource::isDownloadFinished()
 {
     return downloadFinished;
@@ -214,6 +359,17 @@ bool DecoderGenericNetworkSource::isSequential() const
 }
 
 
+// bytes per second of the current connection, zero until there's enough to tell
+double DecoderGenericNetworkSource::measuredThroughput(qint64 bytesReceived)
+{
+    if (!throughputTimer.isValid() || (throughputTimer.elapsed() < THROUGHPUT_MIN_MILLISECONDS)) {
+        return 0;
+    }
+
+    return (bytesReceived - throughputFirstBytes) * 1000.0 / throughputTimer.elapsed();
+}
+
+
 qint64 DecoderGenericNetworkSource::mostRealBytesAvailable()
 {
     return maxRealBytesAvailable;
@@ -232,98 +388,59 @@ void DecoderGenericNetworkSource::networkDownloadProgress(qint64 bytesReceived,
 
     // read the data
     QByteArray data = networkReply->readAll();
+    PrefetchScheduler::instance()->foregroundReceived(data.size());
 
-    // check if metadata must be extracted
-    if ((rawChunkSize == 0) && networkReply->hasRawHeader("icy-metaint")) {
-        QString icyMetaInt(networkReply->rawHeader("icy-metaint"));
-        bool OK = false;
-        rawChunkSize = icyMetaInt.toInt(&OK);
-        if (!OK) {
-            rawChunkSize = 0;
-        }
-    }
+    // first data of a new connection
+    if (!replyChecked) {
+        replyChecked = true;
 
-    // extract metadata
-    if (rawChunkSize > 0) {
-        int pointer = 0;
-        while (pointer < data.count()) {
-            // is pointer inside metadata now?
-            if (rawCount < 0) {
-                // was metadata size obtained yet?
-                if (metaSize < 0) {
-                    // first byte of metadata is size of the rest of metadata divided by 16
-                    char *lenByte = data.data() + pointer;
-                    metaSize = 16 * *lenByte;
-
-                    // remove this byte, must not pass it to the decoder, pointer needs not to be increased
-                    data.remove(pointer, 1);
-                    totalMetaBytes++;
-                }
+        // a server that ignores the range request sends everything, the part before the range is dropped here then
+        int statusCode = networkReply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        rangeIgnored   = (requestOffset > 0) && (statusCode != 206);
+        rangeSkip      = rangeIgnored ? requestOffset : 0;
+        rangesAccepted = (statusCode == 206) || (networkReply->rawHeader("Accept-Ranges").trimmed().toLower() == "bytes");
 
-                // downloaded data might not contain all the metadata, the rest will be in next download chunk
-                int increment = qMin(metaSize - metaCount, data.count() - pointer);
-
-                // add to metadata buffer
-                metaBuffer.append(data.data() + pointer, increment);
-
-                // remove from data, must not pass it to the decoder, pointer needs not to be increased
-                data.remove(pointer, increment);
-                totalMetaBytes += increment;
-
-                // update metadata bytes counter
-                metaCount += increment;
-
-                // is the end of metadata reached?
-                if (metaCount == metaSize) {
-                    // many times metadata is empty, most stations send only on connection and track change
-                    if (metaBuffer.count() > 0) {
-                        // search for title
-                        QRegExp finder("StreamTitle='(.+)';");
-                        finder.setMinimal(true);
-                        if (finder.indexIn(QString(metaBuffer)) >= 0) {
-                            // got it
-                            radioTitlePositions.append({ totalDownloadedBytes + pointer, finder.cap(1) });
-                        }
-                    }
+        // throughput is measured from the first data, connection setup is not part of it
+        throughputTimer.start();
+        throughputFirstBytes = bytesReceived - (rangeIgnored ? requestOffset : 0);
 
-                    // reset counter, prepare for audio data
-                    rawCount = 0;
-                }
-            }
-            else {
-                // downloaded data might not contain the entire block of compressed audio data, the rest will be in next download chunk
-                int increment = qMin(rawChunkSize - rawCount, data.count() - pointer);
-
-                // increase pointer and counters
-                pointer  += increment;
-                rawCount += increment;
-
-                // is the end of audio block reached?
-                if (rawCount == rawChunkSize) {
-                    // signals that pointer reached metadata
-                    rawCount = -1;
-
-                    // prepare for metadata
-                    metaCount = 0;
-                    metaSize  = -1;
-                    metaBuffer.clear();
-                }
-            }
+        if (networkReply->hasRawHeader("icy-br")) {
+            icyBitrate = QString(networkReply->rawHeader("icy-br")).split(",").first().toInt();
         }
-    }
 
-    // add it the buffer
-    QByteArray *bufferData = new QByteArray(data.constData(), data.count());
-    mutex.lock();
-    buffer.append(bufferData);
-    mutex.unlock();
+        // check if metadata must be extracted, a reconnected stream starts a new metadata interval
+        if (networkReply->hasRawHeader("icy-metaint")) {
+            QString icyMetaInt(networkReply->rawHeader("icy-metaint"));
+            bool OK = false;
+            int metaInterval = icyMetaInt.toInt(&OK);
+            if (OK) {
+                icyDemuxer.setMetaInterval(metaInterval);
+            }
+        }
 
-    // for available bytes
-    totalDownloadedBytes += bufferData->size();
+        // this connection works, attempts are counted from zero again
+        connectionAttempt = 0;
+    }
+    if (rangeIgnored) {
+        bytesReceived -= requestOffset;
+        if (bytesTotal > 0) {
+            bytesTotal -= requestOffset;
+        }
+    }
+    if (rangeSkip > 0) {
+        int skipCount = static_cast<int>(qMin(rangeSkip, static_cast<qint64>(data.size())));
+        data.remove(0, skipCount);
+        rangeSkip -= skipCount;
+    }
+    if (resumePosition + data.size() > mainEnd) {
+        data.truncate(static_cast<int>(mainEnd - resumePosition));
+    }
+    appendDownloaded(data);
 
     // this is used in size()
     if (bytesTotal > 0) {
-        totalExpectedBytes = bytesTotal - totalMetaBytes;
+        totalExpectedBytes = requestOffset - rangeStart + bytesTotal - icyDemuxer.getMetaBytes();
+        resourceEnd        = requestOffset + bytesTotal;
     }
     else {
         totalExpectedBytes = totalDownloadedBytes;
@@ -333,23 +450,47 @@ void DecoderGenericNetworkSource::networkDownloadProgress(qint64 bytesReceived,
         emit changed();
 
         // let the world know when pre-caching is done, bytesTotal is unknown (zero) for radio stations
-        qint64 radioMin = 65536;
-        #ifdef Q_OS_WINDOWS
-            radioMin = 262144;
-        #endif
-        if ((bytesReceived >= (bytesTotal > 0 ? qMin(bytesTotal, (qint64)1024 * 1024) : radioMin))) {
+        double throughput = measuredThroughput(bytesReceived);
+        qint64 target     = preCacheTarget(bytesTotal, throughput);
+        if (bytesReceived >= target) {
             QTimer::singleShot(250, this, &DecoderGenericNetworkSource::emitReady);
             readyEmitted = true;
+
+            emit info(tr("Pre-cached %1 KB in %2 ms (download %3 KB/s, stream %4 kbps)").arg(bytesReceived / 1024).arg(throughputTimer.elapsed()).arg(static_cast<qint64>(throughput / 1024)).arg(static_cast<qint64>(streamByteRate() / 125)));
+        }
+        else if ((throughput > 0) && (preCacheTimer != nullptr) && preCacheTimer->isActive()) {
+            // a slow but steady download gets the time it needs instead of being restarted
+            int needed = static_cast<int>(qMin((target - bytesReceived) * 1000.0 / throughput * SAFETY_MARGIN, static_cast<double>(PRE_CACHE_TIMEOUT_MAX)));
+            if (needed > preCacheTimer->remainingTime()) {
+                preCacheTimer->start(needed);
+            }
         }
     }
 
     // check if this is the last chunk
     if (bytesReceived == bytesTotal) {
-        downloadFinished = true;
+        finishDownload(bytesReceived);
+    }
+
+    // the rest is split between more connections once playback is safe to start
+    if (readyEmitted && !segmentsChecked && !downloadFinished && (bytesTotal > 0)) {
+        startSegments();
+    }
+
+    // the first connection's part is done, the other connections continue from here
+    if (segmented && (resumePosition >= mainEnd)) {
+        disconnect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
+        disconnect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
+        networkReply->abort();
+        networkReply->deleteLater();
+        networkReply = nullptr;
+
+        drainSegments();
+        return;
     }
 
     // wake up the decoder thread
-    waitCondition->wakeAll();
+    wakeDecoder();
 }
 
 
@@ -378,40 +519,54 @@ void DecoderGenericNetworkSource::networkError(QNetworkReply::NetworkError code)
     connectionAttempt++;
     if (connectionAttempt >= CONNECTION_ATTEMPTS) {
         downloadFinished = true;
+        PrefetchScheduler::instance()->setForegroundActive(this, false);
+        stopSegments();
         if (networkReply != nullptr) {
             emit error(networkReply->errorString());
         }
         return;
     }
 
-    emit info(tr("Network error, retrying (delay: %1 seconds)").arg(connectionAttempt * 10));
-    QThread::currentThread()->sleep(connectionAttempt * 10);
-    emit info(tr("Connection attempt %1").arg(connectionAttempt + 1));
+    int delay = retryDelay();
+    emit info(tr("Network error, retrying (delay: %1 seconds)").arg(delay / 1000.0, 0, 'f', 1));
+    retryTimer->start(delay);
+}
 
-    QNetworkRequest networkRequest = buildNetworkRequest();
 
-    if (networkReply != nullptr) {
-        disconnect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-        disconnect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
-        networkReply->deleteLater();
-    }
+qint64 DecoderGenericNetworkSource::pos() const
+{
+    return fakePosition;
+}
 
-    networkReply = networkAccessManager->get(networkRequest);
-    connect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-    connect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
 
-    if (connectionTimer != nullptr) {
-        connectionTimer->start(CONNECTION_TIMEOUT * 4 * connectionAttempt);
+// decoding can start when the rest is expected to arrive before playback gets there, with a margin for the estimates being off
+qint64 DecoderGenericNetworkSource::preCacheTarget(qint64 bytesTotal, double throughput)
+{
+    #ifdef Q_OS_WINDOWS
+        qint64 minimum  = 262144;
+        qint64 radioMax = 262144;
+    #else
+        qint64 minimum  = 32768;
+        qint64 radioMax = 65536;
+    #endif
+
+    double byteRate = streamByteRate();
+
+    // live streams arrive as fast as they play, only jitter must be covered
+    if (bytesTotal <= 0) {
+        return qMin(radioMax, qMax(minimum, static_cast<qint64>(byteRate * RADIO_BUFFER_SECONDS * SAFETY_MARGIN)));
     }
-    if (preCacheTimer != nullptr) {
-        preCacheTimer->start(PRE_CACHE_TIMEOUT * 4 * connectionAttempt);
+
+    // not measured yet
+    if (throughput <= 0) {
+        return qMin(bytesTotal, static_cast<qint64>(1024 * 1024));
     }
-}
 
+    double playSeconds  = bytesTotal / byteRate;
+    qint64 downloadable = static_cast<qint64>(playSeconds * throughput / SAFETY_MARGIN);
+    qint64 target       = qMax(qMax(minimum, bytesTotal - downloadable), static_cast<qint64>(byteRate * MIN_BUFFER_SECONDS));
 
-qint64 DecoderGenericNetworkSource::pos() const
-{
-    return fakePosition;
+    return qMin(target, bytesTotal);
 }
 
 
@@ -430,32 +585,14 @@ void DecoderGenericNetworkSource::preCacheTimeout()
         connectionAttempt++;
         if (connectionAttempt >= CONNECTION_ATTEMPTS) {
             downloadFinished = true;
+            PrefetchScheduler::instance()->setForegroundActive(this, false);
             emit error("Pre-cache timeout, aborting");
             return;
         }
 
-        emit info(tr("Pre-cache timeout, retrying (delay: %1 seconds)").arg(connectionAttempt * 10));
-        QThread::currentThread()->sleep(connectionAttempt * 10);
-        emit info(tr("Connection attempt").arg(connectionAttempt + 1));
-
-        QNetworkRequest networkRequest = buildNetworkRequest();
-
-        if (networkReply != nullptr) {
-            disconnect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-            disconnect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
-            networkReply->deleteLater();
-        }
-
-        networkReply = networkAccessManager->get(networkRequest);
-        connect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-        connect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
-
-        if (connectionTimer != nullptr) {
-            connectionTimer->start(CONNECTION_TIMEOUT * 4 * connectionAttempt);
-        }
-        if (preCacheTimer != nullptr) {
-            preCacheTimer->start(PRE_CACHE_TIMEOUT * 4 * connectionAttempt);
-        }
+        int delay = retryDelay();
+        emit info(tr("Pre-cache timeout, retrying (delay: %1 seconds)").arg(delay / 1000.0, 0, 'f', 1));
+        retryTimer->start(delay);
     }
 }
 
@@ -470,28 +607,19 @@ qint64 DecoderGenericNetworkSource::readData(char *data, qint64 maxlen)
     }
 
     #ifdef Q_OS_LINUX
-        if ((buffer.count() < 1) && (maxlen > 0) && errorOnUnderrun) {
+        mutex.lock();
+        bool underrun = buffer.isEmpty();
+        mutex.unlock();
+
+        if (underrun && (maxlen > 0) && errorOnUnderrun) {
             emit error(tr("Download buffer underrun"));
             return 0;
         }
 
-        qint64 returnPos = 0;
-
+        // what's read is released right away, sequential devices never go back
         mutex.lock();
-        while ((returnPos < maxlen) && (buffer.count() > 0)) {
-            qint64 copyCount = qMin(maxlen - returnPos, (qint64)buffer.at(0)->count());
-
-            memcpy(data + returnPos, buffer.at(0)->constData(), copyCount);
-            returnPos += copyCount;
-
-            if (copyCount == buffer.at(0)->count()) {
-                delete buffer.at(0);
-                buffer.remove(0);
-            }
-            else {
-                buffer.at(0)->remove(0, copyCount);
-            }
-        }
+        qint64 returnPos = buffer.read(fakePosition, data, maxlen);
+        buffer.release(fakePosition + returnPos);
         mutex.unlock();
 
         fakePosition += returnPos;
@@ -523,7 +651,7 @@ qint64 DecoderGenericNetworkSource::readData(char *data, qint64 maxlen)
             TODO: Check if this class works as a random access device under Linux when Qt is version 5.14 or higher.
                   Also see if there's a way to check gstreamer version instead of Qt version (I believe it should be 1.20 or higher).
             */
-            if (!totalMetaBytes && atEnd()) {
+            if (!icyDemuxer.getMetaBytes() && atEnd()) {
                 emit destroyed();
             }
         #endif
@@ -532,26 +660,17 @@ qint64 DecoderGenericNetworkSource::readData(char *data, qint64 maxlen)
     #endif
 
     #ifdef Q_OS_WINDOWS
-        int bufferIndex;
-        int bufferPosition;
+        mutex.lock();
+        bool underrun = (buffer.size() < 1) || (fakePosition < buffer.beginning()) || (fakePosition > buffer.end());
+        mutex.unlock();
 
-        if (!bufferIndexPositionFromPosition(fakePosition, &bufferIndex, &bufferPosition)) {
+        if (underrun) {
             emit error(tr("Download buffer underrun"));
             return 0;
         }
 
-        qint64 returnPos = 0;
-
         mutex.lock();
-        while ((returnPos < maxlen) && (bufferIndex < buffer.count())) {
-            qint64 copyCount = qMin(maxlen - returnPos, (qint64)buffer.at(bufferIndex)->count() - bufferPosition);
-
-            memcpy(data + returnPos, buffer.at(bufferIndex)->constData() + bufferPosition, copyCount);
-            returnPos += copyCount;
-
-            bufferIndex++;
-            bufferPosition = 0;
-        }
+        qint64 returnPos = buffer.read(fakePosition, data, maxlen);
         mutex.unlock();
 
         fakePosition += returnPos;
@@ -564,26 +683,47 @@ qint64 DecoderGenericNetworkSource::readData(char *data, qint64 maxlen)
 }
 
 
-qint64 DecoderGenericNetworkSource::realBytesAvailable()
+// false if the parallel download had to be abandoned
+bool DecoderGenericNetworkSource::readSegment(QNetworkReply *reply)
 {
-    qint64 returnValue = 0;
-    int    bufferIndex = 0;
-
-    if (!isSequential()) {
-        int bufferPosition = 0;
-        if (!bufferIndexPositionFromPosition(fakePosition, &bufferIndex, &bufferPosition)) {
-            return 0;
+    int index = -1;
+    for (int i = 0; i < segments.count(); i++) {
+        if (segments.at(i).reply == reply) {
+            index = i;
+            break;
         }
-        returnValue += buffer.at(bufferIndex)->size() - bufferPosition;
-        bufferIndex++;
+    }
+    if (index < 0) {
+        return false;
     }
 
-    mutex.lock();
-    int i = bufferIndex;
-    while (i < buffer.size()) {
-        returnValue += buffer.at(i)->size();
-        i++;
+    // a server that doesn't honor the range would send the whole file on every connection
+    QVariant statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+    if (statusCode.isValid() && (statusCode.toInt() != 206)) {
+        emit info(tr("Server ignored the range request, downloading on a single connection"));
+        abandonSegments();
+        return false;
     }
+
+    // every connection keeps reading, its part is held by the segment until everything before it has arrived
+    Segment   &segment = segments[index];
+    QByteArray data    = reply->read(segment.end - segment.received);
+    PrefetchScheduler::instance()->foregroundReceived(data.size());
+
+    if (!data.isEmpty()) {
+        segment.chunks.append(data);
+        segment.received += data.size();
+    }
+    watchSegment(segment);
+
+    return true;
+}
+
+
+qint64 DecoderGenericNetworkSource::realBytesAvailable()
+{
+    mutex.lock();
+    qint64 returnValue = buffer.bytesFrom(fakePosition);
     mutex.unlock();
 
     if (readyEmitted && returnValue > maxRealBytesAvailable) {
@@ -594,26 +734,75 @@ qint64 DecoderGenericNetworkSource::realBytesAvailable()
 }
 
 
+// jittered exponential backoff, so clients that lost the same server don't come back at the same time
+int DecoderGenericNetworkSource::retryDelay()
+{
+    int delay = qMin(RETRY_BASE_DELAY << qMin(connectionAttempt - 1, 8), RETRY_MAX_DELAY);
+    return delay / 2 + QRandomGenerator::global()->bounded(delay / 2 + 1);
+}
+
+
+// the decoder goes away before this is deleted on the network thread, it must not be woken after that
+void DecoderGenericNetworkSource::releaseWaitCondition()
+{
+    waitConditionMutex.lock();
+    waitCondition = nullptr;
+    waitConditionMutex.unlock();
+}
+
+
+// the event loop keeps running while waiting for this, so the decoder can use up what's already downloaded
+void DecoderGenericNetworkSource::retryConnection()
+{
+    if (downloadFinished) {
+        return;
+    }
+
+    emit info(tr("Connection attempt %1").arg(connectionAttempt + 1));
+
+    // connection timeout applies to the new connection too
+    downloadStarted = false;
+
+    startRequest();
+
+    connectionTimer->start(CONNECTION_TIMEOUT * 4 * connectionAttempt);
+    preCacheTimer->start(PRE_CACHE_TIMEOUT * 4 * connectionAttempt);
+}
+
+
 void DecoderGenericNetworkSource::run()
 {
     connectionTimer = new QTimer();
     preCacheTimer   = new QTimer();
+    retryTimer      = new QTimer();
 
     connectionTimer->setSingleShot(true);
     preCacheTimer->setSingleShot(true);
+    retryTimer->setSingleShot(true);
 
     connect(connectionTimer, SIGNAL(timeout()), this, SLOT(connectionTimeout()));
     connect(preCacheTimer,   SIGNAL(timeout()), this, SLOT(preCacheTimeout()));
+    connect(retryTimer,      SIGNAL(timeout()), this, SLOT(retryConnection()));
 
 
-    networkAccessManager = new QNetworkAccessManager();
+    // shared with the other sources, so the connection is reused if the server keeps it alive
+    networkAccessManager = NetworkPool::instance()->manager();
 
-    QNetworkRequest networkRequest = buildNetworkRequest();
+    resumePosition = rangeStart;
 
-    networkReply = networkAccessManager->get(networkRequest);
+    // the prefetched beginning of the track is used as if it was just downloaded, the rest is requested from where the prefetch stopped
+    if (rangeStart == 0) {
+        QVector<QByteArray> prefetched;
+        qint64              prefetchedTotal = -1;
+        if (PrefetchScheduler::instance()->take(url, &prefetched, &prefetchedTotal)) {
+            usePrefetched(prefetched, prefetchedTotal);
+        }
+    }
+    if (downloadFinished) {
+        return;
+    }
 
-    connect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
-    connect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
+    startRequest();
 
     connectionTimer->start(CONNECTION_TIMEOUT);
     preCacheTimer->start(PRE_CACHE_TIMEOUT);
@@ -641,23 +830,18 @@ bool DecoderGenericNetworkSource::seek(qint64 pos)
             seekHistory.removeFirst();
 
             if ((first < fakePosition) && !seekHistory.contains(first)) {
-                int bufferIndex;
-                int bufferPosition;
-                if (bufferIndexPositionFromPosition(first, &bufferIndex, &bufferPosition)) {
-                    int i = 0;
-                    while (i < bufferIndex) {
-                        delete buffer.at(0);
-                        buffer.remove(0);
-                        i++;
-                    }
-                    buffer.at(0)->remove(0, bufferPosition);
+                mutex.lock();
+                bool releasable = buffer.contains(first);
+                if (releasable) {
+                    buffer.release(first);
+                }
+                mutex.unlock();
 
+                if (releasable) {
                     while ((radioTitlePositions.size() > 0) && (first >= radioTitlePositions.first().compressedBytes)) {
                         (radioTitleCallbackInfo.callbackObject->*radioTitleCallbackInfo.callbackMethod)(radioTitlePositions.first().title);
                         radioTitlePositions.removeFirst();
                     }
-
-                    firstBufferPosition = first;
                 }
             }
         }
@@ -667,18 +851,245 @@ bool DecoderGenericNetworkSource::seek(qint64 pos)
 }
 
 
+void DecoderGenericNetworkSource::segmentFinished()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if ((reply == nullptr) || downloadFinished || !readSegment(reply)) {
+        return;
+    }
+
+    foreach (Segment segment, segments) {
+        if ((segment.reply == reply) && ((reply->error() != QNetworkReply::NoError) || (segment.received < segment.end))) {
+            emit info(tr("Parallel download interrupted, continuing on a single connection"));
+            abandonSegments();
+            return;
+        }
+    }
+
+    drainSegments();
+}
+
+
+void DecoderGenericNetworkSource::segmentReadyRead()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if ((reply == nullptr) || downloadFinished || !readSegment(reply)) {
+        return;
+    }
+
+    drainSegments();
+}
+
+
+void DecoderGenericNetworkSource::segmentStalled()
+{
+    if (downloadFinished || !segmented) {
+        return;
+    }
+
+    emit info(tr("Parallel download stalled, continuing on a single connection"));
+    abandonSegments();
+}
+
+
 qint64 DecoderGenericNetworkSource::size() const
 {
     return totalExpectedBytes;
 }
 
 
+// the download is kept on disk under this key, must be set before run
+void DecoderGenericNetworkSource::setCacheKey(QString cacheKey)
+{
+    this->cacheKey = cacheKey;
+}
+
+
 void DecoderGenericNetworkSource::setErrorOnUnderrun(bool errorOnUnderrun)
 {
     this->errorOnUnderrun = errorOnUnderrun;
 }
 
 
+// what the server says about the track, used for estimating the bitrate
+void DecoderGenericNetworkSource::setLengthMilliseconds(qint64 lengthMilliseconds)
+{
+    this->lengthMilliseconds = lengthMilliseconds;
+}
+
+
+// download starts from this byte, must be set before run
+void DecoderGenericNetworkSource::setRangeStart(qint64 rangeStart)
+{
+    this->rangeStart = rangeStart;
+}
+
+
+// live streams can't be resumed, they're requested again and spliced to what's already downloaded
+void DecoderGenericNetworkSource::startRequest()
+{
+    requestOffset = icyDemuxer.isActive() ? 0 : resumePosition;
+    replyChecked  = false;
+
+    QNetworkRequest networkRequest = buildNetworkRequest(requestOffset, -1);
+    PrefetchScheduler::instance()->setForegroundActive(this, true);
+
+    if (networkReply != nullptr) {
+        disconnect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
+        disconnect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
+        networkReply->deleteLater();
+    }
+
+    networkReply = networkAccessManager->get(networkRequest);
+    connect(networkReply, SIGNAL(downloadProgress(qint64,qint64)),    this, SLOT(networkDownloadProgress(qint64,qint64)));
+    connect(networkReply, SIGNAL(error(QNetworkReply::NetworkError)), this, SLOT(networkError(QNetworkReply::NetworkError)));
+}
+
+
+// a single connection is limited by its window on high latency links, so large files are split into ranges downloaded in parallel
+void DecoderGenericNetworkSource::startSegments()
+{
+    segmentsChecked = true;
+
+    if (!rangesAccepted || rangeIgnored || icyDemuxer.isActive() || (resourceEnd == std::numeric_limits<qint64>::max())) {
+        return;
+    }
+
+    QSettings settings;
+    qint64    remaining   = resourceEnd - resumePosition;
+    int       connections = qBound(1, settings.value("options/download_connections", DEFAULT_DOWNLOAD_CONNECTIONS).toInt(), MAX_CONNECTIONS);
+
+    connections = static_cast<int>(qMin(static_cast<qint64>(connections), remaining / SEGMENT_MIN_BYTES));
+    if (connections < 2) {
+        return;
+    }
+
+    qint64 segmentBytes = remaining / connections;
+    mainEnd             = resumePosition + segmentBytes;
+
+    for (int i = 1; i < connections; i++) {
+        qint64 begin = resumePosition + segmentBytes * i;
+        qint64 end   = i < connections - 1 ? begin + segmentBytes : resourceEnd;
+
+        // separate connections are the point, HTTP/2 would multiplex these into one
+        QNetworkRequest networkRequest = buildNetworkRequest(begin, end);
+        networkRequest.setAttribute(QNetworkRequest::Http2AllowedAttribute, false);
+
+        QNetworkReply *reply = networkAccessManager->get(networkRequest);
+        connect(reply, SIGNAL(readyRead()), this, SLOT(segmentReadyRead()));
+        connect(reply, SIGNAL(finished()),  this, SLOT(segmentFinished()));
+
+        QTimer *stallTimer = new QTimer();
+        stallTimer->setSingleShot(true);
+        connect(stallTimer, SIGNAL(timeout()), this, SLOT(segmentStalled()));
+        stallTimer->start(SEGMENT_STALL_TIMEOUT);
+
+        segments.append({ begin, begin, end, reply, stallTimer, QVector<QByteArray>() });
+    }
+    segmented = true;
+
+    emit info(tr("Downloading on %1 connections").arg(connections));
+}
+
+
+void DecoderGenericNetworkSource::stopSegments()
+{
+    foreach (Segment segment, segments) {
+        // aborting emits finished, that must not come back here
+        disconnect(segment.reply, nullptr, this, nullptr);
+        segment.reply->abort();
+        segment.reply->deleteLater();
+
+        // might be the one whose timeout is being handled
+        segment.stallTimer->stop();
+        segment.stallTimer->deleteLater();
+    }
+    segments.clear();
+}
+
+
+// bytes per second, best estimate first
+double DecoderGenericNetworkSource::streamByteRate()
+{
+    if ((lengthMilliseconds > 0) && (rangeStart == 0) && (totalExpectedBytes < std::numeric_limits<qint64>::max())) {
+        return totalExpectedBytes * 1000.0 / lengthMilliseconds;
+    }
+    if (seekHeadDone && (seekTable.bitrate() > 0)) {
+        return seekTable.bitrate() * 125.0;
+    }
+    if (icyBitrate > 0) {
+        return icyBitrate * 125.0;
+    }
+
+    return icyDemuxer.isActive() ? RADIO_FALLBACK_BYTE_RATE : FALLBACK_BYTE_RATE;
+}
+
+
+void DecoderGenericNetworkSource::usePrefetched(QVector<QByteArray> chunks, qint64 totalBytes)
+{
+    qint64 prefetchedBytes = 0;
+
+    mutex.lock();
+    foreach (QByteArray chunk, chunks) {
+        buffer.append(chunk);
+        prefetchedBytes += chunk.size();
+
+        if (seekHead.size() < SEEK_HEAD_LIMIT) {
+            seekHead.append(chunk);
+        }
+    }
+    seekHeadDone = seekTable.parse(seekHead) || (seekHead.size() >= SEEK_HEAD_LIMIT) || (prefetchedBytes == totalBytes);
+    mutex.unlock();
+
+    if (seekHeadDone) {
+        seekHead.clear();
+    }
+
+    foreach (QByteArray chunk, chunks) {
+        cacheWrite(chunk);
+    }
+
+    totalDownloadedBytes = prefetchedBytes;
+    resumePosition       = prefetchedBytes;
+    if (totalBytes > 0) {
+        totalExpectedBytes = totalBytes;
+        downloadFinished   = (prefetchedBytes >= totalBytes);
+    }
+    if (downloadFinished) {
+        cacheClose(true);
+    }
+
+    emit changed();
+    if (downloadFinished || (prefetchedBytes >= 1024 * 1024)) {
+        QTimer::singleShot(250, this, &DecoderGenericNetworkSource::emitReady);
+        readyEmitted = true;
+    }
+
+    wakeDecoder();
+}
+
+
+// restarted whenever data arrives, so it only fires when a connection gets nothing for a while
+void DecoderGenericNetworkSource::watchSegment(Segment &segment)
+{
+    if (segment.received < segment.end) {
+        segment.stallTimer->start(SEGMENT_STALL_TIMEOUT);
+        return;
+    }
+    segment.stallTimer->stop();
+}
+
+
+void DecoderGenericNetworkSource::wakeDecoder()
+{
+    waitConditionMutex.lock();
+    if (waitCondition != nullptr) {
+        waitCondition->wakeAll();
+    }
+    waitConditionMutex.unlock();
+}
+
+
 qint64 DecoderGenericNetworkSource::writeData(const char *data, qint64 len)
 {
     Q_UNUSED(data);
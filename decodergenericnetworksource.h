@@ -10,21 +10,33 @@
 
 #include <QByteArray>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
 #include <QGuiApplication>
 #include <QIODevice>
 #include <QMutex>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QRandomGenerator>
+#include <QSettings>
 #include <QString>
 #include <QStringList>
 #include <QThread>
 #include <QTimer>
 #include <QUrl>
+#include <QVariant>
 #include <QVector>
 #include <QWaitCondition>
 
+#include "chunkrope.h"
+#include "diskcache.h"
+#include "globals.h"
+#include "icydemuxer.h"
+#include "networkpool.h"
+#include "prefetchscheduler.h"
 #include "radiotitlecallback.h"
+#include "seektable.h"
 
 #ifdef QT_DEBUG
     #include <QDebug>
@@ -54,7 +66,12 @@ class DecoderGenericNetworkSource : public QIODevice
         qint64 mostRealBytesAvailable();
         bool   isDownloadFinished();
         void   setErrorOnUnderrun(bool errorOnUnderrun);
+        void   setRangeStart(qint64 rangeStart);
+        void   setCacheKey(QString cacheKey);
+        void   setLengthMilliseconds(qint64 lengthMilliseconds);
         qint64 downloadedSize();
+        bool   getSeekInfo(SeekTable *seekTable, qint64 *totalBytes);
+        void   releaseWaitCondition();
 
 
     private:
@@ -62,30 +79,86 @@ class DecoderGenericNetworkSource : public QIODevice
         static const int CONNECTION_ATTEMPTS = 3;
         static const int CONNECTION_TIMEOUT  = 7500;
         static const int PRE_CACHE_TIMEOUT   = 15000;
+        static const int RETRY_BASE_DELAY    = 2000;
+        static const int RETRY_MAX_DELAY     = 30000;
+        static const int SEEK_HEAD_LIMIT     = 1024 * 1024;
+
+        static const     int    PRE_CACHE_TIMEOUT_MAX       = 60000;
+        static const     int    THROUGHPUT_MIN_MILLISECONDS = 50;
+        static constexpr double SAFETY_MARGIN               = 1.5;
+        static constexpr double MIN_BUFFER_SECONDS          = 1.0;
+        static constexpr double RADIO_BUFFER_SECONDS        = 2.0;
+        static constexpr double FALLBACK_BYTE_RATE          = 176400.0;
+        static constexpr double RADIO_FALLBACK_BYTE_RATE    = 16000.0;
+        static const     int    THROUGHPUT_REPORT_BYTES     = 256 * 1024;
+        static const     int    SEGMENT_MIN_BYTES           = 16 * 1024 * 1024;
+        static const     int    SEGMENT_STALL_TIMEOUT       = 10000;
+        static const     int    MAX_CONNECTIONS             = 6;
 
         struct RadioTitlePosition {
             qint64  compressedBytes;
             QString title;
         };
 
+        // positions in the resource, begin is where the data not moved to the buffer yet starts
+        struct Segment {
+            qint64              begin;
+            qint64              received;
+            qint64              end;
+            QNetworkReply      *reply;
+            QTimer             *stallTimer;
+            QVector<QByteArray> chunks;
+        };
+
         QUrl            url;
         QWaitCondition *waitCondition;
+        QMutex          waitConditionMutex;
 
         QNetworkAccessManager *networkAccessManager;
         QNetworkReply         *networkReply;
 
-        QVector<QByteArray *> buffer;
-        qint64                totalDownloadedBytes;
-        qint64                totalExpectedBytes;
-        qint64                fakePosition;
-        qint64                firstBufferPosition;
-        qint64                maxRealBytesAvailable;
-        QVector<qint64>       seekHistory;
+        ChunkRope       buffer;
+        qint64          totalDownloadedBytes;
+        qint64          totalExpectedBytes;
+        qint64          fakePosition;
+        qint64          maxRealBytesAvailable;
+        QVector<qint64> seekHistory;
+
+        // positions in the resource, a reconnection resumes from where the download was interrupted
+        qint64 rangeStart;
+        qint64 requestOffset;
+        qint64 resumePosition;
+        qint64 rangeSkip;
+        bool   replyChecked;
+        bool   rangeIgnored;
+        bool   rangesAccepted;
+
+        // large files are downloaded on parallel connections, the first one stops at mainEnd
+        QVector<Segment> segments;
+        qint64           resourceEnd;
+        qint64           mainEnd;
+        bool             segmentsChecked;
+        bool             segmented;
+
+        SeekTable  seekTable;
+        QByteArray seekHead;
+        bool       seekHeadDone;
+
+        QString cacheKey;
+        QFile  *cacheFile;
+        bool    cacheFailed;
+
+        // for the pre-cache estimates
+        qint64        lengthMilliseconds;
+        int           icyBitrate;
+        QElapsedTimer throughputTimer;
+        qint64        throughputFirstBytes;
 
         QMutex mutex;
 
         QTimer *connectionTimer;
         QTimer *preCacheTimer;
+        QTimer *retryTimer;
 
         int  connectionAttempt;
         bool downloadStarted;
@@ -93,19 +166,29 @@ class DecoderGenericNetworkSource : public QIODevice
         bool readyEmitted;
         bool errorOnUnderrun;
 
-        int        rawChunkSize;
-        int        rawCount;
-        int        metaSize;
-        int        metaCount;
-        QByteArray metaBuffer;
-        qint64     totalMetaBytes;
+        IcyDemuxer icyDemuxer;
 
         RadioTitleCallback::RadioTitleCallbackInfo radioTitleCallbackInfo;
         QVector<RadioTitlePosition>                radioTitlePositions;
 
-        bool bufferIndexPositionFromPosition(qint64 position, int *bufferIndex, int *bufferPosition);
-
-        QNetworkRequest buildNetworkRequest();
+        QNetworkRequest buildNetworkRequest(qint64 offset, qint64 end);
+        void            startRequest();
+        void            appendDownloaded(QByteArray data);
+        void            finishDownload(qint64 bytesReceived);
+        void            startSegments();
+        void            stopSegments();
+        void            abandonSegments();
+        bool            readSegment(QNetworkReply *reply);
+        void            drainSegments();
+        void            watchSegment(Segment &segment);
+        int             retryDelay();
+        void            cacheWrite(QByteArray data);
+        void            cacheClose(bool complete);
+        double          measuredThroughput(qint64 bytesReceived);
+        qint64          preCacheTarget(qint64 bytesTotal, double throughput);
+        double          streamByteRate();
+        void            usePrefetched(QVector<QByteArray> chunks, qint64 totalBytes);
+        void            wakeDecoder();
 
 
     signals:
@@ -115,6 +198,7 @@ class DecoderGenericNetworkSource : public QIODevice
         void sessionExpired();
         void ready();
         void changed();
+        void throughputMeasured(double bytesPerSecond, double streamBytesPerSecond);
 
 
     public slots:
@@ -129,8 +213,13 @@ class DecoderGenericNetworkSource : public QIODevice
         void networkDownloadProgress(qint64 bytesReceived, qint64 bytesTotal);
         void networkError(QNetworkReply::NetworkError code);
 
+        void segmentReadyRead();
+        void segmentFinished();
+        void segmentStalled();
+
         void connectionTimeout();
         void preCacheTimeout();
+        void retryConnection();
 };
 
 #endif // DECODERGENERICNETWORKSOURCE_H
@@ -0,0 +1,164 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "diskcache.h"
+
+
+const QString DiskCache::PARTIAL_EXTENSION = "part";
+
+
+DiskCache::DiskCache(QString subdirectory, QString completeExtension, QString enabledKey, bool enabledDefault, QString sizeLimitKey, int sizeLimitDefaultMB)
+{
+    this->subdirectory       = subdirectory;
+    this->completeExtension  = completeExtension;
+    this->enabledKey         = enabledKey;
+    this->enabledDefault     = enabledDefault;
+    this->sizeLimitKey       = sizeLimitKey;
+    this->sizeLimitDefaultMB = sizeLimitDefaultMB;
+}
+
+
+bool DiskCache::commit(QString key)
+{
+    mutex.lock();
+
+    QString complete = QString("%1/%2.%3").arg(directory(), fileName(key), completeExtension);
+    QString partial  = QString("%1/%2.%3").arg(directory(), fileName(key), PARTIAL_EXTENSION);
+
+    if (QFile::exists(complete)) {
+        QFile::remove(complete);
+    }
+    bool success = QFile::rename(partial, complete);
+    if (!success) {
+        QFile::remove(partial);
+    }
+
+    trim(sizeLimit());
+
+    mutex.unlock();
+
+    return success;
+}
+
+
+DiskCache *DiskCache::compressedInstance()
+{
+    static DiskCache diskCache("compressed", "audio", "options/compressed_disk_cache", DEFAULT_COMPRESSED_DISK_CACHE, "options/compressed_disk_cache_mb", DEFAULT_COMPRESSED_DISK_CACHE_MB);
+    return &diskCache;
+}
+
+
+QString DiskCache::directory()
+{
+    // mutex must be locked by caller
+
+    QString path = QString("%1/%2").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation), subdirectory);
+
+    QDir dir(path);
+    if (!dir.exists()) {
+        dir.mkpath(path);
+    }
+
+    return path;
+}
+
+
+void DiskCache::discard(QString key)
+{
+    mutex.lock();
+    QFile::remove(QString("%1/%2.%3").arg(directory(), fileName(key), PARTIAL_EXTENSION));
+    mutex.unlock();
+}
+
+
+QString DiskCache::fileName(QString key)
+{
+    return QString(QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex());
+}
+
+
+bool DiskCache::isEnabled()
+{
+    QSettings settings;
+    return settings.value(enabledKey, enabledDefault).toBool();
+}
+
+
+QString DiskCache::lookup(QString key)
+{
+    if (key.isEmpty() || !isEnabled()) {
+        return "";
+    }
+
+    mutex.lock();
+
+    QString path = QString("%1/%2.%3").arg(directory(), fileName(key), completeExtension);
+
+    QFile file(path);
+    if (!file.exists()) {
+        mutex.unlock();
+        return "";
+    }
+
+    // modification time is the recency of use, trimming removes the oldest first
+    if (file.open(QIODevice::ReadWrite)) {
+        file.setFileTime(QDateTime::currentDateTimeUtc(), QFileDevice::FileModificationTime);
+        file.close();
+    }
+
+    mutex.unlock();
+
+    return path;
+}
+
+
+QString DiskCache::partialPath(QString key)
+{
+    if (key.isEmpty() || !isEnabled()) {
+        return "";
+    }
+
+    mutex.lock();
+    QString path = QString("%1/%2.%3").arg(directory(), fileName(key), PARTIAL_EXTENSION);
+    mutex.unlock();
+
+    return path;
+}
+
+
+DiskCache *DiskCache::pcmInstance()
+{
+    static DiskCache diskCache("pcm", "pcm", "options/pcm_disk_cache", DEFAULT_PCM_DISK_CACHE, "options/pcm_disk_cache_mb", DEFAULT_PCM_DISK_CACHE_MB);
+    return &diskCache;
+}
+
+
+qint64 DiskCache::sizeLimit()
+{
+    QSettings settings;
+    return settings.value(sizeLimitKey, sizeLimitDefaultMB).toLongLong() * 1024 * 1024;
+}
+
+
+void DiskCache::trim(qint64 limit)
+{
+    // mutex must be locked by caller
+
+    QFileInfoList entries = QDir(directory()).entryInfoList({ QString("*.%1").arg(completeExtension) }, QDir::Files, QDir::Time);
+
+    qint64 total = 0;
+    foreach (QFileInfo entry, entries) {
+        total += entry.size();
+    }
+
+    // sorted newest first
+    while ((total > limit) && (entries.count() > 0)) {
+        total -= entries.last().size();
+        QFile::remove(entries.last().absoluteFilePath());
+        entries.removeLast();
+    }
+}
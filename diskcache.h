@@ -0,0 +1,68 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QString>
+#include <QtGlobal>
+
+#include "globals.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// size-capped least recently used store of whole files, kept between sessions
+class DiskCache
+{
+    public:
+
+        static const QString PARTIAL_EXTENSION;
+
+        // decoded tracks
+        static DiskCache *pcmInstance();
+        // downloaded tracks exactly as the server sent them
+        static DiskCache *compressedInstance();
+
+        bool    isEnabled();
+        QString lookup(QString key);
+        QString partialPath(QString key);
+        bool    commit(QString key);
+        void    discard(QString key);
+
+
+    private:
+
+        QMutex mutex;
+
+        QString subdirectory;
+        QString completeExtension;
+        QString enabledKey;
+        bool    enabledDefault;
+        QString sizeLimitKey;
+        int     sizeLimitDefaultMB;
+
+        DiskCache(QString subdirectory, QString completeExtension, QString enabledKey, bool enabledDefault, QString sizeLimitKey, int sizeLimitDefaultMB);
+
+        QString directory();
+        QString fileName(QString key);
+        qint64  sizeLimit();
+        void    trim(qint64 limit);
+};
+
+#endif // DISKCACHE_H
@@ -0,0 +1,199 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "fader.h"
+
+
+Fader::Fader(QAudioFormat format)
+{
+    this->format = format;
+
+    channelCount = qMax(format.channelCount(), 1);
+    sampleBytes  = qMax(format.sampleSize() / 8, 1);
+
+    direction      = None;
+    durationFrames = 0;
+    positionFrames = 0;
+    finished       = false;
+
+    setCurve(Linear);
+}
+
+
+bool Fader::apply(char *data, int byteCount)
+{
+    if (direction == None) {
+        return false;
+    }
+
+    int frameCount = byteCount / (channelCount * sampleBytes);
+    if (frameCount > frameGains.size()) {
+        frameGains.resize(frameCount);
+    }
+
+    bool endsHere = false;
+
+    // curve points per frame, so the loop needs no division
+    double step = static_cast<double>(CURVE_POINTS) / durationFrames;
+
+    for (int frame = 0; frame < frameCount; frame++) {
+        double index = qMin((positionFrames + frame) * step, static_cast<double>(CURVE_POINTS));
+        if (direction == Out) {
+            index = CURVE_POINTS - index;
+        }
+
+        int previous = qMin(static_cast<int>(index), CURVE_POINTS - 1);
+
+        frameGains[frame] = curve[previous] + (curve[previous + 1] - curve[previous]) * static_cast<float>(index - previous);
+    }
+
+    if (format.sampleType() == QAudioFormat::SignedInt) {
+        switch (sampleBytes) {
+            case 1:
+                multiply<qint8, float>(reinterpret_cast<qint8 *>(data), frameCount, 0.0f);
+                break;
+            case 2:
+                if (channelCount == 2) {
+                    multiplyStereo16(reinterpret_cast<qint16 *>(data), frameCount);
+                    break;
+                }
+                multiply<qint16, float>(reinterpret_cast<qint16 *>(data), frameCount, 0.0f);
+                break;
+            case 4:
+                multiply<qint32, double>(reinterpret_cast<qint32 *>(data), frameCount, 0.0);
+                break;
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::UnSignedInt) {
+        switch (sampleBytes) {
+            case 1:
+                multiply<quint8, float>(reinterpret_cast<quint8 *>(data), frameCount, 128.0f);
+                break;
+            case 2:
+                multiply<quint16, float>(reinterpret_cast<quint16 *>(data), frameCount, 32768.0f);
+                break;
+            case 4:
+                multiply<quint32, double>(reinterpret_cast<quint32 *>(data), frameCount, 2147483648.0);
+                break;
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::Float) {
+        multiply<float, float>(reinterpret_cast<float *>(data), frameCount, 0.0f);
+    }
+
+    positionFrames += frameCount;
+    if (positionFrames >= durationFrames) {
+        positionFrames = durationFrames;
+
+        if (direction == In) {
+            direction = None;
+        }
+        else if (!finished) {
+            // stays faded out, so whatever comes after is silenced
+            finished = true;
+            endsHere = true;
+        }
+    }
+
+    return endsHere;
+}
+
+
+// a fade in interrupted by a fade out (or the other way around) continues from the current gain
+void Fader::fadeIn(qint64 durationMicroseconds)
+{
+    double startProgress = direction == Out ? 1.0 - progress() : 0.0;
+
+    direction      = In;
+    durationFrames = qMax(format.framesForDuration(durationMicroseconds), 1);
+    positionFrames = static_cast<qint64>(startProgress * durationFrames);
+    finished       = false;
+}
+
+
+void Fader::fadeOut(qint64 durationMicroseconds)
+{
+    double startProgress = direction == In ? 1.0 - progress() : 0.0;
+
+    direction      = Out;
+    durationFrames = qMax(format.framesForDuration(durationMicroseconds), 1);
+    positionFrames = static_cast<qint64>(startProgress * durationFrames);
+    finished       = false;
+}
+
+
+bool Fader::isFadingIn()
+{
+    return direction == In;
+}
+
+
+bool Fader::isFadingOut()
+{
+    return direction == Out;
+}
+
+
+bool Fader::isIdle()
+{
+    return direction == None;
+}
+
+
+// tracks play stereo 16 bit, four frames at a time in single precision, each frame's gain is duplicated for the two channels
+void Fader::multiplyStereo16(qint16 *samples, int frameCount)
+{
+    const float *gains = frameGains.constData();
+
+    #ifdef WAVER_SIMD_VECTOR
+        int vectorFrames = frameCount - frameCount % 4;
+    #else
+        // the scalar stand-ins are slower than the plain loop below
+        int vectorFrames = 0;
+    #endif
+
+    for (int frame = 0; frame < vectorFrames; frame += 4) {
+        ShortOcts octs      = octsLoad(samples + frame * 2);
+        FloatQuad frameGain = quadLoad(gains + frame);
+
+        FloatQuad low  = quadMul(octsLowToQuad(octs), quadDuplicateLow(frameGain));
+        FloatQuad high = quadMul(octsHighToQuad(octs), quadDuplicateHigh(frameGain));
+
+        octsStore(samples + frame * 2, quadsToOcts(low, high));
+    }
+
+    for (int frame = vectorFrames; frame < frameCount; frame++) {
+        samples[frame * 2]     = static_cast<qint16>(samples[frame * 2] * gains[frame]);
+        samples[frame * 2 + 1] = static_cast<qint16>(samples[frame * 2 + 1] * gains[frame]);
+    }
+}
+
+
+double Fader::progress()
+{
+    return durationFrames > 0 ? static_cast<double>(positionFrames) / durationFrames : 1.0;
+}
+
+
+// gain by fade in progress, fade out reads it backwards
+void Fader::setCurve(Curve curve)
+{
+    for (int i = 0; i <= CURVE_POINTS; i++) {
+        double position = static_cast<double>(i) / CURVE_POINTS;
+
+        switch (curve) {
+            case EqualPower:
+                this->curve[i] = static_cast<float>(qSin(position * M_PI / 2));
+                break;
+            case Logarithmic:
+                this->curve[i] = i == 0 ? 0.0f : static_cast<float>(qPow(10.0, (position - 1.0) * LOGARITHMIC_RANGE_DB / 20));
+                break;
+            default:
+                this->curve[i] = static_cast<float>(position);
+        }
+    }
+}
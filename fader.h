@@ -0,0 +1,91 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef FADER_H
+#define FADER_H
+
+#include <QAudioFormat>
+#include <QtGlobal>
+#include <QtMath>
+#include <QVector>
+
+#include "simd.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// gain ramp for fade in and fade out, the curve is computed once and interpolated for every frame
+class Fader
+{
+    public:
+
+        enum Curve {
+            Linear,
+            EqualPower,
+            Logarithmic
+        };
+
+        explicit Fader(QAudioFormat format);
+
+        void setCurve(Curve curve);
+        void fadeIn(qint64 durationMicroseconds);
+        void fadeOut(qint64 durationMicroseconds);
+
+        bool isIdle();
+        bool isFadingIn();
+        bool isFadingOut();
+
+        // true when the fade out ends in this chunk, everything after that is silent
+        bool apply(char *data, int byteCount);
+
+
+    private:
+
+        enum Direction {
+            None,
+            In,
+            Out
+        };
+
+        static const     int    CURVE_POINTS         = 1024;
+        static constexpr double LOGARITHMIC_RANGE_DB = 60.0;
+
+        QAudioFormat format;
+        int          channelCount;
+        int          sampleBytes;
+
+        float curve[CURVE_POINTS + 1];
+
+        Direction direction;
+        qint64    durationFrames;
+        qint64    positionFrames;
+        bool      finished;
+
+        QVector<float> frameGains;
+
+        double progress();
+        void   multiplyStereo16(qint16 *samples, int frameCount);
+
+        // G is float for samples that fit its precision, double for 32 bit integers
+        template <class T, class G> void multiply(T *samples, int frameCount, G offset)
+        {
+            const float *gains = frameGains.constData();
+
+            for (int frame = 0; frame < frameCount; frame++) {
+                G gain = gains[frame];
+                for (int channel = 0; channel < channelCount; channel++) {
+                    int i = frame * channelCount + channel;
+
+                    samples[i] = static_cast<T>((samples[i] - offset) * gain + offset);
+                }
+            }
+        }
+};
+
+#endif // FADER_H
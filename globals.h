@@ -39,11 +39,13 @@ static const int  DEFAULT_STARTING_INDEX_DAYS  = 30;
 static const QString DEFAULT_FADE_TAGS      = "live,medley,nonstop";
 static const QString DEFAULT_CROSSFADE_TAGS = "live";
 static const int     DEFAULT_FADE_SECONDS   = 7;
+static const int     DEFAULT_FADE_CURVE     = 0;
 
-static const int    DEFAULT_MAX_PEAK_FPS  = 25;
 static const bool   DEFAULT_PEAK_DELAY_ON = false;
 static const qint64 DEFAULT_PEAK_DELAY_MS = 333;
 
+static const int DEFAULT_SPECTRUM_BANDS = 32;
+
 static const bool   DEFAULT_EQON   = true;
 static const double DEFAULT_PREAMP = 0.0;
 static const double DEFAULT_EQ1    = 6.0;
@@ -57,9 +59,31 @@ static const double DEFAULT_EQ8    = 6.0;
 static const double DEFAULT_EQ9    = 9.0;
 static const double DEFAULT_EQ10   = 12.0;
 
-static const int  DEFAULT_WIDE_STEREO_DELAY_MILLISEC = 0;
-static const bool DEFAULT_SKIP_LONG_SILENCE          = true;
-static const int  DEFAULT_SKIP_LONG_SILENCE_SECONDS  = 4;
+static const double DEFAULT_WIDE_STEREO_DELAY_MILLISEC = 0.0;
+static const bool   DEFAULT_SKIP_LONG_SILENCE          = true;
+static const int    DEFAULT_SKIP_LONG_SILENCE_SECONDS  = 4;
+
+static const bool DEFAULT_PCM_DISK_CACHE    = false;
+static const int  DEFAULT_PCM_DISK_CACHE_MB = 2048;
+
+static const bool DEFAULT_COMPRESSED_DISK_CACHE    = false;
+static const int  DEFAULT_COMPRESSED_DISK_CACHE_MB = 4096;
+
+static const bool DEFAULT_R128_LOUDNESS = false;
+
+static const int DEFAULT_LOOK_AHEAD_TRACKS      = 2;
+static const int DEFAULT_LOOK_AHEAD_CPU_PERCENT = 25;
+
+static const bool DEFAULT_LIBRARY_SCAN = false;
+
+static const bool DEFAULT_SEGMENTED_ANALYSIS = false;
+
+static const bool DEFAULT_HTTP2            = true;
+static const int  DEFAULT_PREFETCH_TRACKS  = 2;
+static const int  DEFAULT_PREFETCH_MB      = 64;
+static const bool DEFAULT_ADAPTIVE_BITRATE = true;
+
+static const int DEFAULT_DOWNLOAD_CONNECTIONS = 4;
 
 static const double SILENCE_THRESHOLD_DB = -25;
 
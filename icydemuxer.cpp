@@ -0,0 +1,138 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "icydemuxer.h"
+
+
+IcyDemuxer::IcyDemuxer()
+{
+    metaInterval = 0;
+    audioCount   = 0;
+    metaSize     = -1;
+    metaCount    = 0;
+    metaBytes    = 0;
+}
+
+
+// audio ranges are appended to the rope, titles are returned with the audio position they belong to
+QVector<IcyDemuxer::Title> IcyDemuxer::demux(const QByteArray &data, ChunkRope *rope)
+{
+    QVector<Title> titles;
+
+    if (metaInterval <= 0) {
+        rope->append(data);
+        return titles;
+    }
+
+    const char *bytes   = data.constData();
+    int         length  = data.size();
+    int         pointer = 0;
+
+    while (pointer < length) {
+        // audio
+        if (audioCount < metaInterval) {
+            int increment = qMin(metaInterval - audioCount, length - pointer);
+
+            // most of the time the whole chunk is audio, then it's shared instead of copied
+            if (increment == length) {
+                rope->append(data);
+            }
+            else {
+                rope->append(bytes + pointer, increment);
+            }
+
+            pointer    += increment;
+            audioCount += increment;
+            continue;
+        }
+
+        // first byte of metadata is size of the rest of metadata divided by 16
+        if (metaSize < 0) {
+            metaSize  = 16 * static_cast<uchar>(bytes[pointer]);
+            metaCount = 0;
+            metaBuffer.clear();
+            metaBuffer.reserve(metaSize);
+
+            pointer++;
+            metaBytes++;
+        }
+
+        // downloaded data might not contain all the metadata, the rest will be in next download chunk
+        int increment = qMin(metaSize - metaCount, length - pointer);
+
+        metaBuffer.append(bytes + pointer, increment);
+
+        pointer   += increment;
+        metaCount += increment;
+        metaBytes += increment;
+
+        if (metaCount == metaSize) {
+            // many times metadata is empty, most stations send only on connection and track change
+            QString title;
+            if ((metaSize > 0) && parseTitle(&title)) {
+                titles.append({ rope->end(), title });
+            }
+
+            // prepare for audio data
+            audioCount = 0;
+            metaSize   = -1;
+        }
+    }
+
+    return titles;
+}
+
+
+qint64 IcyDemuxer::getMetaBytes() const
+{
+    return metaBytes;
+}
+
+
+bool IcyDemuxer::isActive() const
+{
+    return metaInterval > 0;
+}
+
+
+// StreamTitle='...'; the shortest match, same as the previous minimal regular expression
+bool IcyDemuxer::parseTitle(QString *title) const
+{
+    // function-local static is thread safe since C++11
+    static const QByteArrayMatcher startMatcher("StreamTitle='");
+    static const QByteArrayMatcher endMatcher("';");
+
+    int start = startMatcher.indexIn(metaBuffer);
+    if (start < 0) {
+        return false;
+    }
+    start += startMatcher.pattern().size();
+
+    int end = endMatcher.indexIn(metaBuffer, start + 1);
+    if (end < 0) {
+        return false;
+    }
+
+    // metadata is padded with zeros
+    int zero = metaBuffer.indexOf('\0', start);
+    if ((zero >= 0) && (zero < end)) {
+        return false;
+    }
+
+    *title = QString::fromUtf8(metaBuffer.constData() + start, end - start);
+    return true;
+}
+
+
+void IcyDemuxer::setMetaInterval(int metaInterval)
+{
+    this->metaInterval = metaInterval;
+
+    audioCount = 0;
+    metaSize   = -1;
+    metaCount  = 0;
+}
@@ -0,0 +1,55 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef ICYDEMUXER_H
+#define ICYDEMUXER_H
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QString>
+#include <QtGlobal>
+#include <QVector>
+
+#include "chunkrope.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// separates Shoutcast metadata from the audio in a single pass, audio goes straight to the rope
+class IcyDemuxer
+{
+    public:
+
+        struct Title {
+            qint64  position;
+            QString title;
+        };
+
+        IcyDemuxer();
+
+        void   setMetaInterval(int metaInterval);
+        bool   isActive() const;
+        qint64 getMetaBytes() const;
+
+        QVector<Title> demux(const QByteArray &data, ChunkRope *rope);
+
+
+    private:
+
+        int        metaInterval;
+        int        audioCount;
+        int        metaSize;
+        int        metaCount;
+        QByteArray metaBuffer;
+        qint64     metaBytes;
+
+        bool parseTitle(QString *title) const;
+};
+
+#endif // ICYDEMUXER_H
@@ -0,0 +1,220 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "libraryscanner.h"
+
+
+LibraryScanner::LibraryScanner(QObject *parent) : QObject(parent)
+{
+    fileScanner = nullptr;
+
+    // half the cores at most, the other half is left for playback and everything else
+    int workerCount = qBound(1, QThread::idealThreadCount() / 2, WORKERS_MAX);
+    for (int i = 0; i < workerCount; i++) {
+        LookAheadAnalyzer *worker = new LookAheadAnalyzer();
+        connect(worker, &LookAheadAnalyzer::jobFinished, this, &LibraryScanner::workerFinished);
+        workers.append(worker);
+    }
+
+    throttleTimer = new QTimer();
+    throttleTimer->setInterval(THROTTLE_CHECK_INTERVAL_MILLISECONDS);
+    connect(throttleTimer, &QTimer::timeout, this, &LibraryScanner::throttleCheck);
+}
+
+
+LibraryScanner::~LibraryScanner()
+{
+    stop();
+
+    foreach (LookAheadAnalyzer *worker, workers) {
+        disconnect(worker, &LookAheadAnalyzer::jobFinished, this, &LibraryScanner::workerFinished);
+        delete worker;
+    }
+
+    delete throttleTimer;
+}
+
+
+// files already in the analysis cache are skipped, so an interrupted scan continues where it stopped
+void LibraryScanner::dispatch()
+{
+    if (isThrottled()) {
+        return;
+    }
+
+    foreach (LookAheadAnalyzer *worker, workers) {
+        if (worker->isBusy()) {
+            continue;
+        }
+
+        while (filesToAnalyze.count() > 0) {
+            QString filePath = filesToAnalyze.takeFirst();
+            QString key      = Track::analysisCacheKey(Track::localFileCacheKey(filePath));
+
+            if (AnalysisCache::instance()->contains(key)) {
+                continue;
+            }
+
+            worker->setJobs({{ key, QUrl::fromLocalFile(filePath), false, 0.0 }});
+            break;
+        }
+    }
+
+    if ((filesToAnalyze.count() < 1) && (dirsToScan.count() > 0) && (fileScanner == nullptr)) {
+        scanNextDir();
+        return;
+    }
+
+    if ((filesToAnalyze.count() < 1) && (dirsToScan.count() < 1) && (fileScanner == nullptr)) {
+        foreach (LookAheadAnalyzer *worker, workers) {
+            if (worker->isBusy()) {
+                return;
+            }
+        }
+        throttleTimer->stop();
+    }
+}
+
+
+void LibraryScanner::fileScanFinished()
+{
+    disconnect(fileScanner, &FileScanner::finished, this, &LibraryScanner::fileScanFinished);
+
+    // depth first, so the files of one album are analyzed together
+    QStringList subDirs;
+    foreach (QFileInfo dir, fileScanner->getDirs()) {
+        subDirs.append(dir.absoluteFilePath());
+    }
+    dirsToScan = subDirs + dirsToScan;
+
+    foreach (QFileInfo file, fileScanner->getFiles()) {
+        filesToAnalyze.append(file.absoluteFilePath());
+    }
+
+    delete fileScanner;
+    fileScanner = nullptr;
+
+    dispatch();
+}
+
+
+bool LibraryScanner::isOnBattery()
+{
+    #ifdef Q_OS_LINUX
+        foreach (QFileInfo powerSupply, QDir("/sys/class/power_supply").entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            QFile type(QString("%1/type").arg(powerSupply.absoluteFilePath()));
+            if (!type.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            bool isBattery = type.readAll().trimmed().compare("Battery") == 0;
+            type.close();
+
+            if (!isBattery) {
+                continue;
+            }
+
+            QFile status(QString("%1/status").arg(powerSupply.absoluteFilePath()));
+            if (!status.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            bool isDischarging = status.readAll().trimmed().compare("Discharging") == 0;
+            status.close();
+
+            if (isDischarging) {
+                return true;
+            }
+        }
+    #endif
+
+    return false;
+}
+
+
+// load average and power source are known on Linux only, elsewhere idle priority and the CPU budget have to do
+bool LibraryScanner::isThrottled()
+{
+    if (isOnBattery()) {
+        return true;
+    }
+
+    #ifdef Q_OS_LINUX
+        QFile loadAverage("/proc/loadavg");
+        if (loadAverage.open(QIODevice::ReadOnly)) {
+            double load = QString(loadAverage.readAll()).split(" ").first().toDouble();
+            loadAverage.close();
+
+            // workers' own load is included
+            int busyWorkers = 0;
+            foreach (LookAheadAnalyzer *worker, workers) {
+                if (worker->isBusy()) {
+                    busyWorkers++;
+                }
+            }
+            if ((load - busyWorkers) / QThread::idealThreadCount() > LOAD_PER_CORE_LIMIT) {
+                return true;
+            }
+        }
+    #endif
+
+    return false;
+}
+
+
+void LibraryScanner::scanNextDir()
+{
+    fileScanner = new FileScanner(dirsToScan.takeFirst(), "");
+    connect(fileScanner, &FileScanner::finished, this, &LibraryScanner::fileScanFinished);
+
+    fileScanner->start(QThread::IdlePriority);
+}
+
+
+void LibraryScanner::start(QStringList dirs)
+{
+    stop();
+
+    dirsToScan = dirs;
+
+    throttleTimer->start();
+    dispatch();
+}
+
+
+void LibraryScanner::stop()
+{
+    throttleTimer->stop();
+
+    dirsToScan.clear();
+    filesToAnalyze.clear();
+
+    if (fileScanner != nullptr) {
+        disconnect(fileScanner, &FileScanner::finished, this, &LibraryScanner::fileScanFinished);
+        fileScanner->requestInterruption();
+        fileScanner->wait();
+        delete fileScanner;
+        fileScanner = nullptr;
+    }
+
+    foreach (LookAheadAnalyzer *worker, workers) {
+        worker->setJobs({});
+    }
+}
+
+
+// work that was held back by throttling is picked up here
+void LibraryScanner::throttleCheck()
+{
+    dispatch();
+}
+
+
+void LibraryScanner::workerFinished(QString key)
+{
+    Q_UNUSED(key);
+
+    dispatch();
+}
@@ -0,0 +1,73 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef LIBRARYSCANNER_H
+#define LIBRARYSCANNER_H
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QtGlobal>
+#include <QThread>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include "analysiscache.h"
+#include "filescanner.h"
+#include "lookaheadanalyzer.h"
+#include "track.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// walks the local music directories and analyzes every file that's not in the analysis cache yet
+class LibraryScanner : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        explicit LibraryScanner(QObject *parent = nullptr);
+        ~LibraryScanner();
+
+        void start(QStringList dirs);
+        void stop();
+
+
+    private:
+
+        static const     int    THROTTLE_CHECK_INTERVAL_MILLISECONDS = 5000;
+        static const     int    WORKERS_MAX                          = 4;
+        static constexpr double LOAD_PER_CORE_LIMIT                  = 0.75;
+
+        QStringList dirsToScan;
+        QStringList filesToAnalyze;
+
+        FileScanner                 *fileScanner;
+        QVector<LookAheadAnalyzer *> workers;
+        QTimer                      *throttleTimer;
+
+        void dispatch();
+        bool isOnBattery();
+        bool isThrottled();
+        void scanNextDir();
+
+
+    private slots:
+
+        void fileScanFinished();
+        void throttleCheck();
+        void workerFinished(QString key);
+};
+
+#endif // LIBRARYSCANNER_H
@@ -0,0 +1,242 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "lookaheadanalyzer.h"
+
+
+LookAheadAnalyzer::LookAheadAnalyzer(QObject *parent) : QObject(parent)
+{
+    decoderThread.setObjectName("lookaheaddecoder");
+    analyzerThread.setObjectName("lookaheadanalyzer");
+
+    // same format as tracks decode to, so silence timestamps are interchangeable
+    desiredPCMFormat.setByteOrder(QSysInfo::ByteOrder == QSysInfo::BigEndian ? QAudioFormat::BigEndian : QAudioFormat::LittleEndian);
+    desiredPCMFormat.setChannelCount(2);
+    desiredPCMFormat.setCodec("audio/pcm");
+    desiredPCMFormat.setSampleRate(44100);
+    desiredPCMFormat.setSampleSize(16);
+    desiredPCMFormat.setSampleType(QAudioFormat::SignedInt);
+
+    jobRunning          = false;
+    decoder             = nullptr;
+    analyzer            = nullptr;
+    workMicroseconds    = 0;
+    decodeDelay         = 0;
+    decodedMilliseconds = 0;
+    cpuBudgetPercent    = DEFAULT_LOOK_AHEAD_CPU_PERCENT;
+}
+
+
+LookAheadAnalyzer::~LookAheadAnalyzer()
+{
+    stopJob();
+}
+
+
+void LookAheadAnalyzer::analyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences)
+{
+    if (sender() != analyzer) {
+        return;
+    }
+
+    // analyzer ran for silences only if replay gain came from tags
+    if (currentJob.hasTagReplayGain) {
+        replayGain = currentJob.tagReplayGain;
+    }
+
+    AnalysisCache::instance()->store(currentJob.key, { replayGain, peak, silences, decodedMilliseconds });
+
+    QString key = currentJob.key;
+
+    stopJob();
+    emit jobFinished(key);
+
+    startNextJob();
+}
+
+
+void LookAheadAnalyzer::bufferAvailableFromDecoder(QAudioBuffer *buffer)
+{
+    // might be still in the event queue from a job that was already stopped
+    if ((sender() != decoder) || !jobRunning) {
+        delete buffer;
+        return;
+    }
+
+    // time between buffers is decoding work plus the delay, the delay is sized so the work stays within the budget
+    double work = static_cast<double>(bufferTimer.nsecsElapsed() / 1000) - decodeDelay;
+    bufferTimer.restart();
+    if (work < 0) {
+        work = 0;
+    }
+    workMicroseconds = (workMicroseconds * (1.0 - WORK_SMOOTHING)) + (work * WORK_SMOOTHING);
+
+    decodeDelay = qMin(static_cast<unsigned long>(workMicroseconds * (100 - cpuBudgetPercent) / cpuBudgetPercent), DECODE_DELAY_MAX_MICROSECONDS);
+    decoder->setDecodeDelay(decodeDelay);
+
+    analyzerQueueMutex.lock();
+    analyzerQueue.append(buffer);
+    analyzerQueueMutex.unlock();
+
+    emit bufferAvailableToAnalyzer();
+}
+
+
+void LookAheadAnalyzer::decoderError(QString info, QString errorMessage)
+{
+    Q_UNUSED(info);
+    Q_UNUSED(errorMessage);
+
+    if (sender() != decoder) {
+        return;
+    }
+
+    // the track will report the error itself when it's played
+    QString key = currentJob.key;
+
+    stopJob();
+    emit jobFinished(key);
+
+    startNextJob();
+}
+
+
+void LookAheadAnalyzer::decoderFinished()
+{
+    if (sender() != decoder) {
+        return;
+    }
+
+    decodedMilliseconds = decoder->getDecodedMicroseconds() / 1000;
+
+    emit decoderDone();
+}
+
+
+bool LookAheadAnalyzer::isBusy()
+{
+    return jobRunning;
+}
+
+
+// jobs are in playlist order, the running one continues if it's still wanted
+void LookAheadAnalyzer::setJobs(Jobs jobs)
+{
+    this->jobs.clear();
+
+    bool currentWanted = false;
+    foreach (Job job, jobs) {
+        if (jobRunning && (job.key.compare(currentJob.key) == 0)) {
+            currentWanted = true;
+            continue;
+        }
+        this->jobs.append(job);
+    }
+
+    if (jobRunning && !currentWanted) {
+        stopJob();
+    }
+    if (!jobRunning) {
+        startNextJob();
+    }
+}
+
+
+void LookAheadAnalyzer::startNextJob()
+{
+    if (jobs.count() < 1) {
+        return;
+    }
+
+    currentJob = jobs.first();
+    jobs.removeFirst();
+
+    QSettings settings;
+
+    decoder = new DecoderGeneric({ nullptr, nullptr });
+    decoder->setParameters(currentJob.url, desiredPCMFormat, 4096, false, true);
+    decoder->setDecodeDelay(0);
+    decoder->moveToThread(&decoderThread);
+
+    analyzer = new Analyzer(desiredPCMFormat);
+    analyzer->setBufferQueue(&analyzerQueue, &analyzerQueueMutex);
+    analyzer->setSilenceOnly(currentJob.hasTagReplayGain);
+    analyzer->setEngine(settings.value("options/r128_loudness", DEFAULT_R128_LOUDNESS).toBool() ? Analyzer::R128Engine : Analyzer::ReplayGainEngine);
+    analyzer->moveToThread(&analyzerThread);
+
+    connect(&decoderThread,  &QThread::started, decoder,  &DecoderGeneric::run);
+    connect(&analyzerThread, &QThread::started, analyzer, &Analyzer::run);
+
+    connect(decoder, &DecoderGeneric::bufferAvailable, this, &LookAheadAnalyzer::bufferAvailableFromDecoder);
+    connect(decoder, &DecoderGeneric::finished,        this, &LookAheadAnalyzer::decoderFinished);
+    connect(decoder, &DecoderGeneric::errorMessage,    this, &LookAheadAnalyzer::decoderError);
+
+    connect(analyzer, &Analyzer::analysisFinished, this, &LookAheadAnalyzer::analyzerFinished);
+
+    connect(this, &LookAheadAnalyzer::bufferAvailableToAnalyzer, analyzer, &Analyzer::bufferAvailable);
+    connect(this, &LookAheadAnalyzer::decoderDone,               analyzer, &Analyzer::decoderDone);
+    connect(this, &LookAheadAnalyzer::startDecode,               decoder,  &DecoderGeneric::start);
+
+    workMicroseconds    = 0;
+    decodeDelay         = 0;
+    decodedMilliseconds = 0;
+    jobRunning          = true;
+
+    // budget changes apply from the next job on, settings aren't read for every buffer
+    cpuBudgetPercent = qBound(1, settings.value("options/look_ahead_cpu_percent", DEFAULT_LOOK_AHEAD_CPU_PERCENT).toInt(), 100);
+
+    // never competes with the playing track
+    analyzerThread.start(QThread::IdlePriority);
+    decoderThread.start(QThread::IdlePriority);
+
+    bufferTimer.start();
+    emit startDecode();
+}
+
+
+void LookAheadAnalyzer::stopJob()
+{
+    jobRunning = false;
+
+    decoderThread.requestInterruption();
+    decoderThread.quit();
+    decoderThread.wait();
+    if (decoder != nullptr) {
+        disconnect(&decoderThread, &QThread::started, decoder, &DecoderGeneric::run);
+
+        disconnect(decoder, &DecoderGeneric::bufferAvailable, this, &LookAheadAnalyzer::bufferAvailableFromDecoder);
+        disconnect(decoder, &DecoderGeneric::finished,        this, &LookAheadAnalyzer::decoderFinished);
+        disconnect(decoder, &DecoderGeneric::errorMessage,    this, &LookAheadAnalyzer::decoderError);
+
+        disconnect(this, &LookAheadAnalyzer::startDecode, decoder, &DecoderGeneric::start);
+
+        delete decoder;
+        decoder = nullptr;
+    }
+
+    analyzerThread.requestInterruption();
+    analyzerThread.quit();
+    analyzerThread.wait();
+    if (analyzer != nullptr) {
+        disconnect(&analyzerThread, &QThread::started, analyzer, &Analyzer::run);
+
+        disconnect(analyzer, &Analyzer::analysisFinished, this, &LookAheadAnalyzer::analyzerFinished);
+
+        disconnect(this, &LookAheadAnalyzer::bufferAvailableToAnalyzer, analyzer, &Analyzer::bufferAvailable);
+        disconnect(this, &LookAheadAnalyzer::decoderDone,               analyzer, &Analyzer::decoderDone);
+
+        delete analyzer;
+        analyzer = nullptr;
+    }
+
+    analyzerQueueMutex.lock();
+    foreach (QAudioBuffer *buffer, analyzerQueue) {
+        delete buffer;
+    }
+    analyzerQueue.clear();
+    analyzerQueueMutex.unlock();
+}
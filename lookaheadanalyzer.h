@@ -0,0 +1,103 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef LOOKAHEADANALYZER_H
+#define LOOKAHEADANALYZER_H
+
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QObject>
+#include <QSettings>
+#include <QString>
+#include <QtGlobal>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+#include "analysiscache.h"
+#include "analyzer.h"
+#include "decodergeneric.h"
+#include "globals.h"
+#include "replaygaincalculator.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// decodes and analyzes tracks ahead of playback at idle priority, results go to the analysis cache
+class LookAheadAnalyzer : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        struct Job {
+            QString key;
+            QUrl    url;
+            bool    hasTagReplayGain;
+            double  tagReplayGain;
+        };
+        typedef QVector<Job> Jobs;
+
+        explicit LookAheadAnalyzer(QObject *parent = nullptr);
+        ~LookAheadAnalyzer();
+
+        void setJobs(Jobs jobs);
+        bool isBusy();
+
+
+    private:
+
+        static const     unsigned long DECODE_DELAY_MAX_MICROSECONDS = 200 * 1000;
+        static constexpr double        WORK_SMOOTHING                = 0.2;
+
+        QAudioFormat desiredPCMFormat;
+
+        Jobs jobs;
+        Job  currentJob;
+        bool jobRunning;
+
+        BufferQueue analyzerQueue;
+        QMutex      analyzerQueueMutex;
+
+        QThread decoderThread;
+        QThread analyzerThread;
+
+        DecoderGeneric *decoder;
+        Analyzer       *analyzer;
+
+        QElapsedTimer bufferTimer;
+        double        workMicroseconds;
+        unsigned long decodeDelay;
+        qint64        decodedMilliseconds;
+        int           cpuBudgetPercent;
+
+        void startNextJob();
+        void stopJob();
+
+
+    private slots:
+
+        void analyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences);
+        void bufferAvailableFromDecoder(QAudioBuffer *buffer);
+        void decoderError(QString info, QString errorMessage);
+        void decoderFinished();
+
+
+    signals:
+
+        void jobFinished(QString key);
+
+        void bufferAvailableToAnalyzer();
+        void decoderDone();
+        void startDecode();
+};
+
+#endif // LOOKAHEADANALYZER_H
@@ -0,0 +1,453 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "loudnesscalculator.h"
+
+
+// constructor
+LoudnessCalculator::LoudnessCalculator(IIRFilter::SampleTypes sampleType, int sampleRate, int channelCount)
+{
+    qRegisterMetaType<ReplayGainCalculator::Silences>("ReplayGainCalculator::Silences");
+
+    this->sampleType   = sampleType;
+    this->sampleRate   = sampleRate;
+    this->channelCount = qMax(channelCount, 1);
+
+    framesPerSubBlock = qMax(sampleRate / SUB_BLOCKS_PER_SECOND, 1);
+
+    // same threshold as the replay gain calculator's silence detector
+    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10);
+
+    calculateFilters();
+    calculateInterpolator();
+
+    reset();
+}
+
+
+// continues with the blocks of the segment that follows this one, blocks spanning the segment boundary are lost
+void LoudnessCalculator::append(LoudnessCalculator *next)
+{
+    qint64 frameOffset        = framesCount;
+    qint64 microsecondsOffset = framesToMicroseconds(frameOffset);
+
+    subBlockEnergies.append(next->subBlockEnergies);
+    momentaryEnergies.append(next->momentaryEnergies);
+
+    if (next->silences.count() > 0) {
+        // the next segment's beginning silence continues whatever this one ended with
+        if (!inSilence && (silences.count() > 0) && (next->beginningLoudFrame > 0)) {
+            inSilence    = true;
+            silenceStart = microsecondsOffset;
+        }
+        if (inSilence || (silences.count() == 0)) {
+            qint64 start = inSilence ? silenceStart : 0;
+            qint64 end   = qMax(framesToMicroseconds(frameOffset + next->beginningLoudFrame) - 1, static_cast<qint64>(0));
+
+            if (silences.count() == 0) {
+                silences.append({ ReplayGainCalculator::SilenceAtBeginning, start, end });
+                beginningLoudFrame = frameOffset + next->beginningLoudFrame;
+            }
+            else if (end - start >= SILENCE_MIN_MICROSEC) {
+                silences.append({ ReplayGainCalculator::SilenceIntermediate, start, end });
+            }
+        }
+
+        for (int i = 1; i < next->silences.count(); i++) {
+            ReplayGainCalculator::SilenceRange silence = next->silences.at(i);
+            silence.startMicroseconds += microsecondsOffset;
+            silence.endMicroseconds   += microsecondsOffset;
+            silences.append(silence);
+        }
+
+        inSilence    = next->inSilence;
+        silenceStart = next->silenceStart + microsecondsOffset;
+    }
+    else if (!inSilence && (next->framesCount > 0)) {
+        // the whole next segment is silent
+        inSilence    = true;
+        silenceStart = microsecondsOffset;
+    }
+
+    framesCount += next->framesCount;
+    samplePeak   = qMax(samplePeak, next->samplePeak);
+    truePeak     = qMax(truePeak, next->truePeak);
+}
+
+
+// gain to bring integrated loudness to the reference level, same meaning as replay gain
+double LoudnessCalculator::calculateResult()
+{
+    double integrated = getIntegratedLoudness();
+    if (integrated <= ABSOLUTE_GATE) {
+        return 0.0;
+    }
+    return REFERENCE_LOUDNESS - integrated;
+}
+
+
+// K-weighting coefficients for any sample rate, BS.1770 only lists them for 48kHz
+void LoudnessCalculator::calculateFilters()
+{
+    double frequency = 1681.974450955533;
+    double gain      = 3.999843853973347;
+    double Q         = 0.7071752369554196;
+
+    double K  = tan(M_PI * frequency / sampleRate);
+    double Vh = pow(10.0, gain / 20.0);
+    double Vb = pow(Vh, 0.4996667741545416);
+    double a0 = 1.0 + K / Q + K * K;
+
+    double shelfCoefficients[2][3] = {
+        { (Vh + Vb * K / Q + K * K) / a0, 2.0 * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0 },
+        { 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 }
+    };
+
+    frequency = 38.13547087602444;
+    Q         = 0.5003270373238773;
+
+    K  = tan(M_PI * frequency / sampleRate);
+    a0 = 1.0 + K / Q + K * K;
+
+    double highPassCoefficients[2][3] = {
+        { 1.0, -2.0, 1.0 },
+        { 1.0, 2.0 * (K * K - 1.0) / a0, (1.0 - K / Q + K * K) / a0 }
+    };
+
+    for (int i = 0; i < 3; i++) {
+        for (int channel = 0; channel < 2; channel++) {
+            shelfB[i][channel]    = shelfCoefficients[0][i];
+            shelfA[i][channel]    = shelfCoefficients[1][i];
+            highPassB[i][channel] = highPassCoefficients[0][i];
+            highPassA[i][channel] = highPassCoefficients[1][i];
+        }
+    }
+}
+
+
+// windowed sinc low pass split into polyphase components
+void LoudnessCalculator::calculateInterpolator()
+{
+    int    tapCount = OVERSAMPLING * TAPS_PER_PHASE;
+    double center   = (tapCount - 1) / 2.0;
+
+    for (int tap = 0; tap < tapCount; tap++) {
+        double x      = (tap - center) / OVERSAMPLING;
+        double sinc   = fabs(x) < 1e-9 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+        double window = 0.5 - 0.5 * cos(2.0 * M_PI * (tap + 0.5) / tapCount);
+
+        interpolator[tap / OVERSAMPLING][tap % OVERSAMPLING] = sinc * window;
+    }
+}
+
+
+double LoudnessCalculator::energyToLoudness(double energy)
+{
+    if (energy <= 0) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    return LOUDNESS_OFFSET + 10.0 * log10(energy);
+}
+
+
+// closes a 100ms sub-block: gating block bookkeeping and silence detection
+void LoudnessCalculator::finishSubBlock()
+{
+    qint64 subBlockStartFrame = framesCount - subBlockFrames;
+
+    subBlockEnergies.append(subBlockSum / subBlockFrames);
+
+    // 400ms momentary blocks overlap by 75%
+    if (subBlockEnergies.count() >= MOMENTARY_SUB_BLOCKS) {
+        double energy = 0;
+        for (int i = subBlockEnergies.count() - MOMENTARY_SUB_BLOCKS; i < subBlockEnergies.count(); i++) {
+            energy += subBlockEnergies.at(i);
+        }
+        momentaryEnergies.append(energy / MOMENTARY_SUB_BLOCKS);
+    }
+
+    // silence detector works on whole sub-blocks, so ranges are rounded inwards to sub-block boundaries
+    if (subBlockPeak <= silenceThreshold) {
+        if (!inSilence) {
+            inSilence    = true;
+            silenceStart = framesToMicroseconds(subBlockStartFrame);
+        }
+    }
+    else if (inSilence || (silences.count() == 0)) {
+        qint64 start = inSilence ? silenceStart : 0;
+        qint64 end   = qMax(framesToMicroseconds(subBlockStartFrame) - 1, static_cast<qint64>(0));
+
+        if (silences.count() == 0) {
+            silences.append({ ReplayGainCalculator::SilenceAtBeginning, start, end });
+            beginningLoudFrame = subBlockStartFrame;
+        }
+        else if (end - start >= SILENCE_MIN_MICROSEC) {
+            silences.append({ ReplayGainCalculator::SilenceIntermediate, start, end });
+        }
+        inSilence = false;
+    }
+
+    subBlockFrames = 0;
+    subBlockSum    = 0;
+    subBlockPeak   = 0;
+}
+
+
+qint64 LoudnessCalculator::framesToMicroseconds(qint64 frames)
+{
+    return static_cast<qint64>(floor(static_cast<double>(frames) / sampleRate * 1000000));
+}
+
+
+// gated integrated loudness of the whole track so far
+double LoudnessCalculator::getIntegratedLoudness()
+{
+    double absoluteGate = loudnessToEnergy(ABSOLUTE_GATE);
+
+    double sum   = 0;
+    int    count = 0;
+    foreach (double energy, momentaryEnergies) {
+        if (energy >= absoluteGate) {
+            sum += energy;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return ABSOLUTE_GATE;
+    }
+
+    double relativeGate = qMax(sum / count * pow(10.0, INTEGRATED_RELATIVE_GATE / 10.0), absoluteGate);
+
+    sum   = 0;
+    count = 0;
+    foreach (double energy, momentaryEnergies) {
+        if (energy >= relativeGate) {
+            sum += energy;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return ABSOLUTE_GATE;
+    }
+
+    return energyToLoudness(sum / count);
+}
+
+
+// loudness range from 3s short-term blocks taken at 10Hz
+double LoudnessCalculator::getLoudnessRange()
+{
+    QVector<double> shortTermEnergies;
+
+    double window = 0;
+    for (int i = 0; i < subBlockEnergies.count(); i++) {
+        window += subBlockEnergies.at(i);
+        if (i >= SHORT_TERM_SUB_BLOCKS) {
+            window -= subBlockEnergies.at(i - SHORT_TERM_SUB_BLOCKS);
+        }
+        if (i >= SHORT_TERM_SUB_BLOCKS - 1) {
+            shortTermEnergies.append(window / SHORT_TERM_SUB_BLOCKS);
+        }
+    }
+
+    double absoluteGate = loudnessToEnergy(ABSOLUTE_GATE);
+
+    double sum   = 0;
+    int    count = 0;
+    foreach (double energy, shortTermEnergies) {
+        if (energy >= absoluteGate) {
+            sum += energy;
+            count++;
+        }
+    }
+    if (count == 0) {
+        return 0.0;
+    }
+
+    double relativeGate = qMax(sum / count * pow(10.0, RANGE_RELATIVE_GATE / 10.0), absoluteGate);
+
+    QVector<double> loudnesses;
+    foreach (double energy, shortTermEnergies) {
+        if (energy >= relativeGate) {
+            loudnesses.append(energyToLoudness(energy));
+        }
+    }
+    if (loudnesses.count() == 0) {
+        return 0.0;
+    }
+
+    std::sort(loudnesses.begin(), loudnesses.end());
+
+    int low  = qRound((loudnesses.count() - 1) * RANGE_LOW_PERCENTILE);
+    int high = qRound((loudnesses.count() - 1) * RANGE_HIGH_PERCENTILE);
+
+    return loudnesses.at(high) - loudnesses.at(low);
+}
+
+
+// only the silences found since the previous call
+ReplayGainCalculator::Silences LoudnessCalculator::getNewSilences(bool addFinalSilence)
+{
+    ReplayGainCalculator::Silences newSilences = silences.mid(silencesDelivered);
+    silencesDelivered = silences.count();
+
+    if (addFinalSilence && inSilence) {
+        newSilences.append({ ReplayGainCalculator::SilenceAtEnd, silenceStart, framesToMicroseconds(framesCount - 1) });
+    }
+
+    return newSilences;
+}
+
+
+// true peak, linear
+double LoudnessCalculator::getPeak()
+{
+    return qMax(samplePeak, truePeak);
+}
+
+
+ReplayGainCalculator::Silences LoudnessCalculator::getSilences(bool addFinalSilence)
+{
+    ReplayGainCalculator::Silences aCopy(silences);
+
+    if (addFinalSilence && inSilence) {
+        aCopy.append({ ReplayGainCalculator::SilenceAtEnd, silenceStart, framesToMicroseconds(framesCount - 1) });
+    }
+
+    return aCopy;
+}
+
+
+double LoudnessCalculator::loudnessToEnergy(double loudness)
+{
+    return pow(10.0, (loudness - LOUDNESS_OFFSET) / 10.0);
+}
+
+
+void LoudnessCalculator::processFrame(double left, double right)
+{
+    // both channels at once
+    DoublePair x = pairSet(left, right);
+
+    // K-weighting
+    DoublePair y = pairAdd(pairMul(pairLoad(shelfB[0]), x), pairLoad(shelfState[0]));
+    pairStore(shelfState[0], pairAdd(pairSub(pairMul(pairLoad(shelfB[1]), x), pairMul(pairLoad(shelfA[1]), y)), pairLoad(shelfState[1])));
+    pairStore(shelfState[1], pairSub(pairMul(pairLoad(shelfB[2]), x), pairMul(pairLoad(shelfA[2]), y)));
+
+    DoublePair z = pairAdd(pairMul(pairLoad(highPassB[0]), y), pairLoad(highPassState[0]));
+    pairStore(highPassState[0], pairAdd(pairSub(pairMul(pairLoad(highPassB[1]), y), pairMul(pairLoad(highPassA[1]), z)), pairLoad(highPassState[1])));
+    pairStore(highPassState[1], pairSub(pairMul(pairLoad(highPassB[2]), y), pairMul(pairLoad(highPassA[2]), z)));
+
+    double energies[2];
+    pairStore(energies, pairMul(z, z));
+    subBlockSum += energies[0] + energies[1];
+
+    // sample peak
+    double levels[2];
+    pairStore(levels, pairAbs(x));
+    subBlockPeak = qMax(subBlockPeak, qMax(levels[0], levels[1]));
+    samplePeak   = qMax(samplePeak, subBlockPeak);
+
+    history[0][historyPosition]                  = left;
+    history[0][historyPosition + TAPS_PER_PHASE] = left;
+    history[1][historyPosition]                  = right;
+    history[1][historyPosition + TAPS_PER_PHASE] = right;
+
+    historyPosition = (historyPosition + 1) % TAPS_PER_PHASE;
+
+    // inter-sample peaks are only looked for around samples that are loud enough to possibly raise the current true peak
+    int middle = historyPosition + TAPS_PER_PHASE / 2;
+    for (int channel = 0; channel < 2; channel++) {
+        if ((fabs(history[channel][middle]) < truePeak * TRUE_PEAK_SKIP_RATIO) && (fabs(history[channel][middle - 1]) < truePeak * TRUE_PEAK_SKIP_RATIO)) {
+            continue;
+        }
+
+        // history[historyPosition + TAPS_PER_PHASE - 1] is the newest sample, two phases are computed at once
+        const double *window = &history[channel][historyPosition];
+        DoublePair    interpolated[OVERSAMPLING / 2];
+        for (int pair = 0; pair < OVERSAMPLING / 2; pair++) {
+            interpolated[pair] = pairBroadcast(0.0);
+        }
+        for (int tap = 0; tap < TAPS_PER_PHASE; tap++) {
+            DoublePair sample = pairBroadcast(window[TAPS_PER_PHASE - 1 - tap]);
+            for (int pair = 0; pair < OVERSAMPLING / 2; pair++) {
+                interpolated[pair] = pairAdd(interpolated[pair], pairMul(pairLoad(&interpolator[tap][pair * 2]), sample));
+            }
+        }
+
+        DoublePair peaks = pairAbs(interpolated[0]);
+        for (int pair = 1; pair < OVERSAMPLING / 2; pair++) {
+            peaks = pairMax(peaks, pairAbs(interpolated[pair]));
+        }
+
+        double phasePeaks[2];
+        pairStore(phasePeaks, peaks);
+        truePeak = qMax(truePeak, qMax(phasePeaks[0], phasePeaks[1]));
+    }
+
+    framesCount++;
+    subBlockFrames++;
+    if (subBlockFrames >= framesPerSubBlock) {
+        finishSubBlock();
+    }
+}
+
+
+void LoudnessCalculator::processPCMData(const void *data, int byteCount)
+{
+    switch (sampleType) {
+        case IIRFilter::Unknown:
+            break;
+        case IIRFilter::int8Sample:
+            processSamples<qint8>(data, byteCount, 0, 1.0 / 128);
+            break;
+        case IIRFilter::uint8Sample:
+            processSamples<quint8>(data, byteCount, 128, 1.0 / 128);
+            break;
+        case IIRFilter::int16Sample:
+            processSamples<qint16>(data, byteCount, 0, 1.0 / 32768);
+            break;
+        case IIRFilter::uint16Sample:
+            processSamples<quint16>(data, byteCount, 32768, 1.0 / 32768);
+            break;
+        case IIRFilter::int32Sample:
+            processSamples<qint32>(data, byteCount, 0, 1.0 / 2147483648.0);
+            break;
+        case IIRFilter::uint32Sample:
+            processSamples<quint32>(data, byteCount, 2147483648.0, 1.0 / 2147483648.0);
+            break;
+        case IIRFilter::floatSample:
+            processSamples<float>(data, byteCount, 0, 1.0);
+            break;
+    }
+}
+
+
+void LoudnessCalculator::reset()
+{
+    memset(shelfState, 0, sizeof(shelfState));
+    memset(highPassState, 0, sizeof(highPassState));
+    memset(history, 0, sizeof(history));
+    historyPosition = 0;
+
+    subBlockFrames = 0;
+    subBlockSum    = 0;
+    subBlockPeak   = 0;
+    framesCount    = 0;
+
+    subBlockEnergies.clear();
+    momentaryEnergies.clear();
+
+    inSilence          = false;
+    silenceStart       = 0;
+    beginningLoudFrame = 0;
+    silencesDelivered  = 0;
+    samplePeak         = 0;
+    truePeak           = 0;
+
+    silences.clear();
+}
@@ -0,0 +1,121 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef LOUDNESSCALCULATOR_H
+#define LOUDNESSCALCULATOR_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QVector>
+
+#include <algorithm>
+#include <limits>
+
+#include <iirfilter.h>
+
+#include "globals.h"
+#include "replaygaincalculator.h"
+#include "simd.h"
+
+
+// EBU R128 / ITU-R BS.1770 loudness, processes whole buffers instead of one sample per callback
+class LoudnessCalculator {
+
+    public:
+
+        LoudnessCalculator(IIRFilter::SampleTypes sampleType, int sampleRate, int channelCount);
+
+        void processPCMData(const void *data, int byteCount);
+
+        double                         calculateResult();
+        double                         getIntegratedLoudness();
+        double                         getLoudnessRange();
+        double                         getPeak();
+        ReplayGainCalculator::Silences getSilences(bool addFinalSilence);
+        ReplayGainCalculator::Silences getNewSilences(bool addFinalSilence);
+        void                           append(LoudnessCalculator *next);
+        void                           reset();
+
+
+    private:
+
+        static constexpr double REFERENCE_LOUDNESS       = -18.0;
+        static constexpr double LOUDNESS_OFFSET          = -0.691;
+        static constexpr double ABSOLUTE_GATE            = -70.0;
+        static constexpr double INTEGRATED_RELATIVE_GATE = -10.0;
+        static constexpr double RANGE_RELATIVE_GATE      = -20.0;
+        static constexpr double RANGE_LOW_PERCENTILE     = 0.10;
+        static constexpr double RANGE_HIGH_PERCENTILE    = 0.95;
+        static constexpr double TRUE_PEAK_SKIP_RATIO     = 0.5;
+        static const     int    SUB_BLOCKS_PER_SECOND    = 10;
+        static const     int    MOMENTARY_SUB_BLOCKS     = 4;
+        static const     int    SHORT_TERM_SUB_BLOCKS    = 30;
+        static const     int    OVERSAMPLING             = 4;
+        static const     int    TAPS_PER_PHASE           = 12;
+        static const     int    SILENCE_MIN_MICROSEC     = 2750000;
+
+        IIRFilter::SampleTypes sampleType;
+        int                    sampleRate;
+        int                    channelCount;
+
+        // K-weighting: high shelf then high pass, transposed direct form II
+        // every coefficient is there for both channels and the states are interleaved, so the two channels are filtered together
+        double shelfB[3][2];
+        double shelfA[3][2];
+        double highPassB[3][2];
+        double highPassA[3][2];
+        double shelfState[2][2];
+        double highPassState[2][2];
+
+        // 4x oversampling interpolator, the phases of a tap are next to each other so they're computed together
+        // history is stored twice so every phase reads a contiguous window
+        double interpolator[TAPS_PER_PHASE][OVERSAMPLING];
+        double history[2][TAPS_PER_PHASE * 2];
+        int    historyPosition;
+
+        int    framesPerSubBlock;
+        int    subBlockFrames;
+        double subBlockSum;
+        double subBlockPeak;
+        qint64 framesCount;
+
+        QVector<double> subBlockEnergies;
+        QVector<double> momentaryEnergies;
+
+        double silenceThreshold;
+        bool   inSilence;
+        qint64 silenceStart;
+        qint64 beginningLoudFrame;
+        int    silencesDelivered;
+        double samplePeak;
+        double truePeak;
+
+        ReplayGainCalculator::Silences silences;
+
+        void   calculateFilters();
+        void   calculateInterpolator();
+        void   finishSubBlock();
+        void   processFrame(double left, double right);
+        double energyToLoudness(double energy);
+        double loudnessToEnergy(double loudness);
+        qint64 framesToMicroseconds(qint64 frames);
+
+        template <class T> void processSamples(const void *data, int byteCount, double offset, double scale)
+        {
+            const T *samples     = static_cast<const T *>(data);
+            int      sampleCount = byteCount / sizeof(T);
+
+            // the first two channels only, mono is counted on both sides just like it's played
+            for (int i = 0; i + channelCount <= sampleCount; i += channelCount) {
+                double left  = (static_cast<double>(samples[i]) - offset) * scale;
+                double right = channelCount > 1 ? (static_cast<double>(samples[i + 1]) - offset) * scale : left;
+                processFrame(left, right);
+            }
+        }
+};
+
+#endif // LOUDNESSCALCULATOR_H
@@ -0,0 +1,103 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "networkpool.h"
+
+
+NetworkPool::NetworkPool() : QObject(nullptr)
+{
+    #ifndef QT_NO_SSL
+        // session tickets are kept, so connecting to the same server again can skip the full handshake
+        sslConfiguration = QSslConfiguration::defaultConfiguration();
+        sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionPersistence, false);
+        sslConfiguration.setSslOption(QSsl::SslOptionDisableSessionSharing, false);
+    #endif
+
+    thread.setObjectName("networkpool");
+    moveToThread(&thread);
+    thread.start();
+}
+
+
+// sources still waiting for deletion are deleted when the thread finishes
+NetworkPool::~NetworkPool()
+{
+    thread.quit();
+    thread.wait();
+}
+
+
+NetworkPool *NetworkPool::instance()
+{
+    // function-local static is thread safe since C++11
+    static NetworkPool pool;
+    return &pool;
+}
+
+
+// opens the connection now, the request that comes later finds it ready in the manager's pool
+void NetworkPool::connectToHost(QUrl url)
+{
+    if (url.isLocalFile() || url.host().isEmpty()) {
+        return;
+    }
+
+    if (url.scheme().compare("https", Qt::CaseInsensitive) == 0) {
+        #ifndef QT_NO_SSL
+            manager()->connectToHostEncrypted(url.host(), static_cast<quint16>(url.port(443)), sslConfiguration);
+        #endif
+        return;
+    }
+
+    manager()->connectToHost(url.host(), static_cast<quint16>(url.port(80)));
+}
+
+
+// sources must be deleted on the thread they live on, the caller doesn't wait for it, the thread might be stopping already when the application exits
+void NetworkPool::deleteSource(QObject *source)
+{
+    if (source == nullptr) {
+        return;
+    }
+
+    source->deleteLater();
+}
+
+
+QNetworkAccessManager *NetworkPool::manager()
+{
+    if (!managers.hasLocalData()) {
+        managers.setLocalData(new QNetworkAccessManager());
+    }
+    return managers.localData();
+}
+
+
+// can be called from any thread
+void NetworkPool::preconnect(QUrl url)
+{
+    QMetaObject::invokeMethod(this, "connectToHost", Qt::QueuedConnection, Q_ARG(QUrl, url));
+}
+
+
+void NetworkPool::prepareRequest(QNetworkRequest *request)
+{
+    QSettings settings;
+    request->setAttribute(QNetworkRequest::Http2AllowedAttribute, settings.value("options/http2", DEFAULT_HTTP2).toBool());
+
+    #ifndef QT_NO_SSL
+        if (request->url().scheme().compare("https", Qt::CaseInsensitive) == 0) {
+            request->setSslConfiguration(sslConfiguration);
+        }
+    #endif
+}
+
+
+QThread *NetworkPool::sourceThread()
+{
+    return &thread;
+}
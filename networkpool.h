@@ -0,0 +1,70 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef NETWORKPOOL_H
+#define NETWORKPOOL_H
+
+#include <QMetaObject>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QSettings>
+#include <QThread>
+#include <QThreadStorage>
+#include <QUrl>
+
+#ifndef QT_NO_SSL
+    #include <QSslConfiguration>
+#endif
+
+#include "globals.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// network access shared by all tracks, so kept-alive connections and TLS sessions are reused instead of being torn down with every decoder
+class NetworkPool : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        static NetworkPool *instance();
+
+        ~NetworkPool();
+
+        // network access manager is not thread safe, every thread gets its own, connections are pooled within it
+        QNetworkAccessManager *manager();
+
+        // all network sources run on this one thread
+        QThread *sourceThread();
+
+        void prepareRequest(QNetworkRequest *request);
+        void preconnect(QUrl url);
+        void deleteSource(QObject *source);
+
+
+    private:
+
+        QThread                                 thread;
+        QThreadStorage<QNetworkAccessManager *> managers;
+
+        #ifndef QT_NO_SSL
+            QSslConfiguration sslConfiguration;
+        #endif
+
+        NetworkPool();
+
+
+    private slots:
+
+        void connectToHost(QUrl url);
+};
+
+#endif // NETWORKPOOL_H
@@ -18,7 +18,10 @@
 #include <QThread>
 #include <QTimer>
 
-#include "peakcallback.h"
+#include "blockmeter.h"
+#include "peakring.h"
+#include "spectrumtap.h"
+#include "widestereodelay.h"
 
 #ifdef QT_DEBUG
     #include <QDebug>
@@ -31,47 +34,32 @@ class OutputFeeder : public QObject
 
     public:
 
-        explicit OutputFeeder(QByteArray *outputBuffer, QMutex *outputBufferMutex, QAudioFormat audioFormat, QAudioOutput *audioOutput, PeakCallback::PeakCallbackInfo peakCallbackInfo, QObject *parent = nullptr);
+        explicit OutputFeeder(QByteArray *outputBuffer, QMutex *outputBufferMutex, QAudioFormat audioFormat, QAudioOutput *audioOutput, void *meterSource, QObject *parent = nullptr);
 
         void setOutputDevice(QIODevice *outputDevice);
-        void setWideStereoDelayMillisec(int wideStereoDelayMillisec);
+        void setWideStereoDelayMillisec(double wideStereoDelayMillisec);
 
 
     private:
 
-        static const qint64 MICROSECONDS_PER_SECOND        = 1000 * 1000;
-        static const int    WIDE_STEREO_DELAY_MILLISEC_MAX = 50;
+        static constexpr double WIDE_STEREO_DELAY_MILLISEC_MAX = 50.0;
 
         QAudioOutput *audioOutput;
         QByteArray   *outputBuffer;
         QMutex       *outputBufferMutex;
         QIODevice    *outputDevice;
 
-        QAudioFormat                   audioFormat;
-        PeakCallback::PeakCallbackInfo peakCallbackInfo;
+        QAudioFormat  audioFormat;
+        void         *meterSource;
 
         QMutex outputDeviceMutex;
-        QMutex peakDelaySumMutex;
-
-        int channelCount;
-        int channelIndex;
-        int frameCount;
-        int dataType;
-        int dataBytes;
-
-        double int16Min;
-        double int16Max;
-        double int16Range;
-        double sampleMin;
-        double sampleRange;
-
-        double  lPeak;
-        double  rPeak;
-        qint64  peakDelaySum;
-
-        int    wideStereoDelayMillisec;
-        int    newWideStereoDelayMillisec;
-        QMutex wideStereoDelayMutex;
+
+        int bytesPerFrame;
+
+        WideStereoDelay wideStereoDelay;
+        double          wideStereoDelayMillisec;
+        double          newWideStereoDelayMillisec;
+        QMutex          wideStereoDelayMutex;
 
 
     public slots:
@@ -15,16 +15,39 @@ PCMCache::PCMCache(QAudioFormat format, long lengthMilliseconds, bool radioStati
 
     file                  = nullptr;
     memory                = nullptr;
+    mappedFile            = nullptr;
+    mapped                = nullptr;
+    mappedSize            = 0;
     memoryRealSize        = 0;
     maxSize               = 0;
     readPosition          = 0;
     radioFakeReadPosition = 0;
+    writePosition         = 0;
+    sparse                = false;
+    gapSignaled           = -1;
     unfullfilledRequest   = false;
+    memoryRole            = PCMMemoryBudget::Preloaded;
+    diskCacheFeedPosition = 0;
 }
 
 
 PCMCache::~PCMCache()
 {
+    PCMMemoryBudget::instance()->releaseMemory(this);
+
+    if (mappedFile != nullptr) {
+        mutex.lock();
+        mappedFile->unmap(mapped);
+        mappedFile->close();
+        mutex.unlock();
+
+        delete mappedFile;
+        mappedFile = nullptr;
+        mapped     = nullptr;
+
+        return;
+    }
+
     if (file != nullptr) {
         if (file->isOpen()) {
             mutex.lock();
@@ -50,50 +73,118 @@ PCMCache::~PCMCache()
 }
 
 
-long PCMCache::availableMemory()
+// ranges are kept sorted and merged, there are only a few of them even after lots of seeking
+void PCMCache::addFilledRange(qint64 start, qint64 end)
 {
-#if defined (Q_OS_WIN)
+    int i = 0;
+    while ((i < filledRanges.count()) && (filledRanges.at(i).end < start)) {
+        i++;
+    }
+
+    if ((i >= filledRanges.count()) || (filledRanges.at(i).start > end)) {
+        filledRanges.insert(i, { start, end });
+        return;
+    }
 
-    MEMORYSTATUSEX memoryStatus;
+    filledRanges[i].start = qMin(filledRanges.at(i).start, start);
+    filledRanges[i].end   = qMax(filledRanges.at(i).end, end);
+
+    while ((i + 1 < filledRanges.count()) && (filledRanges.at(i + 1).start <= filledRanges.at(i).end)) {
+        filledRanges[i].end = qMax(filledRanges.at(i).end, filledRanges.at(i + 1).end);
+        filledRanges.remove(i + 1);
+    }
+}
 
-    ZeroMemory(&memoryStatus, sizeof(MEMORYSTATUSEX));
-    memoryStatus.dwLength = sizeof(MEMORYSTATUSEX);
 
-    if (GlobalMemoryStatusEx(&memoryStatus)) {
-        quint64 availPhys = memoryStatus.ullAvailPhys;
-        long    longMax   = (std::numeric_limits<long>::max)();
+QFile *PCMCache::createTemporaryFile()
+{
+    QFile *temporaryFile = new QFile(QString("%1/waver_%2").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), QUuid::createUuid().toString(QUuid::Id128)));
 
-        return (availPhys > static_cast<DWORD>(longMax) ? longMax : static_cast<long>(availPhys));
+    if (!temporaryFile->open(QIODevice::ReadWrite)) {
+        emit error(tr("Can not create temporary file, using memory"), temporaryFile->errorString());
+        delete temporaryFile;
+        return nullptr;
     }
 
-#elif defined (Q_OS_LINUX)
+    return temporaryFile;
+}
 
-    QFile   memInfo("/proc/meminfo");
-    QRegExp availableRegExp("^MemAvailable:\\s+(\\d+)");
 
-    if (memInfo.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QByteArray memInfoContents = memInfo.readAll();
-        memInfo.close();
+void PCMCache::demoteToFile()
+{
+    // called by the memory budget when a playing track needs the memory this preloaded track holds
+    mutex.lock();
 
-        QString availableMemoryString;
+    if ((file != nullptr) || (memory == nullptr) || radioStation) {
+        mutex.unlock();
+        PCMMemoryBudget::instance()->demoted(this, false);
+        return;
+    }
 
-        foreach (QString line, QString(memInfoContents).split("\n")) {
-            if (availableRegExp.indexIn(line) >= 0) {
-                availableMemoryString = availableRegExp.cap(1);
-                break;
-            }
+    QFile *temporaryFile = createTemporaryFile();
+    if (temporaryFile == nullptr) {
+        mutex.unlock();
+        PCMMemoryBudget::instance()->demoted(this, false);
+        return;
+    }
+
+    if (temporaryFile->write(memory->constData(), memoryRealSize) != memoryRealSize) {
+        temporaryFile->close();
+        temporaryFile->remove();
+        delete temporaryFile;
+
+        mutex.unlock();
+        PCMMemoryBudget::instance()->demoted(this, false);
+        return;
+    }
+
+    file = temporaryFile;
+
+    delete memory;
+    memory         = nullptr;
+    memoryRealSize = 0;
+
+    mutex.unlock();
+
+    PCMMemoryBudget::instance()->demoted(this, true);
+}
+
+
+// range containing the position, empty range at the position if there's none
+PCMCache::FilledRange PCMCache::filledRangeAt(qint64 position)
+{
+    foreach (FilledRange filledRange, filledRanges) {
+        if ((position >= filledRange.start) && (position < filledRange.end)) {
+            return filledRange;
         }
+    }
+    return { position, position };
+}
+
 
-        bool OK = false;
-        long availableMemoryKB = availableMemoryString.toLong(&OK);
-        if (OK) {
-            return availableMemoryKB * 1024;
+// last range that ends before the position, empty range at the beginning if there's none
+PCMCache::FilledRange PCMCache::filledRangeBefore(qint64 position)
+{
+    FilledRange returnValue = { 0, 0 };
+    foreach (FilledRange filledRange, filledRanges) {
+        if (filledRange.end > position) {
+            break;
         }
+        returnValue = filledRange;
     }
+    return returnValue;
+}
+
 
-#endif
+bool PCMCache::isDecoded(qint64 microseconds)
+{
+    qint64 position = format.bytesForDuration(microseconds);
 
-    return DEFAULT_PCM_MEMORY;
+    mutex.lock();
+    bool decoded = radioStation || (filledRangeAt(position).end > position);
+    mutex.unlock();
+
+    return decoded;
 }
 
 
@@ -103,23 +194,105 @@ bool PCMCache::isFile()
 }
 
 
+bool PCMCache::mapDiskCache()
+{
+    QFile *cachedFile = new QFile(diskCachePath);
+
+    if (!cachedFile->open(QIODevice::ReadOnly)) {
+        emit error(tr("Can not open cached PCM audio data"), cachedFile->errorString());
+        delete cachedFile;
+        return false;
+    }
+
+    uchar *map = cachedFile->map(0, cachedFile->size());
+    if (map == nullptr) {
+        emit error(tr("Can not map cached PCM audio data"), cachedFile->errorString());
+        cachedFile->close();
+        delete cachedFile;
+        return false;
+    }
+
+    mutex.lock();
+    mappedFile = cachedFile;
+    mapped     = map;
+    mappedSize = cachedFile->size();
+    filledRanges.append({ 0, mappedSize });
+    mutex.unlock();
+
+    return true;
+}
+
+
+qint64 PCMCache::memoryUsage()
+{
+    qint64 usage = 0;
+
+    mutex.lock();
+    if (memory != nullptr) {
+        usage = memory->capacity();
+    }
+    mutex.unlock();
+
+    return usage;
+}
+
+
 qint64 PCMCache::mostSize()
 {
     return maxSize;
 }
 
 
+// only the analyzer needs copies of the mapped data, one buffer is made per request
+void PCMCache::requestDiskCacheBuffer(bool analyze)
+{
+    if ((mapped == nullptr) || (diskCacheFeedPosition >= mappedSize)) {
+        return;
+    }
+
+    if (!analyze) {
+        diskCacheFeedPosition = mappedSize;
+        emit diskCacheLoaded();
+        return;
+    }
+
+    qint64 length = qMin(static_cast<qint64>(format.bytesForDuration(DISK_CACHE_BUFFER_MILLISECONDS * 1000)), mappedSize - diskCacheFeedPosition);
+    emit diskCacheBuffer(new QAudioBuffer(QByteArray(reinterpret_cast<const char*>(mapped) + diskCacheFeedPosition, length), format, format.durationForBytes(diskCacheFeedPosition)));
+
+    diskCacheFeedPosition += length;
+    if (diskCacheFeedPosition >= mappedSize) {
+        emit diskCacheLoaded();
+    }
+}
+
+
 void PCMCache::requestNextPCMChunk()
 {
-    if (readPosition >= size()) {
+    mutex.lock();
+
+    // radio keeps only what's not played yet, read position stays at the beginning
+    qint64 availableEnd = radioStation ? memoryRealSize : filledRangeAt(readPosition).end;
+    if (radioStation && (availableEnd > maxSize)) {
+        maxSize = availableEnd;
+    }
+
+    if (readPosition >= availableEnd) {
+        // playback reached a part where decoding didn't start yet
+        bool gap = sparse && (readPosition != writePosition) && (readPosition != gapSignaled);
+        if (gap) {
+            gapSignaled = readPosition;
+        }
+        mutex.unlock();
+
         unfullfilledRequest = true;
+        if (gap) {
+            emit gapReached(format.durationForBytes(readPosition));
+        }
         return;
     }
     unfullfilledRequest = false;
 
-    mutex.lock();
-
-    qint64 chunkLength       = format.bytesForDuration(BUFFER_CREATE_MILLISECONDS * 1000);
+    qint64 chunkLength       = qMin(static_cast<qint64>(format.bytesForDuration(BUFFER_CREATE_MILLISECONDS * 1000)), availableEnd - readPosition);
     qint64 startMicroseconds = radioStation ? format.durationForBytes(radioFakeReadPosition) : format.durationForBytes(readPosition);
 
     QByteArray PCM;
@@ -134,21 +307,20 @@ void PCMCache::requestNextPCMChunk()
         }
     }
     else if (memory != nullptr) {
-        if (memoryRealSize < (readPosition + chunkLength)) {
-            chunkLength = memoryRealSize - readPosition;
+        PCM.append(memory->constData() + readPosition, chunkLength);
+        if (radioStation) {
+            memory->remove(0, chunkLength);
+            memoryRealSize -= chunkLength;
+            radioFakeReadPosition += chunkLength;
         }
-        if (chunkLength > 0) {
-            PCM.append(memory->constData() + readPosition, chunkLength);
-            if (radioStation) {
-                memory->remove(0, chunkLength);
-                memoryRealSize -= chunkLength;
-                radioFakeReadPosition += chunkLength;
-            }
-            else {
-                readPosition += PCM.size();
-            }
+        else {
+            readPosition += PCM.size();
         }
     }
+    else if (mapped != nullptr) {
+        PCM.append(reinterpret_cast<const char*>(mapped) + readPosition, chunkLength);
+        readPosition += PCM.size();
+    }
 
     mutex.unlock();
 
@@ -165,35 +337,48 @@ void PCMCache::requestTimestampPCMChunk(long milliseconds)
         return;
     }
 
-    qint64 currentSize = size();
-
     mutex.lock();
 
-    qint64 chunkLength = format.bytesForDuration(BUFFER_CREATE_MILLISECONDS * 1000);
-    qint64 position    = qMin(static_cast<qint64>(format.bytesForDuration(milliseconds * 1000)), currentSize - chunkLength);
-    if (position < 0) {
-        position = 0;
+    qint64      chunkLength = format.bytesForDuration(BUFFER_CREATE_MILLISECONDS * 1000);
+    qint64      target      = format.bytesForDuration(milliseconds * 1000);
+    FilledRange filledRange = filledRangeAt(target);
+
+    if (filledRange.end <= target) {
+        // decoding restarted here, the chunk is sent when it arrives
+        if (target == writePosition) {
+            readPosition = target;
+            mutex.unlock();
+
+            unfullfilledRequest = true;
+            return;
+        }
+
+        // not decoded yet, play the end of what's decoded before it
+        filledRange = filledRangeBefore(target);
     }
+
+    qint64 position = qMax(qMin(target, filledRange.end - chunkLength), filledRange.start);
+    chunkLength     = qMin(chunkLength, filledRange.end - position);
+
     qint64 startMicroseconds = format.durationForBytes(position);
 
     QByteArray PCM;
 
-    if (file != nullptr) {
-        if (file->isOpen()) {
-            file->seek(position);
-            PCM.append(file->read(chunkLength));
-            readPosition = position + PCM.size();
-        }
-    }
-    else if (memory != nullptr) {
-        if (memoryRealSize < (position + chunkLength)) {
-            chunkLength = memoryRealSize - position;
+    if (chunkLength > 0) {
+        if (file != nullptr) {
+            if (file->isOpen()) {
+                file->seek(position);
+                PCM.append(file->read(chunkLength));
+            }
         }
-        if (chunkLength > 0) {
+        else if (memory != nullptr) {
             PCM.append(memory->constData() + position, chunkLength);
-            readPosition = position + PCM.size();
+        }
+        else if (mapped != nullptr) {
+            PCM.append(reinterpret_cast<const char*>(mapped) + position, chunkLength);
         }
     }
+    readPosition = position + PCM.size();
 
     mutex.unlock();
 
@@ -205,30 +390,71 @@ void PCMCache::requestTimestampPCMChunk(long milliseconds)
 
 void PCMCache::run()
 {
-    qint64 bytesNeeded    = format.bytesForDuration((lengthMilliseconds + 1000) * 1000);
-    long   bytesAvailable = availableMemory();
+    // a track decoded in an earlier session is served straight from the disk cache, the analyzer asks for buffers when it needs them
+    if (!diskCachePath.isEmpty() && mapDiskCache()) {
+        return;
+    }
 
-    if (((lengthMilliseconds <= 0) && !radioStation) || (bytesNeeded > MAX_PCM_MEMORY) || (bytesNeeded > bytesAvailable)) {
-        file = new QFile(QString("%1/waver_%2").arg(QStandardPaths::writableLocation(QStandardPaths::TempLocation), QUuid::createUuid().toString(QUuid::Id128)));
+    qint64 bytesNeeded = format.bytesForDuration((lengthMilliseconds + 1000) * 1000);
 
-        if (!file->open(QIODevice::ReadWrite)) {
-            emit error(tr("Can not create temporary file, using memory"), file->errorString());
-            delete file;
-            file = nullptr;
-        }
+    // radio stations keep only a short buffer in memory, everything else has to fit into the global budget
+    bool memoryGranted = false;
+    if (radioStation) {
+        memoryGranted = true;
+    }
+    else if ((lengthMilliseconds > 0) && (bytesNeeded <= MAX_PCM_MEMORY)) {
+        memoryGranted = PCMMemoryBudget::instance()->requestMemory(this, bytesNeeded, memoryRole);
+    }
+
+    if (!memoryGranted) {
+        mutex.lock();
+        file = createTemporaryFile();
+        mutex.unlock();
     }
 
     if (file == nullptr) {
+        mutex.lock();
         if (radioStation || (lengthMilliseconds <= 0)) {
             memory = new QByteArray();
         }
         else {
             memory = new QByteArray(bytesNeeded, 0);
         }
+        mutex.unlock();
     }
 }
 
 
+void PCMCache::setDiskCache(QString key, QString cachedPath)
+{
+    diskCacheKey  = key;
+    diskCachePath = cachedPath;
+}
+
+
+// decoding restarted from the middle, what comes next is stored from here
+void PCMCache::setWritePosition(qint64 microseconds)
+{
+    mutex.lock();
+
+    qint64 position = format.bytesForDuration(microseconds);
+    if (position != writePosition) {
+        writePosition = position;
+        sparse        = true;
+    }
+    gapSignaled = -1;
+
+    mutex.unlock();
+}
+
+
+void PCMCache::setMemoryRole(PCMMemoryBudget::Role memoryRole)
+{
+    this->memoryRole = memoryRole;
+    PCMMemoryBudget::instance()->setRole(this, memoryRole);
+}
+
+
 qint64 PCMCache::size()
 {
     qint64 size = 0;
@@ -240,6 +466,9 @@ qint64 PCMCache::size()
     else if (memory != nullptr) {
         size = memoryRealSize;
     }
+    else if (mapped != nullptr) {
+        size = mappedSize;
+    }
     mutex.unlock();
 
     if (size > maxSize) {
@@ -250,14 +479,76 @@ qint64 PCMCache::size()
 }
 
 
-void PCMCache::storeBuffer(QAudioBuffer *buffer)
+void PCMCache::storeToDiskCache()
 {
+    // a track with gaps or with parts decoded separately is not stored
+    if (radioStation || sparse || diskCacheKey.isEmpty() || (mapped != nullptr)) {
+        return;
+    }
+
+    QString partialPath = DiskCache::pcmInstance()->partialPath(diskCacheKey);
+    if (partialPath.isEmpty()) {
+        return;
+    }
+
+    QFile partial(partialPath);
+    if (!partial.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    bool   success  = true;
+    qint64 position = 0;
+
     if (file != nullptr) {
+        qint64 blockLength = format.bytesForDuration(DISK_CACHE_BUFFER_MILLISECONDS * 1000);
+        while (success) {
+            // release the lock between blocks so playback can keep reading
+            mutex.lock();
+            file->seek(position);
+            QByteArray block = file->read(blockLength);
+            mutex.unlock();
+
+            if (block.size() == 0) {
+                break;
+            }
+            success   = partial.write(block) == block.size();
+            position += block.size();
+        }
+    }
+    else if (memory != nullptr) {
         mutex.lock();
-        if (!file->atEnd()) {
-            file->seek(file->size());
+        success = partial.write(memory->constData(), memoryRealSize) == memoryRealSize;
+        mutex.unlock();
+    }
+    else {
+        success = false;
+    }
+
+    partial.close();
+
+    if (!success) {
+        DiskCache::pcmInstance()->discard(diskCacheKey);
+        return;
+    }
+    DiskCache::pcmInstance()->commit(diskCacheKey);
+}
+
+
+void PCMCache::storeBuffer(QAudioBuffer *buffer)
+{
+    qint64 byteCount = buffer->byteCount();
+
+    // memory might be demoted to file by the budget from the cache thread, so decide only after locking
+    mutex.lock();
+
+    if (file != nullptr) {
+        if (file->pos() != writePosition) {
+            file->seek(writePosition);
         }
-        file->write(static_cast<const char*>(buffer->constData()), buffer->byteCount());
+        file->write(static_cast<const char*>(buffer->constData()), byteCount);
+
+        addFilledRange(writePosition, writePosition + byteCount);
+        writePosition += byteCount;
         mutex.unlock();
 
         if (unfullfilledRequest) {
@@ -268,14 +559,20 @@ void PCMCache::storeBuffer(QAudioBuffer *buffer)
     }
 
     if (memory != nullptr) {
-        mutex.lock();
-        if (radioStation || (lengthMilliseconds <= 0)) {
-            memory->append(static_cast<const char*>(buffer->constData()), buffer->byteCount());
+        if (radioStation) {
+            memory->append(static_cast<const char*>(buffer->constData()), byteCount);
+            memoryRealSize += byteCount;
         }
         else {
-            memory->replace(memoryRealSize, buffer->byteCount(), static_cast<const char*>(buffer->constData()), buffer->byteCount());
+            if (memory->size() < writePosition) {
+                memory->resize(writePosition);
+            }
+            memory->replace(writePosition, byteCount, static_cast<const char*>(buffer->constData()), byteCount);
+
+            addFilledRange(writePosition, writePosition + byteCount);
+            writePosition  += byteCount;
+            memoryRealSize  = qMax(memoryRealSize, writePosition);
         }
-        memoryRealSize += buffer->byteCount();
         mutex.unlock();
 
         if (unfullfilledRequest) {
@@ -285,5 +582,7 @@ void PCMCache::storeBuffer(QAudioBuffer *buffer)
         return;
     }
 
+    mutex.unlock();
+
     emit error(tr("Can not cache PCM audio data"), tr("Both file and memory is nullptr"));
 }
@@ -14,7 +14,6 @@
 #include <QFile>
 #include <QMutex>
 #include <QObject>
-#include <QRegExp>
 #include <QStandardPaths>
 #include <QtGlobal>
 #include <QTimer>
@@ -23,9 +22,8 @@
 
 #include <QThread>
 
-#ifdef Q_OS_WIN
-    #include "windows.h"
-#endif
+#include "diskcache.h"
+#include "pcmmemorybudget.h"
 
 #ifdef QT_DEBUG
     #include <QDebug>
@@ -39,22 +37,33 @@ class PCMCache : public QObject
 
     public:
 
-        static const qint32 BUFFER_CREATE_MILLISECONDS = 50;
-        static const long   DEFAULT_PCM_MEMORY         = 50 * 1024 * 1024;
-        static const long   MAX_PCM_MEMORY             = 500 * 1024 * 1024;
+        static const qint32 BUFFER_CREATE_MILLISECONDS     = 50;
+        static const qint32 DISK_CACHE_BUFFER_MILLISECONDS = 1000;
+        static const long   MAX_PCM_MEMORY                 = 500 * 1024 * 1024;
 
         explicit PCMCache(QAudioFormat format, long lengthMilliseconds, bool radioStation, QObject *parent = nullptr);
         ~PCMCache();
 
         void storeBuffer(QAudioBuffer *buffer);
+        void setWritePosition(qint64 microseconds);
+        bool isDecoded(qint64 microseconds);
 
         qint64 size();
         qint64 mostSize();
+        qint64 memoryUsage();
         bool   isFile();
 
+        void setMemoryRole(PCMMemoryBudget::Role memoryRole);
+        void setDiskCache(QString key, QString cachedPath);
+
 
     private:
 
+        struct FilledRange {
+            qint64 start;
+            qint64 end;
+        };
+
         QAudioFormat format;
         qint64       lengthMilliseconds;
         bool         radioStation;
@@ -63,15 +72,34 @@ class PCMCache : public QObject
 
         QByteArray *memory;
         QFile      *file;
+        QFile      *mappedFile;
+        uchar      *mapped;
+        qint64      mappedSize;
 
         qint64 memoryRealSize;
         qint64 maxSize;
         qint64 readPosition;
         qint64 radioFakeReadPosition;
 
+        // decoding might restart anywhere in the track, then there are gaps between these
+        qint64               writePosition;
+        QVector<FilledRange> filledRanges;
+        bool                 sparse;
+        qint64               gapSignaled;
+
         bool unfullfilledRequest;
 
-        long availableMemory();
+        PCMMemoryBudget::Role memoryRole;
+
+        QString diskCacheKey;
+        QString diskCachePath;
+        qint64  diskCacheFeedPosition;
+
+        QFile      *createTemporaryFile();
+        bool        mapDiskCache();
+        void        addFilledRange(qint64 start, qint64 end);
+        FilledRange filledRangeAt(qint64 position);
+        FilledRange filledRangeBefore(qint64 position);
 
 
     public slots:
@@ -81,12 +109,22 @@ class PCMCache : public QObject
         void requestNextPCMChunk();
         void requestTimestampPCMChunk(long milliseconds);
 
+        void demoteToFile();
+        void storeToDiskCache();
+
+        void requestDiskCacheBuffer(bool analyze);
+
 
     signals:
 
         void pcmChunk(QByteArray PCM, qint64 startMicroseconds);
         void error(QString info, QString error);
 
+        void diskCacheBuffer(QAudioBuffer *buffer);
+        void diskCacheLoaded();
+
+        void gapReached(qint64 microseconds);
+
 };
 
 #endif // PCMCACHE_H
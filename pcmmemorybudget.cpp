@@ -0,0 +1,222 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "pcmmemorybudget.h"
+
+
+PCMMemoryBudget::PCMMemoryBudget()
+{
+    availableMemoryBytes     = DEFAULT_AVAILABLE_MEMORY;
+    availableMemoryTimestamp = 0;
+    claimedSinceQuery        = 0;
+}
+
+
+PCMMemoryBudget *PCMMemoryBudget::instance()
+{
+    // function-local static is thread safe since C++11
+    static PCMMemoryBudget budget;
+    return &budget;
+}
+
+
+qint64 PCMMemoryBudget::availableMemory()
+{
+    qint64 returnValue;
+
+    mutex.lock();
+    returnValue = queryAvailableMemory();
+    mutex.unlock();
+
+    return returnValue;
+}
+
+
+qint64 PCMMemoryBudget::claimedBytes(QObject *cache)
+{
+    qint64 returnValue = 0;
+
+    mutex.lock();
+    if (claims.contains(cache)) {
+        returnValue = claims.value(cache).bytes;
+    }
+    mutex.unlock();
+
+    return returnValue;
+}
+
+
+void PCMMemoryBudget::demoted(QObject *cache, bool success)
+{
+    mutex.lock();
+    if (claims.contains(cache)) {
+        if (success) {
+            claims[cache].bytes = 0;
+        }
+        claims[cache].demoting = false;
+    }
+    mutex.unlock();
+}
+
+
+qint64 PCMMemoryBudget::demotePreloaded(qint64 bytesNeeded, QObject *except)
+{
+    // mutex must be locked by caller
+
+    QList<QObject *> candidates;
+    QHashIterator<QObject *, Claim> iterator(claims);
+    while (iterator.hasNext()) {
+        iterator.next();
+        if ((iterator.key() != except) && (iterator.value().role == Preloaded) && (iterator.value().bytes > 0) && !iterator.value().demoting) {
+            candidates.append(iterator.key());
+        }
+    }
+
+    // biggest first, so as few tracks as possible have to be moved to disk
+    std::sort(candidates.begin(), candidates.end(), [this](QObject *a, QObject *b) {
+        return claims.value(a).bytes > claims.value(b).bytes;
+    });
+
+    qint64 freed = 0;
+    foreach (QObject *cache, candidates) {
+        if (freed >= bytesNeeded) {
+            break;
+        }
+
+        freed                 += claims.value(cache).bytes;
+        claims[cache].demoting = true;
+
+        QMetaObject::invokeMethod(cache, "demoteToFile", Qt::QueuedConnection);
+    }
+
+    return freed;
+}
+
+
+qint64 PCMMemoryBudget::queryAvailableMemory()
+{
+    // mutex must be locked by caller
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if (now < availableMemoryTimestamp + AVAILABLE_MEMORY_CACHE_MILLISECONDS) {
+        return qMax(availableMemoryBytes - claimedSinceQuery, static_cast<qint64>(0));
+    }
+
+    availableMemoryBytes     = DEFAULT_AVAILABLE_MEMORY;
+    availableMemoryTimestamp = now;
+    claimedSinceQuery        = 0;
+
+#if defined (Q_OS_WIN)
+
+    MEMORYSTATUSEX memoryStatus;
+
+    ZeroMemory(&memoryStatus, sizeof(MEMORYSTATUSEX));
+    memoryStatus.dwLength = sizeof(MEMORYSTATUSEX);
+
+    if (GlobalMemoryStatusEx(&memoryStatus)) {
+        quint64 availPhys = memoryStatus.ullAvailPhys;
+        qint64  int64Max  = (std::numeric_limits<qint64>::max)();
+
+        availableMemoryBytes = availPhys > static_cast<quint64>(int64Max) ? int64Max : static_cast<qint64>(availPhys);
+    }
+
+#elif defined (Q_OS_LINUX)
+
+    QFile memInfo("/proc/meminfo");
+
+    if (memInfo.open(QIODevice::ReadOnly)) {
+        // procfs reports size zero, so read line by line instead of all at once
+        QByteArray line;
+        while (!(line = memInfo.readLine(256)).isEmpty()) {
+            if (line.startsWith("MemAvailable:")) {
+                bool   OK                = false;
+                qint64 availableMemoryKB = line.mid(13).trimmed().split(' ').first().toLongLong(&OK);
+                if (OK) {
+                    availableMemoryBytes = availableMemoryKB * 1024;
+                }
+                break;
+            }
+        }
+        memInfo.close();
+    }
+
+#endif
+
+    return availableMemoryBytes;
+}
+
+
+void PCMMemoryBudget::releaseMemory(QObject *cache)
+{
+    mutex.lock();
+    claims.remove(cache);
+    mutex.unlock();
+}
+
+
+bool PCMMemoryBudget::requestMemory(QObject *cache, qint64 bytes, Role role)
+{
+    mutex.lock();
+
+    qint64 available = queryAvailableMemory();
+    qint64 claimed   = totalClaimedBytesUnlocked();
+
+    bool fits = (bytes <= available) && (claimed + bytes <= MAX_TOTAL_MEMORY);
+
+    // playing tracks have priority over preloaded ones
+    if (!fits && (role != Preloaded)) {
+        qint64 shortage = qMax(bytes - available, claimed + bytes - MAX_TOTAL_MEMORY);
+        qint64 freed    = demotePreloaded(shortage, cache);
+
+        fits = (bytes <= available + freed) && (claimed - freed + bytes <= MAX_TOTAL_MEMORY);
+    }
+
+    claims.insert(cache, { role, fits ? bytes : 0, false });
+    if (fits) {
+        claimedSinceQuery += bytes;
+    }
+
+    mutex.unlock();
+
+    return fits;
+}
+
+
+void PCMMemoryBudget::setRole(QObject *cache, Role role)
+{
+    mutex.lock();
+    if (claims.contains(cache)) {
+        claims[cache].role = role;
+    }
+    mutex.unlock();
+}
+
+
+qint64 PCMMemoryBudget::totalClaimedBytes()
+{
+    qint64 returnValue;
+
+    mutex.lock();
+    returnValue = totalClaimedBytesUnlocked();
+    mutex.unlock();
+
+    return returnValue;
+}
+
+
+qint64 PCMMemoryBudget::totalClaimedBytesUnlocked()
+{
+    // mutex must be locked by caller
+
+    qint64 returnValue = 0;
+    foreach (Claim claim, claims) {
+        if (!claim.demoting) {
+            returnValue += claim.bytes;
+        }
+    }
+    return returnValue;
+}
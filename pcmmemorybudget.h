@@ -0,0 +1,79 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef PCMMEMORYBUDGET_H
+#define PCMMEMORYBUDGET_H
+
+#include <QDateTime>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+#include <QtGlobal>
+
+#ifdef Q_OS_WIN
+    #include "windows.h"
+#endif
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// process-wide bookkeeping of PCM memory claimed by the caches of all tracks
+class PCMMemoryBudget
+{
+    public:
+
+        enum Role {
+            Current,
+            Previous,
+            Preloaded
+        };
+
+        static const qint64 DEFAULT_AVAILABLE_MEMORY = 50 * 1024 * 1024;
+        static const qint64 MAX_TOTAL_MEMORY         = 1000 * 1024 * 1024;
+
+        static PCMMemoryBudget *instance();
+
+        bool requestMemory(QObject *cache, qint64 bytes, Role role);
+        void releaseMemory(QObject *cache);
+        void demoted(QObject *cache, bool success);
+        void setRole(QObject *cache, Role role);
+
+        qint64 claimedBytes(QObject *cache);
+        qint64 totalClaimedBytes();
+        qint64 availableMemory();
+
+
+    private:
+
+        static const qint64 AVAILABLE_MEMORY_CACHE_MILLISECONDS = 2000;
+
+        struct Claim {
+            Role   role;
+            qint64 bytes;
+            bool   demoting;
+        };
+
+        QMutex                  mutex;
+        QHash<QObject *, Claim> claims;
+
+        qint64 availableMemoryBytes;
+        qint64 availableMemoryTimestamp;
+        qint64 claimedSinceQuery;
+
+        PCMMemoryBudget();
+
+        qint64 queryAvailableMemory();
+        qint64 totalClaimedBytesUnlocked();
+        qint64 demotePreloaded(qint64 bytesNeeded, QObject *except);
+};
+
+#endif // PCMMEMORYBUDGET_H
@@ -1,13 +0,0 @@
-/*
-    This file is part of Waver
-    Copyright (C) 2021 Peter Papp
-    Please visit https://launchpad.net/waver for details
-*/
-
-
-#include "peakcallback.h"
-
-PeakCallback::~PeakCallback()
-{
-    // nothing to do here
-}
@@ -0,0 +1,49 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "peakreader.h"
+
+
+PeakReader::PeakReader(QObject *parent) : QObject(parent)
+{
+    // nothing to do here
+}
+
+
+// interpolated between the middles of neighbouring blocks, so the meter moves with the audio clock rather than in block sized steps
+QVariantList PeakReader::levels()
+{
+    QVariantList returnValue;
+
+    qint64 now = PeakRing::instance()->clockMicroseconds() - PeakRing::instance()->getReadDelay();
+
+    PeakRing::Entry current;
+    if (!PeakRing::instance()->read(now, &current)) {
+        return returnValue;
+    }
+
+    double lPeak = current.levels.lPeak;
+    double rPeak = current.levels.rPeak;
+
+    qint64 middle = current.audibleMicroseconds + current.durationMicroseconds / 2;
+
+    PeakRing::Entry neighbour;
+    bool hasNeighbour = now < middle ? PeakRing::instance()->read(current.audibleMicroseconds - 1, &neighbour) : PeakRing::instance()->read(current.audibleMicroseconds + current.durationMicroseconds, &neighbour);
+    if (hasNeighbour) {
+        double distance = (current.durationMicroseconds + neighbour.durationMicroseconds) / 2.0;
+        double weight   = distance > 0 ? qBound(0.0, qAbs(now - middle) / distance, 1.0) : 0.0;
+
+        lPeak += (neighbour.levels.lPeak - lPeak) * weight;
+        rPeak += (neighbour.levels.rPeak - rPeak) * weight;
+    }
+
+    returnValue.append(lPeak);
+    returnValue.append(rPeak);
+    returnValue.append(current.replayGain);
+
+    return returnValue;
+}
@@ -0,0 +1,35 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef PEAKREADER_H
+#define PEAKREADER_H
+
+#include <QObject>
+#include <QtGlobal>
+#include <QVariantList>
+
+#include "peakring.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// the peak meter's view of the level history, lives in the UI thread and never blocks
+class PeakReader : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        explicit PeakReader(QObject *parent = nullptr);
+
+        // left peak, right peak and replay gain, empty if nothing is being heard
+        Q_INVOKABLE QVariantList levels();
+};
+
+#endif // PEAKREADER_H
@@ -0,0 +1,108 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "peakring.h"
+
+
+PeakRing::PeakRing()
+{
+    memset(ring, 0, sizeof(ring));
+
+    writing      = 0;
+    source       = nullptr;
+    writtenCount = 0;
+
+    replayGainPerMyriad   = 0;
+    readDelayMicroseconds = 0;
+
+    clock.start();
+}
+
+
+// monotonic, shared by the writers and the readers
+qint64 PeakRing::clockMicroseconds()
+{
+    return clock.nsecsElapsed() / 1000;
+}
+
+
+// extra delay of the audio after the device, Bluetooth headphones for example
+qint64 PeakRing::getReadDelay()
+{
+    return readDelayMicroseconds.loadAcquire();
+}
+
+
+PeakRing *PeakRing::instance()
+{
+    // function-local static is thread safe since C++11
+    static PeakRing peakRing;
+    return &peakRing;
+}
+
+
+// the entry that is being heard at the given time, false if there's none
+bool PeakRing::read(qint64 atMicroseconds, Entry *entry)
+{
+    qint64 written = writtenCount.loadAcquire();
+    qint64 oldest  = qMax(written - RING_SIZE + 1, static_cast<qint64>(0));
+
+    for (qint64 i = written - 1; i >= oldest; i--) {
+        *entry = ring[i & RING_MASK];
+
+        // the writer might have lapped the copy meanwhile
+        if (writtenCount.loadAcquire() - RING_SIZE >= i) {
+            return false;
+        }
+
+        if (entry->audibleMicroseconds <= atMicroseconds) {
+            return atMicroseconds < entry->audibleMicroseconds + entry->durationMicroseconds;
+        }
+    }
+
+    return false;
+}
+
+
+// only one track's output is published, during crossfade that's the one the peak meter shows
+void PeakRing::setSource(void *source)
+{
+    this->source.storeRelease(source);
+}
+
+
+void PeakRing::setReadDelay(qint64 microseconds)
+{
+    readDelayMicroseconds.storeRelease(qMax(microseconds, static_cast<qint64>(0)));
+}
+
+
+// 0..1 position on the peak meter's replay gain scale, stamped on the entries written from now on
+void PeakRing::setReplayGain(double replayGain)
+{
+    replayGainPerMyriad.storeRelease(static_cast<int>(qBound(0.0, replayGain, 1.0) * 10000));
+}
+
+
+void PeakRing::write(void *source, qint64 audibleMicroseconds, qint64 durationMicroseconds, BlockMeter::Levels levels)
+{
+    if (source != this->source.loadAcquire()) {
+        return;
+    }
+
+    // another output is writing, dropping is better than waiting
+    if (!writing.testAndSetAcquire(0, 1)) {
+        return;
+    }
+
+    qint64 position = writtenCount.loadAcquire();
+
+    ring[position & RING_MASK] = { audibleMicroseconds, durationMicroseconds, levels, replayGainPerMyriad.loadAcquire() / 10000.0 };
+    writtenCount.storeRelease(position + 1);
+
+    writing.storeRelease(0);
+}
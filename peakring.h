@@ -0,0 +1,68 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef PEAKRING_H
+#define PEAKRING_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+#include "blockmeter.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// lock-free history of block levels stamped with the time they are heard, the output publishes and the UI polls
+class PeakRing
+{
+    public:
+
+        struct Entry {
+            qint64             audibleMicroseconds;
+            qint64             durationMicroseconds;
+            BlockMeter::Levels levels;
+            double             replayGain;
+        };
+
+        static const int RING_SIZE = 256;
+
+        static PeakRing *instance();
+
+        qint64 clockMicroseconds();
+
+        void   setSource(void *source);
+        void   setReplayGain(double replayGain);
+        void   setReadDelay(qint64 microseconds);
+        qint64 getReadDelay();
+
+        void write(void *source, qint64 audibleMicroseconds, qint64 durationMicroseconds, BlockMeter::Levels levels);
+        bool read(qint64 atMicroseconds, Entry *entry);
+
+
+    private:
+
+        static const int RING_MASK = RING_SIZE - 1;
+
+        Entry ring[RING_SIZE];
+
+        QElapsedTimer clock;
+
+        QAtomicInt             writing;
+        QAtomicPointer<void>   source;
+        QAtomicInteger<qint64> writtenCount;
+        QAtomicInt             replayGainPerMyriad;
+        QAtomicInteger<qint64> readDelayMicroseconds;
+
+        PeakRing();
+};
+
+#endif // PEAKRING_H
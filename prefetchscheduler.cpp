@@ -0,0 +1,269 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "prefetchscheduler.h"
+
+
+PrefetchScheduler::PrefetchScheduler() : QObject(nullptr)
+{
+    trackLimit      = 0;
+    foregroundBytes = 0;
+    prefetchBytes   = 0;
+    capacity        = 0;
+    foregroundRate  = 0;
+    tokens          = 0;
+
+    timer = new QTimer(this);
+    timer->setInterval(TICK_MILLISECONDS);
+    connect(timer, &QTimer::timeout, this, &PrefetchScheduler::timerTimeout);
+
+    // the timer is a child, it moves too
+    moveToThread(NetworkPool::instance()->sourceThread());
+}
+
+
+void PrefetchScheduler::dropPrefetch(Prefetch *prefetch)
+{
+    stopReply(prefetch);
+    prefetches.removeAll(prefetch);
+    delete prefetch;
+}
+
+
+void PrefetchScheduler::foregroundReceived(qint64 bytes)
+{
+    foregroundBytes += bytes;
+}
+
+
+PrefetchScheduler *PrefetchScheduler::instance()
+{
+    // lives as long as the network pool's thread
+    static PrefetchScheduler *scheduler = new PrefetchScheduler();
+    return scheduler;
+}
+
+
+// moves downloaded data from the replies to the store, a reply that's not read stops receiving when its buffer is full
+void PrefetchScheduler::pump()
+{
+    bool limited = !foregroundSources.isEmpty();
+
+    foreach (Prefetch *prefetch, prefetches) {
+        if (prefetch->reply == nullptr) {
+            continue;
+        }
+
+        if (!prefetch->replyChecked) {
+            QVariant statusCode = prefetch->reply->attribute(QNetworkRequest::HttpStatusCodeAttribute);
+            if (!statusCode.isValid()) {
+                if (prefetch->reply->isFinished()) {
+                    dropPrefetch(prefetch);
+                }
+                continue;
+            }
+            if (statusCode.toInt() != 200) {
+                dropPrefetch(prefetch);
+                continue;
+            }
+
+            prefetch->replyChecked = true;
+            bool OK = false;
+            prefetch->totalBytes = prefetch->reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&OK);
+            if (!OK || (prefetch->totalBytes <= 0)) {
+                prefetch->totalBytes = -1;
+            }
+        }
+
+        qint64 count = qMin(prefetch->reply->bytesAvailable(), trackLimit - prefetch->bytes);
+        if (limited) {
+            count = qMin(count, static_cast<qint64>(tokens));
+        }
+        if (count > 0) {
+            QByteArray data = prefetch->reply->read(count);
+
+            prefetch->chunks.append(data);
+            prefetch->bytes += data.size();
+            prefetchBytes   += data.size();
+            if (limited) {
+                tokens -= data.size();
+            }
+        }
+
+        if (prefetch->bytes >= trackLimit) {
+            stopReply(prefetch);
+            continue;
+        }
+        if (prefetch->reply->isFinished() && (prefetch->reply->bytesAvailable() == 0)) {
+            // an interrupted prefetch is still useful, the network source downloads the rest
+            if ((prefetch->reply->error() == QNetworkReply::NoError) && (prefetch->totalBytes < 0)) {
+                prefetch->totalBytes = prefetch->bytes;
+            }
+            stopReply(prefetch);
+        }
+    }
+}
+
+
+void PrefetchScheduler::setForegroundActive(QObject *source, bool active)
+{
+    if (active) {
+        foregroundSources.insert(source);
+        return;
+    }
+    foregroundSources.remove(source);
+}
+
+
+void PrefetchScheduler::setQueue(QList<QUrl> urls, qint64 storeBytes)
+{
+    QMetaObject::invokeMethod(this, [this, urls, storeBytes]() {
+        updateQueue(urls, storeBytes);
+    }, Qt::QueuedConnection);
+}
+
+
+void PrefetchScheduler::startPrefetch(Prefetch *prefetch)
+{
+    QNetworkRequest request(prefetch->url);
+    request.setRawHeader("User-Agent", QGuiApplication::instance()->applicationName().toUtf8());
+    request.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
+    request.setMaximumRedirectsAllowed(12);
+    request.setPriority(QNetworkRequest::LowPriority);
+    NetworkPool::instance()->prepareRequest(&request);
+
+    prefetch->reply = NetworkPool::instance()->manager()->get(request);
+    prefetch->reply->setReadBufferSize(READ_BUFFER_BYTES);
+
+    connect(prefetch->reply, &QNetworkReply::readyRead, this, &PrefetchScheduler::pump);
+    connect(prefetch->reply, &QNetworkReply::finished,  this, &PrefetchScheduler::pump);
+}
+
+
+void PrefetchScheduler::stopReply(Prefetch *prefetch)
+{
+    if (prefetch->reply == nullptr) {
+        return;
+    }
+
+    // aborting emits finished, that must not come back here
+    disconnect(prefetch->reply, nullptr, this, nullptr);
+    prefetch->reply->abort();
+    prefetch->reply->deleteLater();
+    prefetch->reply = nullptr;
+}
+
+
+bool PrefetchScheduler::take(QUrl url, QVector<QByteArray> *chunks, qint64 *totalBytes)
+{
+    if (!takenUrls.contains(url)) {
+        takenUrls.append(url);
+    }
+
+    foreach (Prefetch *prefetch, prefetches) {
+        if (prefetch->url != url) {
+            continue;
+        }
+
+        // whatever is buffered in the reply is still worth having
+        if (prefetch->reply != nullptr) {
+            if (prefetch->replyChecked) {
+                QByteArray data = prefetch->reply->readAll();
+                prefetch->chunks.append(data);
+                prefetch->bytes += data.size();
+            }
+            stopReply(prefetch);
+        }
+
+        bool found = prefetch->bytes > 0;
+        if (found) {
+            *chunks     = prefetch->chunks;
+            *totalBytes = prefetch->totalBytes;
+        }
+
+        dropPrefetch(prefetch);
+        return found;
+    }
+
+    return false;
+}
+
+
+void PrefetchScheduler::timerTimeout()
+{
+    double seconds = TICK_MILLISECONDS / 1000.0;
+
+    capacity       = qMax((foregroundBytes + prefetchBytes) / seconds, capacity * CAPACITY_DECAY);
+    foregroundRate = foregroundRate * (1.0 - RATE_SMOOTHING) + foregroundBytes / seconds * RATE_SMOOTHING;
+
+    foregroundBytes = 0;
+    prefetchBytes   = 0;
+
+    // at most one second's worth can be saved up
+    double rate = qMax(capacity - foregroundRate, 0.0) * LEFTOVER_SHARE;
+    tokens      = qMin(tokens + rate * seconds, rate);
+
+    pump();
+}
+
+
+void PrefetchScheduler::updateQueue(QList<QUrl> urls, qint64 storeBytes)
+{
+    // tracks that are already playing are not downloaded again while they're still on the list
+    QList<QUrl> stillTaken;
+    foreach (QUrl url, takenUrls) {
+        if (urls.contains(url)) {
+            stillTaken.append(url);
+        }
+    }
+    takenUrls = stillTaken;
+
+    trackLimit = storeBytes / qMax(urls.count(), 1);
+
+    QList<Prefetch *> updated;
+    foreach (QUrl url, urls) {
+        if (takenUrls.contains(url)) {
+            continue;
+        }
+
+        Prefetch *existing = nullptr;
+        foreach (Prefetch *prefetch, prefetches) {
+            if (prefetch->url == url) {
+                existing = prefetch;
+                break;
+            }
+        }
+        if (existing != nullptr) {
+            prefetches.removeAll(existing);
+            updated.append(existing);
+            continue;
+        }
+
+        Prefetch *prefetch = new Prefetch({ url, nullptr, false, QVector<QByteArray>(), 0, -1 });
+        startPrefetch(prefetch);
+        updated.append(prefetch);
+    }
+
+    // what's not on the list anymore is thrown away
+    while (prefetches.count() > 0) {
+        dropPrefetch(prefetches.first());
+    }
+    prefetches = updated;
+
+    if (prefetches.isEmpty()) {
+        timer->stop();
+        return;
+    }
+    if (!timer->isActive()) {
+        foregroundBytes = 0;
+        prefetchBytes   = 0;
+        timer->start();
+    }
+
+    // limit might have been lowered
+    pump();
+}
@@ -0,0 +1,97 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef PREFETCHSCHEDULER_H
+#define PREFETCHSCHEDULER_H
+
+#include <QByteArray>
+#include <QGuiApplication>
+#include <QList>
+#include <QMetaObject>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QObject>
+#include <QSet>
+#include <QtGlobal>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+
+#include "networkpool.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// downloads the beginning of upcoming remote tracks with whatever bandwidth the playing tracks leave unused
+// everything except setQueue must be called on the network pool's thread, that's where the network sources live too
+class PrefetchScheduler : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        static PrefetchScheduler *instance();
+
+        // can be called from any thread, the order of the urls is the order of priority
+        void setQueue(QList<QUrl> urls, qint64 storeBytes);
+
+        // hands over what was prefetched, total is -1 if the server didn't tell
+        bool take(QUrl url, QVector<QByteArray> *chunks, qint64 *totalBytes);
+
+        // playing tracks' downloads, prefetches get only what's left of the bandwidth while any of these is active
+        void setForegroundActive(QObject *source, bool active);
+        void foregroundReceived(qint64 bytes);
+
+
+    private:
+
+        static const     int    TICK_MILLISECONDS = 100;
+        static const     int    READ_BUFFER_BYTES = 256 * 1024;
+        static constexpr double LEFTOVER_SHARE    = 0.8;
+        static constexpr double CAPACITY_DECAY    = 0.995;
+        static constexpr double RATE_SMOOTHING    = 0.3;
+
+        struct Prefetch {
+            QUrl                url;
+            QNetworkReply      *reply;
+            bool                replyChecked;
+            QVector<QByteArray> chunks;
+            qint64              bytes;
+            qint64              totalBytes;
+        };
+
+        QList<Prefetch *> prefetches;
+        QList<QUrl>       takenUrls;
+        qint64            trackLimit;
+
+        QSet<QObject *> foregroundSources;
+
+        // bytes per second, capacity is the highest recently seen total throughput
+        QTimer *timer;
+        qint64  foregroundBytes;
+        qint64  prefetchBytes;
+        double  capacity;
+        double  foregroundRate;
+        double  tokens;
+
+        PrefetchScheduler();
+
+        void dropPrefetch(Prefetch *prefetch);
+        void startPrefetch(Prefetch *prefetch);
+        void stopReply(Prefetch *prefetch);
+        void updateQueue(QList<QUrl> urls, qint64 storeBytes);
+
+
+    private slots:
+
+        void pump();
+        void timerTimeout();
+};
+
+#endif // PREFETCHSCHEDULER_H
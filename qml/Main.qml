@@ -36,7 +36,6 @@ ApplicationWindow {
     signal updatedOptions(string optionsJSON);
     signal requestEQ(int eq_chooser)
     signal requestLog();
-    signal peakUILag(int lagMS);
     signal searchCriteriaEntered(string criteria);
     signal searchResult(string parent, string id, string extra);
 
@@ -178,6 +177,11 @@ ApplicationWindow {
         playlist.setPlaylistBigBusy(busy);
     }
 
+    function playlistBufferData(index, memoryUsageText)
+    {
+        playlist.setBufferData(index, memoryUsageText);
+    }
+
     function playlistTotalTime(totalTime)
     {
         playlist.setTotalTime(totalTime);
@@ -235,21 +239,6 @@ ApplicationWindow {
         art.swapImage(image);
     }
 
-    function setPeakMeter(l, r, scheduledTimeMS)
-    {
-        peakMeter.setPeak(l, r);
-
-        var lagMS = Date.now() - scheduledTimeMS;
-        if (lagMS >= 10) {
-            peakUILag(lagMS);
-        }
-    }
-
-    function setPeakMeterReplayGain(g)
-    {
-        peakMeter.setReplayGain(g);
-    }
-
     function setShuffleCountdown(percent)
     {
         internal.shuffleCountdown = percent
@@ -1131,6 +1120,22 @@ ApplicationWindow {
             anchors.right: parent.right
             anchors.top: buffer.bottom
             height: 25
+            visible: !spectrum.visible
+        }
+
+        Spectrum {
+            id: spectrum
+
+            anchors.fill: peakMeter
+            visible: false
+        }
+
+        MouseArea {
+            anchors.fill: peakMeter
+
+            onClicked: {
+                spectrum.visible = !spectrum.visible;
+            }
         }
 
         Playlist {
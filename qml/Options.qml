@@ -97,16 +97,31 @@ Dialog {
         title_curly_special.checked = optionsObj.title_curly_special;
         starting_index_apply.checked = optionsObj.starting_index_apply;
         starting_index_days.value = optionsObj.starting_index_days;
-        wideStereo.value = optionsObj.wide_stereo;
+        wideStereo.value = Math.round(optionsObj.wide_stereo * 10);
         skip_long_silence.checked = optionsObj.skip_long_silence
         skip_long_silence_seconds.value = optionsObj.skip_long_silence_seconds
+        pcm_disk_cache.checked = optionsObj.pcm_disk_cache
+        pcm_disk_cache_mb.value = optionsObj.pcm_disk_cache_mb
+        compressed_disk_cache.checked = optionsObj.compressed_disk_cache
+        compressed_disk_cache_mb.value = optionsObj.compressed_disk_cache_mb
+        r128_loudness.checked = optionsObj.r128_loudness
+        look_ahead_tracks.value = optionsObj.look_ahead_tracks
+        look_ahead_cpu_percent.value = optionsObj.look_ahead_cpu_percent
+        library_scan.checked = optionsObj.library_scan
+        segmented_analysis.checked = optionsObj.segmented_analysis
+        http2.checked = optionsObj.http2
+        prefetch_tracks.value = optionsObj.prefetch_tracks
+        prefetch_mb.value = optionsObj.prefetch_mb
+        adaptive_bitrate.checked = optionsObj.adaptive_bitrate
+        download_connections.value = optionsObj.download_connections
         fade_tags.text = optionsObj.fade_tags;
         crossfade_tags.text = optionsObj.crossfade_tags;
         fade_seconds.value = optionsObj.fade_seconds;
+        fade_curve.currentIndex = optionsObj.fade_curve;
 
-        max_peak_fps.value = optionsObj.max_peak_fps;
         peak_delay_on.checked = optionsObj.peak_delay_on;
         peak_delay_ms.value = optionsObj.peak_delay_ms;
+        spectrum_bands.value = optionsObj.spectrum_bands;
         alphabet_limit.value = optionsObj.alphabet_limit;
         font_size.value = optionsObj.font_size;
 
@@ -171,9 +186,23 @@ Dialog {
                 eq9: eq9.value,
                 eq10: eq10.value,
                 eq_chooser: eqCommon.checked ? 0 : eqAlbum.checked ? 1 : 2,
-                wide_stereo: wideStereo.value,
+                wide_stereo: wideStereo.value / 10,
                 skip_long_silence: skip_long_silence.checked,
                 skip_long_silence_seconds: skip_long_silence_seconds.value,
+                pcm_disk_cache: pcm_disk_cache.checked,
+                pcm_disk_cache_mb: pcm_disk_cache_mb.value,
+                compressed_disk_cache: compressed_disk_cache.checked,
+                compressed_disk_cache_mb: compressed_disk_cache_mb.value,
+                r128_loudness: r128_loudness.checked,
+                look_ahead_tracks: look_ahead_tracks.value,
+                look_ahead_cpu_percent: look_ahead_cpu_percent.value,
+                library_scan: library_scan.checked,
+                segmented_analysis: segmented_analysis.checked,
+                http2: http2.checked,
+                prefetch_tracks: prefetch_tracks.value,
+                prefetch_mb: prefetch_mb.value,
+                adaptive_bitrate: adaptive_bitrate.checked,
+                download_connections: download_connections.value,
                 shuffle_autostart: shuffle_autostart.checked,
                 shuffle_delay_seconds: shuffle_delay_seconds.value,
                 shuffle_count: shuffle_count.value,
@@ -195,9 +224,10 @@ Dialog {
                 fade_tags: fade_tags.text,
                 crossfade_tags: crossfade_tags.text,
                 fade_seconds: fade_seconds.value,
-                max_peak_fps: max_peak_fps.value,
+                fade_curve: fade_curve.currentIndex,
                 peak_delay_on: peak_delay_on.checked,
                 peak_delay_ms: peak_delay_ms.value,
+                spectrum_bands: spectrum_bands.value,
                 alphabet_limit: alphabet_limit.value,
                 font_size: font_size.value,
                 genres: genres
@@ -924,7 +954,16 @@ Dialog {
                         id: wideStereo
                         editable: true
                         from: 0
-                        to: 40
+                        to: 400
+                        stepSize: 5
+
+                        // tenths of a millisecond
+                        textFromValue: function(value, locale) {
+                            return Number(value / 10).toLocaleString(locale, 'f', 1);
+                        }
+                        valueFromText: function(text, locale) {
+                            return Math.round(Number.fromLocaleString(locale, text) * 10);
+                        }
                     }
                     Label {
                         anchors.rightMargin: 17
@@ -951,6 +990,157 @@ Dialog {
                         text: qsTr("seconds")
                     }
                 }
+                Row {
+                    CheckBox {
+                        id: pcm_disk_cache
+                        width: parent.parent.width / 4
+                        anchors.verticalCenter: pcm_disk_cache_mb.verticalCenter
+                        text: qsTr("Keep decoded tracks on disk")
+                    }
+                    SpinBox {
+                        id: pcm_disk_cache_mb
+                        editable: true
+                        from: 256
+                        to: 65536
+                        stepSize: 256
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: pcm_disk_cache_mb.verticalCenter
+                        text: qsTr("megabytes at most")
+                    }
+                }
+                Row {
+                    CheckBox {
+                        id: compressed_disk_cache
+                        width: parent.parent.width / 4
+                        anchors.verticalCenter: compressed_disk_cache_mb.verticalCenter
+                        text: qsTr("Keep downloaded songs on disk")
+                    }
+                    SpinBox {
+                        id: compressed_disk_cache_mb
+                        editable: true
+                        from: 256
+                        to: 65536
+                        stepSize: 256
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: compressed_disk_cache_mb.verticalCenter
+                        text: qsTr("megabytes at most")
+                    }
+                }
+                Row {
+                    CheckBox {
+                        id: r128_loudness
+                        text: qsTr("Use EBU R128 loudness instead of ReplayGain analysis")
+                    }
+                }
+                Row {
+                    Label {
+                        width: parent.parent.width / 4
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: look_ahead_tracks.verticalCenter
+                        text: qsTr("Analyze in advance")
+                    }
+                    SpinBox {
+                        id: look_ahead_tracks
+                        editable: true
+                        from: 0
+                        to: 10
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: look_ahead_tracks.verticalCenter
+                        text: qsTr("local tracks, using at most")
+                    }
+                    SpinBox {
+                        id: look_ahead_cpu_percent
+                        editable: true
+                        from: 5
+                        to: 100
+                        stepSize: 5
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: look_ahead_tracks.verticalCenter
+                        text: qsTr("% CPU")
+                    }
+                }
+                Row {
+                    CheckBox {
+                        id: library_scan
+                        text: qsTr("Analyze local music directories in the background, paused on battery or high load")
+                    }
+                }
+                Row {
+                    CheckBox {
+                        id: segmented_analysis
+                        text: qsTr("Analyze long WAV and FLAC files on all processor cores")
+                    }
+                }
+                Row {
+                    CheckBox {
+                        id: http2
+                        text: qsTr("Use HTTP/2 with servers that support it")
+                    }
+                }
+                Row {
+                    Label {
+                        width: parent.parent.width / 4
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: prefetch_tracks.verticalCenter
+                        text: qsTr("Download in advance")
+                    }
+                    SpinBox {
+                        id: prefetch_tracks
+                        editable: true
+                        from: 0
+                        to: 10
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: prefetch_tracks.verticalCenter
+                        text: qsTr("remote tracks, keeping at most")
+                    }
+                    SpinBox {
+                        id: prefetch_mb
+                        editable: true
+                        from: 16
+                        to: 1024
+                        stepSize: 16
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: prefetch_tracks.verticalCenter
+                        text: qsTr("MB")
+                    }
+                }
+                Row {
+                    CheckBox {
+                        id: adaptive_bitrate
+                        text: qsTr("Lower the bitrate of Ampache streams when the connection is slow")
+                    }
+                }
+                Row {
+                    Label {
+                        width: parent.parent.width / 4
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: download_connections.verticalCenter
+                        text: qsTr("Download large files on")
+                    }
+                    SpinBox {
+                        id: download_connections
+                        editable: true
+                        from: 1
+                        to: 6
+                    }
+                    Label {
+                        anchors.rightMargin: 17
+                        anchors.verticalCenter: download_connections.verticalCenter
+                        text: qsTr("connections")
+                    }
+                }
                 Row {
                     topPadding: 17
                     bottomPadding: 17
@@ -993,14 +1183,14 @@ Dialog {
                     leftPadding: 9
                     Label {
                         width: parent.parent.width / 4 - 9
-                        anchors.verticalCenter: max_peak_fps.verticalCenter
-                        text: qsTr("Maximum Frames Per Second")
+                        anchors.verticalCenter: spectrum_bands.verticalCenter
+                        text: qsTr("Spectrum Bands <i>(click the peak meter to switch)</i>")
                         wrapMode: Label.WrapAtWordBoundaryOrAnywhere
                     }
                     SpinBox {
-                        id: max_peak_fps
-                        from: 10
-                        to: 50
+                        id: spectrum_bands
+                        from: 4
+                        to: 128
                     }
                 }
                 Row {
@@ -1064,6 +1254,28 @@ Dialog {
                         text: qsTr("seconds")
                     }
                 }
+                Row {
+                    Label {
+                        width: parent.parent.width / 4
+                        anchors.verticalCenter: fade_curve.verticalCenter
+                        text: qsTr("Fade Curve")
+                    }
+                    ComboBox {
+                        id: fade_curve
+                        width: parent.parent.width / 3
+                        model: ListModel {
+                            ListElement {
+                                text: qsTr("Linear")
+                            }
+                            ListElement {
+                                text: qsTr("Equal Power")
+                            }
+                            ListElement {
+                                text: qsTr("Logarithmic")
+                            }
+                        }
+                    }
+                }
             }
         }
     }
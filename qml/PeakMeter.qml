@@ -37,10 +37,43 @@ Item {
     }
 
 
+    function refresh()
+    {
+        var levels = peakReader.levels();
+
+        if (levels.length < 3) {
+            setPeak(1, 1);
+            setReplayGain(0);
+            return;
+        }
+
+        setPeak(1 - levels[0], 1 - levels[1]);
+        setReplayGain(levels[2]);
+    }
+
+
     QtObject {
         id: internal
 
         property double replayGainValue: 0
+        property double frameTick: 0
+    }
+
+
+    // animations are driven by the render loop, so this ticks once per displayed frame
+    NumberAnimation {
+        target: internal
+        property: "frameTick"
+        from: 0
+        to: 1
+        duration: 1000
+        loops: Animation.Infinite
+        running: visible
+    }
+
+    Connections {
+        target: internal
+        onFrameTickChanged: refresh()
     }
 
 
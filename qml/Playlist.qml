@@ -43,6 +43,7 @@ Item {
             busy: false,
             downloadPercent: 0,
             pcmPercent: 0,
+            bufferData: "",
             ampacheURL: ampacheURL,
             isError: false,
             errorMessage: "",
@@ -80,6 +81,13 @@ Item {
         }
     }
 
+    function setBufferData(index, memoryUsageText)
+    {
+        if (playlistItems.get(index).bufferData !== memoryUsageText) {
+            playlistItems.setProperty(index, "bufferData", memoryUsageText);
+        }
+    }
+
     function setBusy(index, busy)
     {
         playlistItems.setProperty(index, "busy", busy);
@@ -509,8 +517,8 @@ Item {
 
                 ToolTip {
                     delay: 500
-                    text: isError ? errorMessage : title
-                    visible: hoverHandler.hovered && (isError || titleLabel.truncated)
+                    text: isError ? errorMessage : bufferData.length > 0 ? title + " (" + bufferData + ")" : title
+                    visible: hoverHandler.hovered && (isError || titleLabel.truncated || (bufferData.length > 0))
                     y: hoverHandler.point.position.y + imageSize
                     x: hoverHandler.point.position.x
                 }
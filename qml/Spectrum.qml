@@ -0,0 +1,64 @@
+import QtQml 2.3
+import QtQuick 2.12
+
+Item {
+    property bool  borderVisible: true
+    property color borderColor: "#666666"
+
+    onVisibleChanged: {
+        spectrumAnalyzer.setVisible(visible);
+        if (!visible) {
+            internal.bandValues = [];
+        }
+    }
+
+
+    QtObject {
+        id: internal
+
+        property var bandValues: []
+    }
+
+
+    Timer {
+        interval: 33
+        repeat: true
+        running: visible
+
+        onTriggered: {
+            internal.bandValues = spectrumAnalyzer.bands();
+        }
+    }
+
+
+    Rectangle {
+        anchors.fill: parent
+        border.color: borderColor
+        color: "transparent"
+        visible: borderVisible
+    }
+
+    Row {
+        id: bars
+
+        anchors.fill: parent
+        anchors.margins: 5
+        spacing: 1
+
+        Repeater {
+            model: internal.bandValues.length
+
+            Rectangle {
+                anchors.bottom: parent.bottom
+                width: (bars.width - bars.spacing * (internal.bandValues.length - 1)) / internal.bandValues.length
+                height: bars.height * internal.bandValues[index]
+                gradient: Gradient {
+                    GradientStop { position: 0;    color: "red" }
+                    GradientStop { position: 0.33; color: "orange" }
+                    GradientStop { position: 0.8;  color: "green" }
+                    GradientStop { position: 1;    color: "darkgreen" }
+                }
+            }
+        }
+    }
+}
@@ -6,12 +6,11 @@
 
 
 #include "replaygaincalculator.h"
+#include "silencescanner.h"
 
 // constructor
 ReplayGainCalculator::ReplayGainCalculator(IIRFilter::SampleTypes sampleType, int sampleRate)
 {
-    qRegisterMetaType<ReplayGainCalculator::Silences>("ReplayGainCalculator::Silences");
-
     this->sampleType = sampleType;
     this->sampleRate = sampleRate;
 
@@ -50,13 +49,18 @@ ReplayGainCalculator::ReplayGainCalculator(IIRFilter::SampleTypes sampleType, in
             sampleMax = std::numeric_limits<float>::max();
             break;
     }
-    sampleRange      = sampleMax - sampleMin;
-    silenceThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * sampleMax;
+    sampleRange = sampleMax - sampleMin;
 
     stereoRmsSum = 0.0;
     countRmsSum  = 0;
-    framesCount  = 0;
-    silenceStart = 0;
+
+    silenceScanner    = nullptr;
+    silenceBlockCount = 0;
+
+    statsTreeTopStep = 1;
+    while (statsTreeTopStep * 2 <= STATS_TABLE_SIZE) {
+        statsTreeTopStep *= 2;
+    }
 
     reset();
 }
@@ -102,77 +106,101 @@ void ReplayGainCalculator::filterCallback(double *sample, int channelIndex)
         }
 
         // increase the appropriate slot in the staticstics table
-        statsTable[(int)rmsAverageTableSlot]++;
+        statsTreeIncrement((int)rmsAverageTableSlot);
 
         // reset variables
         stereoRmsSum = 0.0;
         countRmsSum  = 0;
     }
 
-    // silence detector (only record silences longer then specified except for silence at the beginning of track)
-    if (!silenceStart && (abs(sampleValue) <= silenceThreshold)) {
-        silenceStart = static_cast<qint64>(floor((double)framesCount / sampleRate * 1000000));
-    }
-    if ((silenceStart || (silences.count() == 0)) && (abs(sampleValue) > silenceThreshold)) {
-        qint64 silenceEnd = static_cast<qint64>(floor(static_cast<double>(framesCount - 1) / sampleRate * 1000000));
-        if (silences.count() == 0) {
-            silences.append({ SilenceAtBeginning, silenceStart, silenceEnd });
-        }
-        else if (silenceEnd - silenceStart >= SILENCE_MIN_MICROSEC) {
-            silences.append({ SilenceIntermediate, silenceStart, silenceEnd });
+    // silence detector
+    if (silenceScanner != nullptr) {
+        silenceBlock[silenceBlockCount] = sampleValue;
+        silenceBlockCount++;
+        if (silenceBlockCount == SILENCE_BLOCK_SAMPLES) {
+            flushSilenceScanner();
         }
-        silenceStart = 0;
     }
-    if (channelIndex == 1) {
-        framesCount++;
+}
+
+
+// must be called after the filter is done with a buffer, so the silences are up to date
+void ReplayGainCalculator::flushSilenceScanner()
+{
+    if ((silenceScanner != nullptr) && (silenceBlockCount > 0)) {
+        silenceScanner->processFilteredSamples(silenceBlock, silenceBlockCount);
     }
+    silenceBlockCount = 0;
 }
 
 
-// calculations to get the result
-double ReplayGainCalculator::calculateResult()
+// adds the histogram of another segment of the same track, Fenwick trees of the same size add up element by element
+void ReplayGainCalculator::append(ReplayGainCalculator *next)
 {
-    long sum = 0;
-    for (int i = 0; i < (STATS_MAX_DB * STATS_STEPS_PER_DB); i++) {
-        sum += statsTable[i];
+    for (int i = 1; i <= STATS_TABLE_SIZE; i++) {
+        statsTree[i] += next->statsTree[i];
     }
+    statsSum += next->statsSum;
+}
+
 
-    if (sum == 0) {
+// calculations to get the result
+double ReplayGainCalculator::calculateResult()
+{
+    if (statsSum == 0) {
         return 0.0;
     }
 
-    int percepted = (int)ceil(sum * (1. - STATS_RMS_PERCEPTION));
+    int percepted = (int)ceil(statsSum * (1. - STATS_RMS_PERCEPTION));
 
-    int statElement;
-    for (statElement = (STATS_MAX_DB * STATS_STEPS_PER_DB); statElement-- > 0;) {
-        if ((percepted -= statsTable[statElement]) <= 0) {
-            break;
-        }
-    }
+    // highest slot where the slots from it to the top hold at least the percepted number of blocks
+    int statElement = statsTreeFind(statsSum - percepted);
 
     return (double)(PINK_NOISE_REFERENCE - (double)statElement / (double)STATS_STEPS_PER_DB);
 }
 
 
-QVector<ReplayGainCalculator::SilenceRange> ReplayGainCalculator::getSilences(bool addFinalSilence)
+// reset
+void ReplayGainCalculator::reset()
 {
-    QVector<SilenceRange> aCopy(silences);
+    stereoRmsSum = 0.0;
+    countRmsSum  = 0;
 
-    // silence at the end of track (set flag only after decoding has finished)
-    if (addFinalSilence && silenceStart) {
-        aCopy.append({ SilenceAtEnd, silenceStart, static_cast<qint64>(floor(static_cast<double>(framesCount - 1) / sampleRate * 1000000)) });
-    }
+    memset(&statsTree, 0, (STATS_TABLE_SIZE + 1) * sizeof(unsigned int));
+    statsSum = 0;
 
-    return aCopy;
+    silenceBlockCount = 0;
 }
 
 
-// reset
-void ReplayGainCalculator::reset()
+void ReplayGainCalculator::setSilenceScanner(SilenceScanner *silenceScanner)
 {
-    stereoRmsSum = 0.0;
-    countRmsSum  = 0;
+    this->silenceScanner = silenceScanner;
+}
+
+
+// O(log n) update of the histogram
+void ReplayGainCalculator::statsTreeIncrement(int slot)
+{
+    for (int i = slot + 1; i <= STATS_TABLE_SIZE; i += (i & -i)) {
+        statsTree[i]++;
+    }
+    statsSum++;
+}
+
+
+// O(log n) search for the number of slots from the bottom whose total doesn't exceed target
+int ReplayGainCalculator::statsTreeFind(long target)
+{
+    int  position  = 0;
+    long remaining = target;
+
+    for (int step = statsTreeTopStep; step > 0; step /= 2) {
+        if ((position + step <= STATS_TABLE_SIZE) && (statsTree[position + step] <= remaining)) {
+            position  += step;
+            remaining -= statsTree[position];
+        }
+    }
 
-    memset(&statsTable, 0, STATS_MAX_DB * STATS_STEPS_PER_DB * sizeof(int));
-    silences.clear();
+    return position;
 }
@@ -14,6 +14,8 @@
 #include <iirfilter.h>
 #include <iirfiltercallback.h>
 
+class SilenceScanner;
+
 
 class ReplayGainCalculator : IIRFilterCallback {
 
@@ -33,21 +35,24 @@ class ReplayGainCalculator : IIRFilterCallback {
 
         ReplayGainCalculator(IIRFilter::SampleTypes sampleType, int sampleRate);
 
-        void     filterCallback(double *sample, int channelIndex) override;
-        double   calculateResult();
-        Silences getSilences(bool addFinalSilence);
-        void     reset();
+        void   filterCallback(double *sample, int channelIndex) override;
+        double calculateResult();
+        void   append(ReplayGainCalculator *next);
+        void   reset();
+        void   setSilenceScanner(SilenceScanner *silenceScanner);
+        void   flushSilenceScanner();
 
 
     private:
 
-        static constexpr double RMS_BLOCK_SECONDS    = 0.05;
-        static const     int    STATS_MAX_DB         = 120;
-        static const     int    STATS_STEPS_PER_DB   = 100;
-        static const     int    STATS_TABLE_MAX      = (STATS_MAX_DB *STATS_STEPS_PER_DB) - 1;
-        static constexpr double STATS_RMS_PERCEPTION = 0.95;
-        static constexpr double PINK_NOISE_REFERENCE = 64.82;
-        static const     int    SILENCE_MIN_MICROSEC = 2750000;
+        static constexpr double RMS_BLOCK_SECONDS     = 0.05;
+        static const     int    STATS_MAX_DB          = 120;
+        static const     int    STATS_STEPS_PER_DB    = 100;
+        static const     int    STATS_TABLE_SIZE      = STATS_MAX_DB * STATS_STEPS_PER_DB;
+        static const     int    STATS_TABLE_MAX       = (STATS_MAX_DB *STATS_STEPS_PER_DB) - 1;
+        static constexpr double STATS_RMS_PERCEPTION  = 0.95;
+        static constexpr double PINK_NOISE_REFERENCE  = 64.82;
+        static const     int    SILENCE_BLOCK_SAMPLES = 1024;
 
         IIRFilter::SampleTypes sampleType;
         int                    sampleRate;
@@ -59,16 +64,22 @@ class ReplayGainCalculator : IIRFilterCallback {
         double int16Range;
         double sampleMin;
         double sampleRange;
-        double silenceThreshold;
 
         double stereoRmsSum;
         int    countRmsSum;
-        qint64 framesCount;
-        qint64 silenceStart;
 
-        QVector<SilenceRange> silences;
+        // filtered samples are handed to the silence scanner in blocks
+        SilenceScanner *silenceScanner;
+        double          silenceBlock[SILENCE_BLOCK_SAMPLES];
+        int             silenceBlockCount;
+
+        // Fenwick tree over the RMS histogram, index 0 is unused
+        unsigned int statsTree[STATS_TABLE_SIZE + 1];
+        long         statsSum;
+        int          statsTreeTopStep;
 
-        unsigned int statsTable[STATS_MAX_DB * STATS_STEPS_PER_DB];
+        void statsTreeIncrement(int slot);
+        int  statsTreeFind(long target);
 };
 
 
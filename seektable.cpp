@@ -0,0 +1,210 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "seektable.h"
+
+
+SeekTable::SeekTable()
+{
+    format            = Unknown;
+    audioStart        = 0;
+    kilobitsPerSecond = 0;
+}
+
+
+quint32 SeekTable::bigEndian(const QByteArray &head, int position, int byteCount)
+{
+    quint32 value = 0;
+    for (int i = 0; i < byteCount; i++) {
+        value = (value << 8) | static_cast<uchar>(head.at(position + i));
+    }
+    return value;
+}
+
+
+int SeekTable::bitrate() const
+{
+    return kilobitsPerSecond;
+}
+
+
+// linear for constant bitrate, otherwise interpolated in the table
+qint64 SeekTable::byteOffset(double fraction, qint64 totalBytes) const
+{
+    fraction = qBound(0.0, fraction, 1.0);
+
+    qint64 audioBytes = totalBytes - audioStart;
+    if (audioBytes <= 0) {
+        return 0;
+    }
+
+    double byteFraction = fraction;
+    if (table.count() > 0) {
+        double point = fraction * table.count();
+        int    index = qMin(static_cast<int>(point), table.count() - 1);
+        double next  = index + 1 < table.count() ? table.at(index + 1) : 1.0;
+
+        byteFraction = table.at(index) + (next - table.at(index)) * (point - index);
+    }
+
+    return audioStart + static_cast<qint64>(byteFraction * audioBytes);
+}
+
+
+bool SeekTable::isSeekable() const
+{
+    return format != Unknown;
+}
+
+
+// returns false while more of the beginning of the stream is needed
+bool SeekTable::parse(const QByteArray &head)
+{
+    format            = Unknown;
+    audioStart        = 0;
+    kilobitsPerSecond = 0;
+    table.clear();
+
+    if (head.size() < 10) {
+        return false;
+    }
+
+    // ID3v2 tag, size is syncsafe
+    if (head.startsWith("ID3")) {
+        audioStart = 10 + ((bigEndian(head, 6, 1) & 0x7F) << 21) + ((bigEndian(head, 7, 1) & 0x7F) << 14) + ((bigEndian(head, 8, 1) & 0x7F) << 7) + (bigEndian(head, 9, 1) & 0x7F);
+        if (head.at(5) & 0x10) {
+            audioStart += 10;
+        }
+    }
+
+    // room for the first frame with the Xing or VBRI header in it
+    if (head.size() < audioStart + FIRST_FRAME_BYTES) {
+        return false;
+    }
+
+    uchar sync  = static_cast<uchar>(head.at(audioStart));
+    uchar flags = static_cast<uchar>(head.at(audioStart + 1));
+    if ((sync != 0xFF) || ((flags & 0xE0) != 0xE0)) {
+        // FLAC, Ogg, MP4 and the like
+        return true;
+    }
+
+    // layer bits are zero in ADTS, there's no seek table in it
+    if ((flags & 0x06) == 0) {
+        format = ADTS;
+        return true;
+    }
+
+    format = MPEGAudio;
+
+    static const int bitrates[5][16] = {
+        { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448, 0 },    // MPEG-1 layer I
+        { 0, 32, 48, 56, 64,  80,  96,  112, 128, 160, 192, 224, 256, 320, 384, 0 },    // MPEG-1 layer II
+        { 0, 32, 40, 48, 56,  64,  80,  96,  112, 128, 160, 192, 224, 256, 320, 0 },    // MPEG-1 layer III
+        { 0, 32, 48, 56, 64,  80,  96,  112, 128, 144, 160, 176, 192, 224, 256, 0 },    // MPEG-2 and 2.5 layer I
+        { 0, 8,  16, 24, 32,  40,  48,  56,  64,  80,  96,  112, 128, 144, 160, 0 }     // MPEG-2 and 2.5 layer II and III
+    };
+    static const int sampleRates[3] = { 44100, 48000, 32000 };
+
+    int  version = (flags >> 3) & 0x03;
+    int  layer   = 4 - ((flags >> 1) & 0x03);
+    bool mpeg1   = version == 0x03;
+    bool mono    = ((static_cast<uchar>(head.at(audioStart + 3)) >> 6) & 0x03) == 0x03;
+
+    uchar rateBits        = static_cast<uchar>(head.at(audioStart + 2));
+    int   bitrateIndex    = rateBits >> 4;
+    int   sampleRateIndex = (rateBits >> 2) & 0x03;
+
+    int sampleRate      = sampleRateIndex < 3 ? sampleRates[sampleRateIndex] / (mpeg1 ? 1 : (version == 0x02 ? 2 : 4)) : 0;
+    int samplesPerFrame = layer == 1 ? 384 : ((layer == 3) && !mpeg1 ? 576 : 1152);
+
+    kilobitsPerSecond = bitrates[mpeg1 ? layer - 1 : (layer == 1 ? 3 : 4)][bitrateIndex];
+
+    int sideInfoSize = mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+
+    if (!parseXing(head, audioStart + 4 + sideInfoSize, sampleRate, samplesPerFrame)) {
+        parseVBRI(head, audioStart + 4 + 32);
+    }
+
+    return true;
+}
+
+
+bool SeekTable::parseVBRI(const QByteArray &head, int position)
+{
+    if (head.mid(position, 4) != "VBRI") {
+        return false;
+    }
+
+    int entryCount = bigEndian(head, position + 18, 2);
+    int scale      = bigEndian(head, position + 20, 2);
+    int entrySize  = bigEndian(head, position + 22, 2);
+
+    if ((entryCount < 1) || (entrySize < 1) || (entrySize > 4) || (head.size() < position + 26 + entryCount * entrySize)) {
+        return false;
+    }
+
+    // entries are byte counts of equally long parts
+    QVector<double> byteCounts;
+    double          totalBytes = 0;
+    for (int i = 0; i < entryCount; i++) {
+        double byteCount = static_cast<double>(bigEndian(head, position + 26 + i * entrySize, entrySize)) * scale;
+        byteCounts.append(byteCount);
+        totalBytes += byteCount;
+    }
+    if (totalBytes <= 0) {
+        return false;
+    }
+
+    double sum = 0;
+    foreach (double byteCount, byteCounts) {
+        table.append(sum / totalBytes);
+        sum += byteCount;
+    }
+
+    return true;
+}
+
+
+// the first frame's bitrate is replaced with the average if frame count and byte count are present
+bool SeekTable::parseXing(const QByteArray &head, int position, int sampleRate, int samplesPerFrame)
+{
+    QByteArray tag = head.mid(position, 4);
+    if ((tag != "Xing") && (tag != "Info")) {
+        return false;
+    }
+
+    quint32 flags = bigEndian(head, position + 4, 4);
+
+    // frame count and byte count come before the table if they're present
+    int tablePosition = position + 8;
+    if (flags & 0x01) {
+        tablePosition += 4;
+    }
+    if (flags & 0x02) {
+        tablePosition += 4;
+    }
+
+    if ((flags & 0x01) && (flags & 0x02) && (sampleRate > 0)) {
+        double frameCount = bigEndian(head, position + 8, 4);
+        double byteCount  = bigEndian(head, position + 12, 4);
+        if (frameCount > 0) {
+            kilobitsPerSecond = static_cast<int>(byteCount * 8 * sampleRate / (frameCount * samplesPerFrame) / 1000);
+        }
+    }
+
+    // no table means constant bitrate
+    if (!(flags & 0x04) || (head.size() < tablePosition + 100)) {
+        return true;
+    }
+
+    for (int i = 0; i < 100; i++) {
+        table.append(bigEndian(head, tablePosition + i, 1) / 256.0);
+    }
+
+    return true;
+}
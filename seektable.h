@@ -0,0 +1,59 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SEEKTABLE_H
+#define SEEKTABLE_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <QVector>
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// maps a position in time to a byte offset in the compressed stream, so downloading can start from there
+class SeekTable
+{
+    public:
+
+        SeekTable();
+
+        bool   parse(const QByteArray &head);
+        bool   isSeekable() const;
+        qint64 byteOffset(double fraction, qint64 totalBytes) const;
+        int    bitrate() const;
+
+
+    private:
+
+        static const int FIRST_FRAME_BYTES = 2048;
+
+        // decoders can pick these up from any frame, other containers need their headers
+        enum Format {
+            Unknown,
+            MPEGAudio,
+            ADTS
+        };
+
+        Format format;
+        qint64 audioStart;
+
+        // kilobits per second, average if the Xing header has the counts, zero if unknown
+        int kilobitsPerSecond;
+
+        // byte fraction at evenly spaced points in time, empty for constant bitrate
+        QVector<double> table;
+
+        bool parseXing(const QByteArray &head, int position, int sampleRate, int samplesPerFrame);
+        bool parseVBRI(const QByteArray &head, int position);
+
+        static quint32 bigEndian(const QByteArray &head, int position, int byteCount);
+};
+
+#endif // SEEKTABLE_H
@@ -0,0 +1,466 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "segmentedanalyzer.h"
+
+
+SegmentedAnalyzer::SegmentedAnalyzer(QString filePath, QAudioFormat decodedFormat, QObject *parent) : QObject(parent)
+{
+    this->filePath      = filePath;
+    this->decodedFormat = decodedFormat;
+
+    engine      = Analyzer::ReplayGainEngine;
+    silenceOnly = false;
+}
+
+
+SegmentedAnalyzer::~SegmentedAnalyzer()
+{
+    stopSegments();
+}
+
+
+void SegmentedAnalyzer::analyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences)
+{
+    Q_UNUSED(replayGain);
+    Q_UNUSED(peak);
+    Q_UNUSED(silences);
+
+    int index = segmentIndex(sender());
+    if (index < 0) {
+        return;
+    }
+    segments.at(index)->analyzed = true;
+
+    foreach (Segment *segment, segments) {
+        if (!segment->analyzed) {
+            return;
+        }
+    }
+
+    // every analyzer is idle now, so the later segments can be merged into the first one
+    Analyzer *first              = segments.first()->analyzer;
+    qint64    lengthMicroseconds = 0;
+    for (int i = 0; i < segments.count(); i++) {
+        if (i > 0) {
+            first->appendSegment(segments.at(i)->analyzer);
+        }
+        lengthMicroseconds += segments.at(i)->decodedMicroseconds;
+    }
+
+    double                         finalGain     = first->calculateResult();
+    double                         finalPeak     = first->getPeak();
+    ReplayGainCalculator::Silences finalSilences = first->getSilences(true);
+
+    stopSegments();
+
+    emit finished(finalGain, finalPeak, finalSilences, lengthMicroseconds / 1000);
+}
+
+
+void SegmentedAnalyzer::bufferAvailableFromDecoder(QAudioBuffer *buffer)
+{
+    // might be still in the event queue after the segments were stopped
+    int index = segmentIndex(sender());
+    if (index < 0) {
+        delete buffer;
+        return;
+    }
+
+    Segment *segment = segments.at(index);
+
+    segment->analyzerQueueMutex.lock();
+    segment->analyzerQueue.append(buffer);
+    segment->analyzerQueueMutex.unlock();
+
+    QMetaObject::invokeMethod(segment->analyzer, "bufferAvailable", Qt::QueuedConnection);
+}
+
+
+void SegmentedAnalyzer::decoderError(QString info, QString errorMessage)
+{
+    Q_UNUSED(info);
+    Q_UNUSED(errorMessage);
+
+    if (segmentIndex(sender()) < 0) {
+        return;
+    }
+
+    // the track's own analyzer is still running, it will have the results
+    stopSegments();
+}
+
+
+void SegmentedAnalyzer::decoderFinished()
+{
+    int index = segmentIndex(sender());
+    if (index < 0) {
+        return;
+    }
+
+    Segment *segment = segments.at(index);
+
+    segment->decodedMicroseconds = segment->decoder->getDecodedMicroseconds();
+
+    QMetaObject::invokeMethod(segment->analyzer, "decoderDone", Qt::QueuedConnection);
+}
+
+
+// sync code, valid fields and matching CRC-8, a false match in the middle of compressed audio is very unlikely
+bool SegmentedAnalyzer::isFlacFrameHeader(const QByteArray &bytes, int position)
+{
+    if (position + 6 > bytes.size()) {
+        return false;
+    }
+
+    const unsigned char *header = reinterpret_cast<const unsigned char *>(bytes.constData()) + position;
+
+    if ((header[0] != 0xFF) || ((header[1] & 0xFE) != 0xF8)) {
+        return false;
+    }
+
+    int blockSizeCode  = header[2] >> 4;
+    int sampleRateCode = header[2] & 0x0F;
+    int channelCode    = header[3] >> 4;
+    int sampleSizeCode = (header[3] >> 1) & 0x07;
+    if ((blockSizeCode == 0) || (sampleRateCode == 0x0F) || (channelCode > 10) || (sampleSizeCode == 3) || ((header[3] & 0x01) != 0)) {
+        return false;
+    }
+
+    // frame or sample number, coded like UTF-8
+    int length     = 5;
+    int extraBytes = 0;
+    if ((header[4] & 0x80) != 0) {
+        if ((header[4] == 0xFF) || ((header[4] & 0xC0) == 0x80)) {
+            return false;
+        }
+        for (unsigned char mask = 0x40; (header[4] & mask) != 0; mask >>= 1) {
+            extraBytes++;
+        }
+    }
+    if (position + length + extraBytes > bytes.size()) {
+        return false;
+    }
+    for (int i = 0; i < extraBytes; i++) {
+        if ((header[length + i] & 0xC0) != 0x80) {
+            return false;
+        }
+    }
+    length += extraBytes;
+
+    if (blockSizeCode == 6) {
+        length += 1;
+    }
+    if (blockSizeCode == 7) {
+        length += 2;
+    }
+    if (sampleRateCode == 12) {
+        length += 1;
+    }
+    if ((sampleRateCode == 13) || (sampleRateCode == 14)) {
+        length += 2;
+    }
+    if ((length >= FLAC_FRAME_HEADER_MAX) || (position + length + 1 > bytes.size())) {
+        return false;
+    }
+
+    unsigned char crc = 0;
+    for (int i = 0; i < length; i++) {
+        crc ^= header[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) != 0 ? static_cast<unsigned char>((crc << 1) ^ 0x07) : static_cast<unsigned char>(crc << 1);
+        }
+    }
+
+    return crc == header[length];
+}
+
+
+// only files big enough to be worth the extra decoders
+bool SegmentedAnalyzer::isSupported(QString filePath)
+{
+    QFile file(filePath);
+    if ((file.size() < FILE_SIZE_MIN) || !file.open(QFile::ReadOnly)) {
+        return false;
+    }
+
+    QByteArray magic = file.read(4);
+    file.close();
+
+    return (magic == "RIFF") || (magic == "fLaC");
+}
+
+
+// every segment gets the stream info block, frames carry everything else
+bool SegmentedAnalyzer::prepareFlac(QFile *file, int segmentCount)
+{
+    file->seek(0);
+    if (file->read(4) != "fLaC") {
+        return false;
+    }
+
+    QByteArray streamInfo;
+    bool       lastBlock = false;
+    while (!lastBlock) {
+        QByteArray blockHeader = file->read(4);
+        if (blockHeader.size() < 4) {
+            return false;
+        }
+
+        lastBlock = (static_cast<unsigned char>(blockHeader.at(0)) & 0x80) != 0;
+
+        int    blockType   = static_cast<unsigned char>(blockHeader.at(0)) & 0x7F;
+        qint64 blockLength = (static_cast<unsigned char>(blockHeader.at(1)) << 16) | (static_cast<unsigned char>(blockHeader.at(2)) << 8) | static_cast<unsigned char>(blockHeader.at(3));
+
+        if (blockType == 0) {
+            streamInfo = file->read(blockLength);
+        }
+        else if (!file->seek(file->pos() + blockLength)) {
+            return false;
+        }
+    }
+    if (streamInfo.size() != FLAC_STREAMINFO_BYTES) {
+        return false;
+    }
+
+    // total sample count and MD5 signature become unknown, they are for the whole file
+    streamInfo[13] = static_cast<char>(streamInfo.at(13) & 0xF0);
+    for (int i = 14; i < FLAC_STREAMINFO_BYTES; i++) {
+        streamInfo[i] = 0;
+    }
+
+    QByteArray header("fLaC");
+    header.append(static_cast<char>(0x80));
+    header.append(static_cast<char>(0));
+    header.append(static_cast<char>(0));
+    header.append(static_cast<char>(FLAC_STREAMINFO_BYTES));
+    header.append(streamInfo);
+
+    qint64 audioStart = file->pos();
+    qint64 audioBytes = file->size() - audioStart;
+
+    headers.clear();
+    boundaries.clear();
+
+    boundaries.append(audioStart);
+    for (int i = 1; i < segmentCount; i++) {
+        qint64 target = audioStart + audioBytes * i / segmentCount;
+
+        file->seek(target);
+        QByteArray window = file->read(FLAC_SYNC_SEARCH_BYTES);
+
+        int frameStart = -1;
+        for (int position = 0; position < window.size(); position++) {
+            if (isFlacFrameHeader(window, position)) {
+                frameStart = position;
+                break;
+            }
+        }
+        if ((frameStart < 0) || (target + frameStart <= boundaries.last())) {
+            return false;
+        }
+        boundaries.append(target + frameStart);
+    }
+    boundaries.append(file->size());
+
+    for (int i = 0; i < segmentCount; i++) {
+        headers.append(header);
+    }
+
+    return true;
+}
+
+
+// every segment gets the file's header with the data chunk shortened to the segment
+bool SegmentedAnalyzer::prepareWav(QFile *file, int segmentCount)
+{
+    file->seek(0);
+    QByteArray riff = file->read(12);
+    if ((riff.size() < 12) || (riff.left(4) != "RIFF") || (riff.mid(8, 4) != "WAVE")) {
+        return false;
+    }
+
+    int    blockAlign = 0;
+    qint64 dataStart  = 0;
+    qint64 dataBytes  = 0;
+    while (dataStart == 0) {
+        QByteArray chunkHeader = file->read(8);
+        if (chunkHeader.size() < 8) {
+            return false;
+        }
+
+        QByteArray chunkId     = chunkHeader.left(4);
+        qint64     chunkStart  = file->pos();
+        qint64     chunkLength = qFromLittleEndian<quint32>(chunkHeader.constData() + 4);
+
+        if (chunkId == "data") {
+            dataStart = chunkStart;
+            dataBytes = qMin(chunkLength, file->size() - dataStart);
+            continue;
+        }
+
+        if (chunkId == "fmt ") {
+            QByteArray format = file->read(chunkLength);
+            if (format.size() < 16) {
+                return false;
+            }
+            blockAlign = qFromLittleEndian<quint16>(format.constData() + 12);
+        }
+
+        // chunks are padded to even length
+        if (!file->seek(chunkStart + chunkLength + (chunkLength & 1))) {
+            return false;
+        }
+    }
+    if (blockAlign <= 0) {
+        return false;
+    }
+
+    dataBytes -= dataBytes % blockAlign;
+
+    file->seek(0);
+    QByteArray header = file->read(dataStart);
+
+    headers.clear();
+    boundaries.clear();
+
+    for (int i = 0; i <= segmentCount; i++) {
+        qint64 offset = dataBytes * i / segmentCount;
+        boundaries.append(dataStart + offset - (offset % blockAlign));
+    }
+
+    for (int i = 0; i < segmentCount; i++) {
+        quint32 segmentBytes = static_cast<quint32>(boundaries.at(i + 1) - boundaries.at(i));
+
+        QByteArray segmentHeader(header);
+        qToLittleEndian<quint32>(static_cast<quint32>(segmentHeader.size() - 8 + segmentBytes), segmentHeader.data() + 4);
+        qToLittleEndian<quint32>(segmentBytes, segmentHeader.data() + segmentHeader.size() - 4);
+
+        headers.append(segmentHeader);
+    }
+
+    return true;
+}
+
+
+int SegmentedAnalyzer::segmentIndex(QObject *object)
+{
+    for (int i = 0; i < segments.count(); i++) {
+        if ((segments.at(i)->decoder == object) || (segments.at(i)->analyzer == object)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+void SegmentedAnalyzer::setEngine(Analyzer::Engine engine)
+{
+    this->engine = engine;
+}
+
+
+void SegmentedAnalyzer::setSilenceOnly(bool silenceOnly)
+{
+    this->silenceOnly = silenceOnly;
+}
+
+
+void SegmentedAnalyzer::start()
+{
+    if (segments.count() > 0) {
+        return;
+    }
+
+    int segmentCount = qBound(2, QThread::idealThreadCount(), SEGMENTS_MAX);
+
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        return;
+    }
+    bool prepared = prepareWav(&file, segmentCount) || prepareFlac(&file, segmentCount);
+    file.close();
+
+    if (!prepared) {
+        return;
+    }
+
+    for (int i = 0; i < segmentCount; i++) {
+        Segment *segment = new Segment();
+
+        segment->decoderThread.setObjectName("segmentdecoder");
+        segment->analyzerThread.setObjectName("segmentanalyzer");
+        segment->decodedMicroseconds = 0;
+        segment->analyzed            = false;
+
+        SegmentSource *source = new SegmentSource(filePath, headers.at(i), boundaries.at(i), boundaries.at(i + 1));
+        source->moveToThread(&segment->decoderThread);
+
+        // leading silence is trimmed by the track's decoder, so the timeline must be trimmed the same way
+        segment->decoder = new DecoderGeneric({ nullptr, nullptr });
+        segment->decoder->setParameters(QUrl::fromLocalFile(filePath), decodedFormat, 4096, false, i == 0);
+        segment->decoder->setSourceDevice(source);
+        segment->decoder->setDecodeDelay(0);
+        segment->decoder->moveToThread(&segment->decoderThread);
+
+        segment->analyzer = new Analyzer(decodedFormat);
+        segment->analyzer->setBufferQueue(&segment->analyzerQueue, &segment->analyzerQueueMutex);
+        segment->analyzer->setSilenceOnly(silenceOnly);
+        segment->analyzer->setEngine(engine);
+        segment->analyzer->moveToThread(&segment->analyzerThread);
+
+        connect(&segment->decoderThread,  &QThread::started, segment->decoder,  &DecoderGeneric::run);
+        connect(&segment->analyzerThread, &QThread::started, segment->analyzer, &Analyzer::run);
+
+        connect(segment->decoder, &DecoderGeneric::bufferAvailable, this, &SegmentedAnalyzer::bufferAvailableFromDecoder);
+        connect(segment->decoder, &DecoderGeneric::finished,        this, &SegmentedAnalyzer::decoderFinished);
+        connect(segment->decoder, &DecoderGeneric::errorMessage,    this, &SegmentedAnalyzer::decoderError);
+
+        connect(segment->analyzer, &Analyzer::analysisFinished, this, &SegmentedAnalyzer::analyzerFinished);
+
+        segments.append(segment);
+    }
+
+    // playback runs at normal priority, so the segments can't make it stutter
+    foreach (Segment *segment, segments) {
+        segment->analyzerThread.start(QThread::LowPriority);
+        segment->decoderThread.start(QThread::LowPriority);
+
+        QMetaObject::invokeMethod(segment->decoder, "start", Qt::QueuedConnection);
+    }
+}
+
+
+void SegmentedAnalyzer::stopSegments()
+{
+    foreach (Segment *segment, segments) {
+        segment->decoderThread.requestInterruption();
+        segment->decoderThread.quit();
+        segment->decoderThread.wait();
+
+        disconnect(segment->decoder, &DecoderGeneric::bufferAvailable, this, &SegmentedAnalyzer::bufferAvailableFromDecoder);
+        disconnect(segment->decoder, &DecoderGeneric::finished,        this, &SegmentedAnalyzer::decoderFinished);
+        disconnect(segment->decoder, &DecoderGeneric::errorMessage,    this, &SegmentedAnalyzer::decoderError);
+
+        delete segment->decoder;
+
+        segment->analyzerThread.requestInterruption();
+        segment->analyzerThread.quit();
+        segment->analyzerThread.wait();
+
+        disconnect(segment->analyzer, &Analyzer::analysisFinished, this, &SegmentedAnalyzer::analyzerFinished);
+
+        delete segment->analyzer;
+
+        foreach (QAudioBuffer *buffer, segment->analyzerQueue) {
+            delete buffer;
+        }
+
+        delete segment;
+    }
+    segments.clear();
+}
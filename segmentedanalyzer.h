@@ -0,0 +1,103 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SEGMENTEDANALYZER_H
+#define SEGMENTEDANALYZER_H
+
+#include <QAudioBuffer>
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+#include <QString>
+#include <QtEndian>
+#include <QtGlobal>
+#include <QThread>
+#include <QUrl>
+#include <QVector>
+
+#include "analyzer.h"
+#include "decodergeneric.h"
+#include "globals.h"
+#include "replaygaincalculator.h"
+#include "segmentsource.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// splits a long WAV or FLAC file into segments that are decoded and analyzed in parallel, then merges the results
+class SegmentedAnalyzer : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        explicit SegmentedAnalyzer(QString filePath, QAudioFormat decodedFormat, QObject *parent = nullptr);
+        ~SegmentedAnalyzer();
+
+        void setEngine(Analyzer::Engine engine);
+        void setSilenceOnly(bool silenceOnly);
+        void start();
+
+        static bool isSupported(QString filePath);
+
+
+    private:
+
+        static const qint64 FILE_SIZE_MIN          = 64 * 1024 * 1024;
+        static const int    SEGMENTS_MAX           = 8;
+        static const int    FLAC_STREAMINFO_BYTES  = 34;
+        static const int    FLAC_SYNC_SEARCH_BYTES = 256 * 1024;
+        static const int    FLAC_FRAME_HEADER_MAX  = 16;
+
+        struct Segment {
+            QThread         decoderThread;
+            QThread         analyzerThread;
+            DecoderGeneric *decoder;
+            Analyzer       *analyzer;
+            BufferQueue     analyzerQueue;
+            QMutex          analyzerQueueMutex;
+            qint64          decodedMicroseconds;
+            bool            analyzed;
+        };
+
+        QString          filePath;
+        QAudioFormat     decodedFormat;
+        Analyzer::Engine engine;
+        bool             silenceOnly;
+
+        QVector<QByteArray> headers;
+        QVector<qint64>     boundaries;
+        QVector<Segment *>  segments;
+
+        bool prepareFlac(QFile *file, int segmentCount);
+        bool prepareWav(QFile *file, int segmentCount);
+        int  segmentIndex(QObject *object);
+        void stopSegments();
+
+        static bool isFlacFrameHeader(const QByteArray &bytes, int position);
+
+
+    private slots:
+
+        void analyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences);
+        void bufferAvailableFromDecoder(QAudioBuffer *buffer);
+        void decoderError(QString info, QString errorMessage);
+        void decoderFinished();
+
+
+    signals:
+
+        void finished(double replayGain, double peak, ReplayGainCalculator::Silences silences, qint64 lengthMilliseconds);
+};
+
+#endif // SEGMENTEDANALYZER_H
@@ -0,0 +1,84 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "segmentsource.h"
+
+// constructor
+SegmentSource::SegmentSource(QString filePath, QByteArray header, qint64 startPosition, qint64 endPosition) : QIODevice()
+{
+    file.setFileName(filePath);
+
+    this->header        = header;
+    this->startPosition = startPosition;
+    this->endPosition   = endPosition;
+}
+
+
+void SegmentSource::close()
+{
+    file.close();
+    QIODevice::close();
+}
+
+
+bool SegmentSource::isSequential() const
+{
+    return false;
+}
+
+
+bool SegmentSource::open(OpenMode mode)
+{
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    return QIODevice::open(mode);
+}
+
+
+// header first, then the file's bytes from the start of the segment
+qint64 SegmentSource::readData(char *data, qint64 maxlen)
+{
+    qint64 position  = pos();
+    qint64 readBytes = 0;
+
+    if (position < header.size()) {
+        readBytes = qMin(maxlen, header.size() - position);
+        memcpy(data, header.constData() + position, readBytes);
+        position += readBytes;
+    }
+
+    if ((readBytes < maxlen) && (position < size())) {
+        qint64 filePosition = startPosition + position - header.size();
+        if (!file.seek(filePosition)) {
+            return readBytes > 0 ? readBytes : -1;
+        }
+
+        qint64 fileBytes = file.read(data + readBytes, qMin(maxlen - readBytes, endPosition - filePosition));
+        if (fileBytes < 0) {
+            return readBytes > 0 ? readBytes : -1;
+        }
+        readBytes += fileBytes;
+    }
+
+    return readBytes;
+}
+
+
+qint64 SegmentSource::size() const
+{
+    return header.size() + endPosition - startPosition;
+}
+
+
+qint64 SegmentSource::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(len);
+
+    return -1;
+}
@@ -0,0 +1,48 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SEGMENTSOURCE_H
+#define SEGMENTSOURCE_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QIODevice>
+#include <QString>
+#include <QtGlobal>
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// a byte range of a file behind a copy of the file's header, so a decoder can start in the middle of the audio data
+class SegmentSource : public QIODevice
+{
+    Q_OBJECT
+
+    public:
+
+        SegmentSource(QString filePath, QByteArray header, qint64 startPosition, qint64 endPosition);
+
+        qint64 readData(char *data, qint64 maxlen)     override;
+        qint64 writeData(const char *data, qint64 len) override;
+
+        bool   open(OpenMode mode) override;
+        void   close()             override;
+        bool   isSequential() const override;
+        qint64 size()         const override;
+
+
+    private:
+
+        QFile      file;
+        QByteArray header;
+        qint64     startPosition;
+        qint64     endPosition;
+};
+
+#endif // SEGMENTSOURCE_H
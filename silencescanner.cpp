@@ -0,0 +1,319 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "silencescanner.h"
+
+// constructor
+SilenceScanner::SilenceScanner(IIRFilter::SampleTypes sampleType, int sampleRate, int channelCount)
+{
+    qRegisterMetaType<ReplayGainCalculator::Silences>("ReplayGainCalculator::Silences");
+
+    this->sampleType   = sampleType;
+    this->sampleRate   = sampleRate;
+    this->channelCount = qMax(channelCount, 1);
+
+    fullScale = 1.0;
+    offset    = 0.0;
+    switch (sampleType) {
+        case IIRFilter::Unknown:
+        case IIRFilter::floatSample:
+            break;
+        case IIRFilter::int8Sample:
+            fullScale = std::numeric_limits<qint8>::max();
+            break;
+        case IIRFilter::uint8Sample:
+            fullScale = std::numeric_limits<qint8>::max();
+            offset    = 128;
+            break;
+        case IIRFilter::int16Sample:
+            fullScale = std::numeric_limits<qint16>::max();
+            break;
+        case IIRFilter::uint16Sample:
+            fullScale = std::numeric_limits<qint16>::max();
+            offset    = 32768;
+            break;
+        case IIRFilter::int32Sample:
+            fullScale = std::numeric_limits<qint32>::max();
+            break;
+        case IIRFilter::uint32Sample:
+            fullScale = std::numeric_limits<qint32>::max();
+            offset    = 2147483648.0;
+            break;
+    }
+    threshold         = pow(10, SILENCE_THRESHOLD_DB / 10) * fullScale;
+    filteredThreshold = pow(10, SILENCE_THRESHOLD_DB / 10) * std::numeric_limits<qint16>::max();
+    filteredInput     = false;
+
+    bytesPerFrame = this->channelCount;
+    switch (sampleType) {
+        case IIRFilter::int16Sample:
+        case IIRFilter::uint16Sample:
+            bytesPerFrame *= 2;
+            break;
+        case IIRFilter::int32Sample:
+        case IIRFilter::uint32Sample:
+        case IIRFilter::floatSample:
+            bytesPerFrame *= 4;
+            break;
+        default:
+            break;
+    }
+
+    reset();
+}
+
+
+// continues with the results of the segment that follows this one in the same track
+void SilenceScanner::append(SilenceScanner *next)
+{
+    qint64 frameOffset        = framesCount;
+    qint64 microsecondsOffset = framesToMicroseconds(frameOffset);
+
+    if (next->silences.count() > 0) {
+        // the next segment's beginning silence continues whatever this one ended with
+        if (!silenceStart && (silences.count() > 0) && (next->beginningLoudFrame > 0)) {
+            silenceStart = microsecondsOffset;
+        }
+        if (silenceStart || (silences.count() == 0)) {
+            closeSilence(frameOffset + next->beginningLoudFrame);
+        }
+
+        for (int i = 1; i < next->silences.count(); i++) {
+            ReplayGainCalculator::SilenceRange silence = next->silences.at(i);
+            silence.startMicroseconds += microsecondsOffset;
+            silence.endMicroseconds   += microsecondsOffset;
+            silences.append(silence);
+        }
+
+        silenceStart = next->silenceStart ? next->silenceStart + microsecondsOffset : 0;
+    }
+    else if (!silenceStart && (next->framesCount > 0)) {
+        // the whole next segment is silent
+        silenceStart = frameOffset > 0 ? microsecondsOffset : next->silenceStart;
+    }
+
+    framesCount += next->framesCount;
+    peak         = qMax(peak, next->peak);
+}
+
+
+// the highest and the lowest sample are tracked lane by lane, the larger distance from zero is the result
+template <> int SilenceScanner::chunkMaxAbs<qint16, int>(const qint16 *samples, int sampleCount, int zero)
+{
+    int       vectorCount = sampleCount - sampleCount % 8;
+    ShortOcts highest     = octsBroadcast(std::numeric_limits<qint16>::min());
+    ShortOcts lowest      = octsBroadcast(std::numeric_limits<qint16>::max());
+
+    for (int i = 0; i < vectorCount; i += 8) {
+        ShortOcts octs = octsLoad(samples + i);
+        highest        = octsMax(highest, octs);
+        lowest         = octsMin(lowest, octs);
+    }
+
+    qint16 highestLanes[8];
+    qint16 lowestLanes[8];
+    octsStore(highestLanes, highest);
+    octsStore(lowestLanes, lowest);
+
+    int max = 0;
+    for (int lane = 0; lane < 8; lane++) {
+        max = qMax(max, qMax(highestLanes[lane] - zero, zero - lowestLanes[lane]));
+    }
+    for (int i = vectorCount; i < sampleCount; i++) {
+        max = qMax(max, qAbs(samples[i] - zero));
+    }
+    return max;
+}
+
+
+template <> float SilenceScanner::chunkMaxAbs<float, float>(const float *samples, int sampleCount, float zero)
+{
+    int       vectorCount = sampleCount - sampleCount % 4;
+    FloatQuad zeros       = quadBroadcast(zero);
+    FloatQuad highest     = quadBroadcast(0.0f);
+
+    for (int i = 0; i < vectorCount; i += 4) {
+        highest = quadMax(highest, quadAbs(quadSub(quadLoad(samples + i), zeros)));
+    }
+
+    float highestLanes[4];
+    quadStore(highestLanes, highest);
+
+    float max = qMax(qMax(highestLanes[0], highestLanes[1]), qMax(highestLanes[2], highestLanes[3]));
+    for (int i = vectorCount; i < sampleCount; i++) {
+        max = qMax(max, fabsf(samples[i] - zero));
+    }
+    return max;
+}
+
+
+template <> double SilenceScanner::chunkMaxAbs<double, double>(const double *samples, int sampleCount, double zero)
+{
+    int        vectorCount = sampleCount - sampleCount % 2;
+    DoublePair zeros       = pairBroadcast(zero);
+    DoublePair highest     = pairBroadcast(0.0);
+
+    for (int i = 0; i < vectorCount; i += 2) {
+        highest = pairMax(highest, pairAbs(pairSub(pairLoad(samples + i), zeros)));
+    }
+
+    double highestLanes[2];
+    pairStore(highestLanes, highest);
+
+    double max = qMax(highestLanes[0], highestLanes[1]);
+    for (int i = vectorCount; i < sampleCount; i++) {
+        max = qMax(max, fabs(samples[i] - zero));
+    }
+    return max;
+}
+
+
+// silence ends just before the given frame, silence at the beginning is recorded even if it's empty
+void SilenceScanner::closeSilence(qint64 loudFrame)
+{
+    qint64 silenceEnd = framesToMicroseconds(loudFrame - 1);
+
+    if (silences.count() == 0) {
+        silences.append({ ReplayGainCalculator::SilenceAtBeginning, silenceStart, silenceEnd });
+        beginningLoudFrame = loudFrame;
+    }
+    else if (silenceEnd - silenceStart >= SILENCE_MIN_MICROSEC) {
+        silences.append({ ReplayGainCalculator::SilenceIntermediate, silenceStart, silenceEnd });
+    }
+
+    silenceStart = 0;
+}
+
+
+// index of the first frame with any channel above the threshold, -1 if the whole block is silent
+int SilenceScanner::firstLoudFrame(const void *data, int byteCount)
+{
+    switch (sampleType) {
+        case IIRFilter::Unknown:
+            break;
+        case IIRFilter::int8Sample:
+            return scanFirstLoudFrame<qint8, int>(data, byteCount);
+        case IIRFilter::uint8Sample:
+            return scanFirstLoudFrame<quint8, int>(data, byteCount);
+        case IIRFilter::int16Sample:
+            return scanFirstLoudFrame<qint16, int>(data, byteCount);
+        case IIRFilter::uint16Sample:
+            return scanFirstLoudFrame<quint16, int>(data, byteCount);
+        case IIRFilter::int32Sample:
+            return scanFirstLoudFrame<qint32, qint64>(data, byteCount);
+        case IIRFilter::uint32Sample:
+            return scanFirstLoudFrame<quint32, qint64>(data, byteCount);
+        case IIRFilter::floatSample:
+            return scanFirstLoudFrame<float, float>(data, byteCount);
+    }
+    return 0;
+}
+
+
+qint64 SilenceScanner::framesToMicroseconds(qint64 frames)
+{
+    return static_cast<qint64>(floor(static_cast<double>(frames) / sampleRate * 1000000));
+}
+
+
+qint64 SilenceScanner::getFramesCount()
+{
+    return framesCount;
+}
+
+
+// only the silences found since the previous call, so the whole list doesn't have to be copied every time
+ReplayGainCalculator::Silences SilenceScanner::getNewSilences(bool addFinalSilence)
+{
+    ReplayGainCalculator::Silences newSilences = silences.mid(silencesDelivered);
+    silencesDelivered = silences.count();
+
+    if (addFinalSilence && silenceStart) {
+        newSilences.append({ ReplayGainCalculator::SilenceAtEnd, silenceStart, framesToMicroseconds(framesCount - 1) });
+    }
+
+    return newSilences;
+}
+
+
+// sample peak, linear
+double SilenceScanner::getPeak()
+{
+    return peak / fullScale;
+}
+
+
+ReplayGainCalculator::Silences SilenceScanner::getSilences(bool addFinalSilence)
+{
+    ReplayGainCalculator::Silences aCopy(silences);
+
+    // silence at the end of track (set flag only after decoding has finished)
+    if (addFinalSilence && silenceStart) {
+        aCopy.append({ ReplayGainCalculator::SilenceAtEnd, silenceStart, framesToMicroseconds(framesCount - 1) });
+    }
+
+    return aCopy;
+}
+
+
+// the first two channels of the replay gain filter's output, already scaled to 16 bit
+void SilenceScanner::processFilteredSamples(const double *samples, int sampleCount)
+{
+    int stride = qMin(channelCount, 2);
+
+    processSamples<double, double>(samples, sampleCount / stride, stride, 0.0, filteredThreshold);
+}
+
+
+// always tracks the peak, finds silences too unless they come from the replay gain filter
+void SilenceScanner::processPCMData(const void *data, int byteCount)
+{
+    switch (sampleType) {
+        case IIRFilter::Unknown:
+            break;
+        case IIRFilter::int8Sample:
+            processPCMSamples<qint8, int>(data, byteCount);
+            break;
+        case IIRFilter::uint8Sample:
+            processPCMSamples<quint8, int>(data, byteCount);
+            break;
+        case IIRFilter::int16Sample:
+            processPCMSamples<qint16, int>(data, byteCount);
+            break;
+        case IIRFilter::uint16Sample:
+            processPCMSamples<quint16, int>(data, byteCount);
+            break;
+        case IIRFilter::int32Sample:
+            processPCMSamples<qint32, qint64>(data, byteCount);
+            break;
+        case IIRFilter::uint32Sample:
+            processPCMSamples<quint32, qint64>(data, byteCount);
+            break;
+        case IIRFilter::floatSample:
+            processPCMSamples<float, float>(data, byteCount);
+            break;
+    }
+}
+
+
+// silences are found on the replay gain filter's output instead of the PCM data, just like before there was a scanner
+void SilenceScanner::setFilteredInput(bool filteredInput)
+{
+    this->filteredInput = filteredInput;
+}
+
+
+void SilenceScanner::reset()
+{
+    framesCount        = 0;
+    silenceStart       = 0;
+    beginningLoudFrame = 0;
+    peak               = 0.0;
+
+    silences.clear();
+    silencesDelivered = 0;
+}
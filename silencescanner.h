@@ -0,0 +1,166 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SILENCESCANNER_H
+#define SILENCESCANNER_H
+
+#include <QtGlobal>
+#include <QtMath>
+#include <QVector>
+
+#include <limits>
+
+#include <iirfilter.h>
+
+#include "globals.h"
+#include "replaygaincalculator.h"
+#include "simd.h"
+
+
+// silence detection on whole PCM blocks, used by the decoder to trim leading silence and by the analyzer
+// silences follow the replay gain calculator's rules: every sample of the first two channels counts on its own
+class SilenceScanner {
+
+    public:
+
+        SilenceScanner(IIRFilter::SampleTypes sampleType, int sampleRate, int channelCount);
+
+        int                            firstLoudFrame(const void *data, int byteCount);
+        void                           processPCMData(const void *data, int byteCount);
+        void                           processFilteredSamples(const double *samples, int sampleCount);
+        void                           setFilteredInput(bool filteredInput);
+        double                         getPeak();
+        ReplayGainCalculator::Silences getSilences(bool addFinalSilence);
+        ReplayGainCalculator::Silences getNewSilences(bool addFinalSilence);
+        qint64                         getFramesCount();
+        void                           append(SilenceScanner *next);
+        void                           reset();
+
+
+    private:
+
+        // runs shorter than a chunk can't be long enough to count, only loud chunks are scanned sample by sample
+        static const int CHUNK_FRAMES         = 64;
+        static const int SILENCE_MIN_MICROSEC = 2750000;
+
+        IIRFilter::SampleTypes sampleType;
+        int                    sampleRate;
+        int                    channelCount;
+        int                    bytesPerFrame;
+        double                 fullScale;
+        double                 offset;
+        double                 threshold;
+        double                 filteredThreshold;
+        bool                   filteredInput;
+
+        // silenceStart is zero when not in silence, just like in the original per-sample detector
+        qint64 framesCount;
+        qint64 silenceStart;
+        qint64 beginningLoudFrame;
+        double peak;
+
+        ReplayGainCalculator::Silences silences;
+        int                            silencesDelivered;
+
+        void   closeSilence(qint64 loudFrame);
+        qint64 framesToMicroseconds(qint64 frames);
+
+        // the common sample types are specialized below with vector instructions
+        template <class T, class A> A chunkMaxAbs(const T *samples, int sampleCount, A zero)
+        {
+            A max = 0;
+            for (int i = 0; i < sampleCount; i++) {
+                A value = static_cast<A>(samples[i]) - zero;
+                value   = value < 0 ? -value : value;
+                max     = value > max ? value : max;
+            }
+            return max;
+        }
+
+        template <class T, class A> int firstLoudFrameInChunk(const T *samples, int frameCount, A zero, A limit)
+        {
+            for (int frame = 0; frame < frameCount; frame++) {
+                if (chunkMaxAbs<T, A>(samples + frame * channelCount, channelCount, zero) > limit) {
+                    return frame;
+                }
+            }
+            return -1;
+        }
+
+        template <class T, class A> int scanFirstLoudFrame(const void *data, int byteCount)
+        {
+            const T *samples    = static_cast<const T *>(data);
+            int      frameCount = byteCount / bytesPerFrame;
+            A        zero       = static_cast<A>(offset);
+            A        limit      = static_cast<A>(threshold);
+
+            for (int chunkStart = 0; chunkStart < frameCount; chunkStart += CHUNK_FRAMES) {
+                int chunkFrames = qMin(CHUNK_FRAMES, frameCount - chunkStart);
+                if (chunkMaxAbs<T, A>(samples + chunkStart * channelCount, chunkFrames * channelCount, zero) > limit) {
+                    return chunkStart + firstLoudFrameInChunk<T, A>(samples + chunkStart * channelCount, chunkFrames, zero, limit);
+                }
+            }
+            return -1;
+        }
+
+        template <class T, class A> void trackPeak(const void *data, int byteCount)
+        {
+            const T *samples     = static_cast<const T *>(data);
+            int      sampleCount = (byteCount / bytesPerFrame) * channelCount;
+
+            peak = qMax(peak, static_cast<double>(chunkMaxAbs<T, A>(samples, sampleCount, static_cast<A>(offset))));
+        }
+
+        template <class T, class A> void processSamples(const T *samples, int frameCount, int stride, A zero, A limit)
+        {
+            int channels = qMin(stride, 2);
+
+            for (int chunkStart = 0; chunkStart < frameCount; chunkStart += CHUNK_FRAMES) {
+                const T *chunk       = samples + chunkStart * stride;
+                int      chunkFrames = qMin(CHUNK_FRAMES, frameCount - chunkStart);
+
+                // a quiet chunk can only start a silence, that's the first sample where the start time isn't zero
+                if (chunkMaxAbs<T, A>(chunk, chunkFrames * stride, zero) <= limit) {
+                    for (int frame = 0; (frame < chunkFrames) && !silenceStart; frame++) {
+                        silenceStart = framesToMicroseconds(framesCount + chunkStart + frame);
+                    }
+                    continue;
+                }
+
+                for (int frame = 0; frame < chunkFrames; frame++) {
+                    for (int channel = 0; channel < channels; channel++) {
+                        A value = static_cast<A>(chunk[frame * stride + channel]) - zero;
+                        value   = value < 0 ? -value : value;
+
+                        if (!silenceStart && (value <= limit)) {
+                            silenceStart = framesToMicroseconds(framesCount + chunkStart + frame);
+                        }
+                        if ((silenceStart || (silences.count() == 0)) && (value > limit)) {
+                            closeSilence(framesCount + chunkStart + frame);
+                        }
+                    }
+                }
+            }
+
+            framesCount += frameCount;
+        }
+
+        template <class T, class A> void processPCMSamples(const void *data, int byteCount)
+        {
+            trackPeak<T, A>(data, byteCount);
+
+            if (!filteredInput) {
+                processSamples<T, A>(static_cast<const T *>(data), byteCount / bytesPerFrame, channelCount, static_cast<A>(offset), static_cast<A>(threshold));
+            }
+        }
+};
+
+template <> int    SilenceScanner::chunkMaxAbs<qint16, int>(const qint16 *samples, int sampleCount, int zero);
+template <> float  SilenceScanner::chunkMaxAbs<float, float>(const float *samples, int sampleCount, float zero);
+template <> double SilenceScanner::chunkMaxAbs<double, double>(const double *samples, int sampleCount, double zero);
+
+#endif // SILENCESCANNER_H
@@ -0,0 +1,255 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <QtGlobal>
+#include <QtMath>
+
+
+// a few vector instructions behind plain functions, SSE2 on x86, NEON on AArch64, scalar code elsewhere
+// all three give the same result lane by lane, WAVER_SIMD_VECTOR tells if real vector instructions are behind them
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #define WAVER_SIMD_SSE2
+    #define WAVER_SIMD_VECTOR
+    #include <emmintrin.h>
+#elif defined(__aarch64__)
+    #define WAVER_SIMD_NEON
+    #define WAVER_SIMD_VECTOR
+    #include <arm_neon.h>
+#endif
+
+
+// two doubles, for example the left and right channel side by side
+#if defined(WAVER_SIMD_SSE2)
+
+    typedef __m128d DoublePair;
+
+    static inline DoublePair pairLoad(const double *values)             { return _mm_loadu_pd(values); }
+    static inline void       pairStore(double *values, DoublePair pair) { _mm_storeu_pd(values, pair); }
+    static inline DoublePair pairSet(double first, double second)       { return _mm_set_pd(second, first); }
+    static inline DoublePair pairBroadcast(double value)                { return _mm_set1_pd(value); }
+    static inline DoublePair pairAdd(DoublePair a, DoublePair b)        { return _mm_add_pd(a, b); }
+    static inline DoublePair pairSub(DoublePair a, DoublePair b)        { return _mm_sub_pd(a, b); }
+    static inline DoublePair pairMul(DoublePair a, DoublePair b)        { return _mm_mul_pd(a, b); }
+    static inline DoublePair pairMax(DoublePair a, DoublePair b)        { return _mm_max_pd(a, b); }
+    static inline DoublePair pairAbs(DoublePair a)                      { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+
+#elif defined(WAVER_SIMD_NEON)
+
+    typedef float64x2_t DoublePair;
+
+    static inline DoublePair pairLoad(const double *values)             { return vld1q_f64(values); }
+    static inline void       pairStore(double *values, DoublePair pair) { vst1q_f64(values, pair); }
+    static inline DoublePair pairSet(double first, double second)       { return vsetq_lane_f64(second, vdupq_n_f64(first), 1); }
+    static inline DoublePair pairBroadcast(double value)                { return vdupq_n_f64(value); }
+    static inline DoublePair pairAdd(DoublePair a, DoublePair b)        { return vaddq_f64(a, b); }
+    static inline DoublePair pairSub(DoublePair a, DoublePair b)        { return vsubq_f64(a, b); }
+    static inline DoublePair pairMul(DoublePair a, DoublePair b)        { return vmulq_f64(a, b); }
+    static inline DoublePair pairMax(DoublePair a, DoublePair b)        { return vmaxq_f64(a, b); }
+    static inline DoublePair pairAbs(DoublePair a)                      { return vabsq_f64(a); }
+
+#else
+
+    struct DoublePair {
+        double first;
+        double second;
+    };
+
+    static inline DoublePair pairLoad(const double *values)             { return { values[0], values[1] }; }
+    static inline void       pairStore(double *values, DoublePair pair) { values[0] = pair.first; values[1] = pair.second; }
+    static inline DoublePair pairSet(double first, double second)       { return { first, second }; }
+    static inline DoublePair pairBroadcast(double value)                { return { value, value }; }
+    static inline DoublePair pairAdd(DoublePair a, DoublePair b)        { return { a.first + b.first, a.second + b.second }; }
+    static inline DoublePair pairSub(DoublePair a, DoublePair b)        { return { a.first - b.first, a.second - b.second }; }
+    static inline DoublePair pairMul(DoublePair a, DoublePair b)        { return { a.first * b.first, a.second * b.second }; }
+    static inline DoublePair pairMax(DoublePair a, DoublePair b)        { return { qMax(a.first, b.first), qMax(a.second, b.second) }; }
+    static inline DoublePair pairAbs(DoublePair a)                      { return { fabs(a.first), fabs(a.second) }; }
+
+#endif
+
+
+// four floats
+#if defined(WAVER_SIMD_SSE2)
+
+    typedef __m128 FloatQuad;
+
+    static inline FloatQuad quadLoad(const float *values)            { return _mm_loadu_ps(values); }
+    static inline void      quadStore(float *values, FloatQuad quad) { _mm_storeu_ps(values, quad); }
+    static inline FloatQuad quadBroadcast(float value)               { return _mm_set1_ps(value); }
+    static inline FloatQuad quadAdd(FloatQuad a, FloatQuad b)        { return _mm_add_ps(a, b); }
+    static inline FloatQuad quadSub(FloatQuad a, FloatQuad b)        { return _mm_sub_ps(a, b); }
+    static inline FloatQuad quadMul(FloatQuad a, FloatQuad b)        { return _mm_mul_ps(a, b); }
+    static inline FloatQuad quadMax(FloatQuad a, FloatQuad b)        { return _mm_max_ps(a, b); }
+    static inline FloatQuad quadAbs(FloatQuad a)                     { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static inline FloatQuad quadDuplicateLow(FloatQuad a)            { return _mm_unpacklo_ps(a, a); }
+    static inline FloatQuad quadDuplicateHigh(FloatQuad a)           { return _mm_unpackhi_ps(a, a); }
+
+#elif defined(WAVER_SIMD_NEON)
+
+    typedef float32x4_t FloatQuad;
+
+    static inline FloatQuad quadLoad(const float *values)            { return vld1q_f32(values); }
+    static inline void      quadStore(float *values, FloatQuad quad) { vst1q_f32(values, quad); }
+    static inline FloatQuad quadBroadcast(float value)               { return vdupq_n_f32(value); }
+    static inline FloatQuad quadAdd(FloatQuad a, FloatQuad b)        { return vaddq_f32(a, b); }
+    static inline FloatQuad quadSub(FloatQuad a, FloatQuad b)        { return vsubq_f32(a, b); }
+    static inline FloatQuad quadMul(FloatQuad a, FloatQuad b)        { return vmulq_f32(a, b); }
+    static inline FloatQuad quadMax(FloatQuad a, FloatQuad b)        { return vmaxq_f32(a, b); }
+    static inline FloatQuad quadAbs(FloatQuad a)                     { return vabsq_f32(a); }
+    static inline FloatQuad quadDuplicateLow(FloatQuad a)            { return vzip1q_f32(a, a); }
+    static inline FloatQuad quadDuplicateHigh(FloatQuad a)           { return vzip2q_f32(a, a); }
+
+#else
+
+    struct FloatQuad {
+        float lanes[4];
+    };
+
+    static inline FloatQuad quadLoad(const float *values)            { return { { values[0], values[1], values[2], values[3] } }; }
+    static inline void      quadStore(float *values, FloatQuad quad) { for (int i = 0; i < 4; i++) values[i] = quad.lanes[i]; }
+    static inline FloatQuad quadBroadcast(float value)               { return { { value, value, value, value } }; }
+    static inline FloatQuad quadAdd(FloatQuad a, FloatQuad b)        { for (int i = 0; i < 4; i++) a.lanes[i] += b.lanes[i]; return a; }
+    static inline FloatQuad quadSub(FloatQuad a, FloatQuad b)        { for (int i = 0; i < 4; i++) a.lanes[i] -= b.lanes[i]; return a; }
+    static inline FloatQuad quadMul(FloatQuad a, FloatQuad b)        { for (int i = 0; i < 4; i++) a.lanes[i] *= b.lanes[i]; return a; }
+    static inline FloatQuad quadMax(FloatQuad a, FloatQuad b)        { for (int i = 0; i < 4; i++) a.lanes[i] = qMax(a.lanes[i], b.lanes[i]); return a; }
+    static inline FloatQuad quadAbs(FloatQuad a)                     { for (int i = 0; i < 4; i++) a.lanes[i] = fabsf(a.lanes[i]); return a; }
+    static inline FloatQuad quadDuplicateLow(FloatQuad a)            { return { { a.lanes[0], a.lanes[0], a.lanes[1], a.lanes[1] } }; }
+    static inline FloatQuad quadDuplicateHigh(FloatQuad a)           { return { { a.lanes[2], a.lanes[2], a.lanes[3], a.lanes[3] } }; }
+
+#endif
+
+
+// eight 16 bit integers, for example four stereo frames
+#if defined(WAVER_SIMD_SSE2)
+
+    typedef __m128i ShortOcts;
+
+    static inline ShortOcts octsLoad(const qint16 *values)            { return _mm_loadu_si128(reinterpret_cast<const __m128i *>(values)); }
+    static inline void      octsStore(qint16 *values, ShortOcts octs) { _mm_storeu_si128(reinterpret_cast<__m128i *>(values), octs); }
+    static inline ShortOcts octsBroadcast(qint16 value)               { return _mm_set1_epi16(value); }
+    static inline ShortOcts octsMax(ShortOcts a, ShortOcts b)         { return _mm_max_epi16(a, b); }
+    static inline ShortOcts octsMin(ShortOcts a, ShortOcts b)         { return _mm_min_epi16(a, b); }
+
+#elif defined(WAVER_SIMD_NEON)
+
+    typedef int16x8_t ShortOcts;
+
+    static inline ShortOcts octsLoad(const qint16 *values)            { return vld1q_s16(values); }
+    static inline void      octsStore(qint16 *values, ShortOcts octs) { vst1q_s16(values, octs); }
+    static inline ShortOcts octsBroadcast(qint16 value)               { return vdupq_n_s16(value); }
+    static inline ShortOcts octsMax(ShortOcts a, ShortOcts b)         { return vmaxq_s16(a, b); }
+    static inline ShortOcts octsMin(ShortOcts a, ShortOcts b)         { return vminq_s16(a, b); }
+
+#else
+
+    struct ShortOcts {
+        qint16 lanes[8];
+    };
+
+    static inline ShortOcts octsLoad(const qint16 *values)            { ShortOcts octs; for (int i = 0; i < 8; i++) octs.lanes[i] = values[i]; return octs; }
+    static inline void      octsStore(qint16 *values, ShortOcts octs) { for (int i = 0; i < 8; i++) values[i] = octs.lanes[i]; }
+    static inline ShortOcts octsBroadcast(qint16 value)               { ShortOcts octs; for (int i = 0; i < 8; i++) octs.lanes[i] = value; return octs; }
+    static inline ShortOcts octsMax(ShortOcts a, ShortOcts b)         { for (int i = 0; i < 8; i++) a.lanes[i] = qMax(a.lanes[i], b.lanes[i]); return a; }
+    static inline ShortOcts octsMin(ShortOcts a, ShortOcts b)         { for (int i = 0; i < 8; i++) a.lanes[i] = qMin(a.lanes[i], b.lanes[i]); return a; }
+
+#endif
+
+
+// 16 bit integers to floats and back, back is truncated toward zero and saturated like a cast of an in-range value
+#if defined(WAVER_SIMD_SSE2)
+
+    static inline FloatQuad octsLowToQuad(ShortOcts octs)  { return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(octs, octs), 16)); }
+    static inline FloatQuad octsHighToQuad(ShortOcts octs) { return _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(octs, octs), 16)); }
+
+    static inline ShortOcts quadsToOcts(FloatQuad low, FloatQuad high) { return _mm_packs_epi32(_mm_cvttps_epi32(low), _mm_cvttps_epi32(high)); }
+
+#elif defined(WAVER_SIMD_NEON)
+
+    static inline FloatQuad octsLowToQuad(ShortOcts octs)  { return vcvtq_f32_s32(vmovl_s16(vget_low_s16(octs))); }
+    static inline FloatQuad octsHighToQuad(ShortOcts octs) { return vcvtq_f32_s32(vmovl_s16(vget_high_s16(octs))); }
+
+    static inline ShortOcts quadsToOcts(FloatQuad low, FloatQuad high) { return vcombine_s16(vqmovn_s32(vcvtq_s32_f32(low)), vqmovn_s32(vcvtq_s32_f32(high))); }
+
+#else
+
+    static inline FloatQuad octsLowToQuad(ShortOcts octs)  { return { { static_cast<float>(octs.lanes[0]), static_cast<float>(octs.lanes[1]), static_cast<float>(octs.lanes[2]), static_cast<float>(octs.lanes[3]) } }; }
+    static inline FloatQuad octsHighToQuad(ShortOcts octs) { return { { static_cast<float>(octs.lanes[4]), static_cast<float>(octs.lanes[5]), static_cast<float>(octs.lanes[6]), static_cast<float>(octs.lanes[7]) } }; }
+
+    static inline ShortOcts quadsToOcts(FloatQuad low, FloatQuad high)
+    {
+        ShortOcts octs;
+        for (int i = 0; i < 4; i++) {
+            octs.lanes[i]     = static_cast<qint16>(qBound(-32768.0f, low.lanes[i], 32767.0f));
+            octs.lanes[i + 4] = static_cast<qint16>(qBound(-32768.0f, high.lanes[i], 32767.0f));
+        }
+        return octs;
+    }
+
+#endif
+
+
+// two 64 bit integers, sums of squares of 16 bit samples go here, even lanes to the first and odd lanes to the second
+#if defined(WAVER_SIMD_SSE2)
+
+    typedef __m128i LongPair;
+
+    static inline LongPair longPairZero()                               { return _mm_setzero_si128(); }
+    static inline void     longPairStore(qint64 *values, LongPair pair) { _mm_storeu_si128(reinterpret_cast<__m128i *>(values), pair); }
+
+    // squares are at most 2^30, two of them still fit in an unsigned 32 bit lane before widening
+    static inline LongPair longPairAddSquares(LongPair sums, ShortOcts octs)
+    {
+        __m128i low  = _mm_mullo_epi16(octs, octs);
+        __m128i high = _mm_mulhi_epi16(octs, octs);
+        __m128i both = _mm_add_epi32(_mm_unpacklo_epi16(low, high), _mm_unpackhi_epi16(low, high));
+        __m128i zero = _mm_setzero_si128();
+
+        sums = _mm_add_epi64(sums, _mm_unpacklo_epi32(both, zero));
+        return _mm_add_epi64(sums, _mm_unpackhi_epi32(both, zero));
+    }
+
+#elif defined(WAVER_SIMD_NEON)
+
+    typedef int64x2_t LongPair;
+
+    static inline LongPair longPairZero()                               { return vdupq_n_s64(0); }
+    static inline void     longPairStore(qint64 *values, LongPair pair) { vst1q_s64(reinterpret_cast<int64_t *>(values), pair); }
+
+    // squares are at most 2^30, two of them still fit in an unsigned 32 bit lane before widening
+    static inline LongPair longPairAddSquares(LongPair sums, ShortOcts octs)
+    {
+        int32x4_t  first  = vmull_s16(vget_low_s16(octs), vget_low_s16(octs));
+        int32x4_t  second = vmull_s16(vget_high_s16(octs), vget_high_s16(octs));
+        uint32x4_t both   = vaddq_u32(vreinterpretq_u32_s32(first), vreinterpretq_u32_s32(second));
+
+        return vaddq_s64(sums, vreinterpretq_s64_u64(vaddl_u32(vget_low_u32(both), vget_high_u32(both))));
+    }
+
+#else
+
+    struct LongPair {
+        qint64 first;
+        qint64 second;
+    };
+
+    static inline LongPair longPairZero()                               { return { 0, 0 }; }
+    static inline void     longPairStore(qint64 *values, LongPair pair) { values[0] = pair.first; values[1] = pair.second; }
+
+    static inline LongPair longPairAddSquares(LongPair sums, ShortOcts octs)
+    {
+        for (int i = 0; i < 8; i += 2) {
+            sums.first  += octs.lanes[i] * octs.lanes[i];
+            sums.second += octs.lanes[i + 1] * octs.lanes[i + 1];
+        }
+        return sums;
+    }
+
+#endif
+
+#endif // SIMD_H
@@ -7,9 +7,10 @@
 #include "soundoutput.h"
 
 
-SoundOutput::SoundOutput(QAudioFormat format, PeakCallback::PeakCallbackInfo peakCallbackInfo, QObject *parent) : QObject(parent)
+SoundOutput::SoundOutput(QAudioFormat format, void *meterSource, QObject *parent) : QObject(parent)
 {
-    this->format = format;
+    this->format      = format;
+    this->meterSource = meterSource;
 
     wasError              = false;
     wasUnderrun           = false;
@@ -27,8 +28,6 @@ SoundOutput::SoundOutput(QAudioFormat format, PeakCallback::PeakCallbackInfo pea
 
     chunkQueue      = nullptr;
     chunkQueueMutex = nullptr;
-
-    this->peakCallbackInfo = peakCallbackInfo;
 }
 
 
@@ -256,7 +255,7 @@ void SoundOutput::run()
     audioOutput->setNotifyInterval(NOTIFICATION_INTERVAL_MILLISECONDS);
 
     QSettings settings;
-    int wideStereoDelayMillisec = settings.value("options/wide_stereo_delay_millisec", DEFAULT_WIDE_STEREO_DELAY_MILLISEC).toInt();
+    double wideStereoDelayMillisec = settings.value("options/wide_stereo_delay_millisec", DEFAULT_WIDE_STEREO_DELAY_MILLISEC).toDouble();
 
     bytesToPlay      = new QByteArray();
     bytesToPlayMutex = new QMutex();
@@ -265,7 +264,7 @@ void SoundOutput::run()
     connect(audioOutput, SIGNAL(notify()),                    this, SLOT(audioOutputNotification()));
     connect(audioOutput, SIGNAL(stateChanged(QAudio::State)), this, SLOT(audioOutputStateChanged(QAudio::State)));
 
-    feeder = new OutputFeeder(bytesToPlay, bytesToPlayMutex, format, audioOutput, peakCallbackInfo);
+    feeder = new OutputFeeder(bytesToPlay, bytesToPlayMutex, format, audioOutput, meterSource);
     feeder->moveToThread(&feederThread);
     feeder->setWideStereoDelayMillisec(wideStereoDelayMillisec);
 
@@ -288,7 +287,7 @@ void SoundOutput::timerTimeout()
 }
 
 
-void SoundOutput::wideStereoDelayChanged(int wideStereoDelayMillisec)
+void SoundOutput::wideStereoDelayChanged(double wideStereoDelayMillisec)
 {
     if (feeder == nullptr) {
         return;
@@ -33,11 +33,11 @@ class SoundOutput : public QObject
     Q_OBJECT
 
     public:
-        explicit SoundOutput(QAudioFormat format, PeakCallback::PeakCallbackInfo peakCallbackInfo, QObject *parent = nullptr);
+        explicit SoundOutput(QAudioFormat format, void *meterSource, QObject *parent = nullptr);
         ~SoundOutput();
 
         void setBufferQueue(TimedChunkQueue *chunkQueue, QMutex *chunkQueueMutex);
-        void wideStereoDelayChanged(int wideStereoDelayMillisec);
+        void wideStereoDelayChanged(double wideStereoDelayMillisec);
 
         qint64 remainingMilliseconds();
 
@@ -47,8 +47,8 @@ class SoundOutput : public QObject
         static const int    INITIAL_CACHE_BUFFER_COUNT         = 5;
         static const qint64 NOTIFICATION_INTERVAL_MILLISECONDS = 500;
 
-        QAudioFormat                    format;
-        PeakCallback::PeakCallbackInfo  peakCallbackInfo;
+        QAudioFormat  format;
+        void         *meterSource;
 
         TimedChunkQueue *chunkQueue;
         QMutex          *chunkQueueMutex;
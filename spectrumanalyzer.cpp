@@ -0,0 +1,219 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "spectrumanalyzer.h"
+
+
+SpectrumAnalyzer::SpectrumAnalyzer(QObject *parent) : QObject(parent)
+{
+    timer     = nullptr;
+    bandCount = DEFAULT_SPECTRUM_BANDS;
+
+    // Hann window
+    windowGain = 0;
+    for (int i = 0; i < FFT_SIZE; i++) {
+        window[i]   = static_cast<float>(0.5 - 0.5 * cos(2.0 * M_PI * i / FFT_SIZE));
+        windowGain += window[i];
+    }
+
+    // each stage's twiddles are side by side so they can be loaded four at a time, the stage with half size h uses h..2h-1
+    for (int half = 1; half < COMPLEX_SIZE; half *= 2) {
+        for (int k = 0; k < half; k++) {
+            twiddleReal[half + k]      = static_cast<float>(cos(-M_PI * k / half));
+            twiddleImaginary[half + k] = static_cast<float>(sin(-M_PI * k / half));
+        }
+    }
+    twiddleReal[0]      = 1;
+    twiddleImaginary[0] = 0;
+
+    // these turn the half size complex result into the spectrum of the real input
+    for (int k = 0; k < COMPLEX_SIZE; k++) {
+        splitReal[k]      = static_cast<float>(cos(-2.0 * M_PI * k / FFT_SIZE));
+        splitImaginary[k] = static_cast<float>(sin(-2.0 * M_PI * k / FFT_SIZE));
+    }
+
+    int bits = 0;
+    while ((1 << bits) < COMPLEX_SIZE) {
+        bits++;
+    }
+    for (int i = 0; i < COMPLEX_SIZE; i++) {
+        int reversed = 0;
+        for (int bit = 0; bit < bits; bit++) {
+            reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+        }
+        bitReversed[i] = reversed;
+    }
+}
+
+
+// latest values, 0 is the bottom of the scale and 1 is full scale
+QVariantList SpectrumAnalyzer::bands()
+{
+    QVariantList returnValue;
+
+    bandValuesMutex.lock();
+    foreach (double bandValue, bandValues) {
+        returnValue.append(bandValue);
+    }
+    bandValuesMutex.unlock();
+
+    return returnValue;
+}
+
+
+// complex radix-2 decimation in time, input is expected in bit reversed order
+void SpectrumAnalyzer::fft()
+{
+    for (int half = 1; half < COMPLEX_SIZE; half *= 2) {
+        const float *wr = twiddleReal + half;
+        const float *wi = twiddleImaginary + half;
+
+        // the first two stages have fewer than four butterflies per group
+        int vectorHalf = half - half % 4;
+
+        for (int start = 0; start < COMPLEX_SIZE; start += half * 2) {
+            float *evenReal      = real + start;
+            float *evenImaginary = imaginary + start;
+            float *oddReal       = evenReal + half;
+            float *oddImaginary  = evenImaginary + half;
+
+            for (int k = 0; k < vectorHalf; k += 4) {
+                FloatQuad wRe = quadLoad(wr + k);
+                FloatQuad wIm = quadLoad(wi + k);
+                FloatQuad oRe = quadLoad(oddReal + k);
+                FloatQuad oIm = quadLoad(oddImaginary + k);
+                FloatQuad eRe = quadLoad(evenReal + k);
+                FloatQuad eIm = quadLoad(evenImaginary + k);
+                FloatQuad tRe = quadSub(quadMul(wRe, oRe), quadMul(wIm, oIm));
+                FloatQuad tIm = quadAdd(quadMul(wRe, oIm), quadMul(wIm, oRe));
+
+                quadStore(oddReal + k, quadSub(eRe, tRe));
+                quadStore(oddImaginary + k, quadSub(eIm, tIm));
+                quadStore(evenReal + k, quadAdd(eRe, tRe));
+                quadStore(evenImaginary + k, quadAdd(eIm, tIm));
+            }
+
+            for (int k = vectorHalf; k < half; k++) {
+                float tr = wr[k] * oddReal[k] - wi[k] * oddImaginary[k];
+                float ti = wr[k] * oddImaginary[k] + wi[k] * oddReal[k];
+
+                oddReal[k]        = evenReal[k] - tr;
+                oddImaginary[k]   = evenImaginary[k] - ti;
+                evenReal[k]      += tr;
+                evenImaginary[k] += ti;
+            }
+        }
+    }
+}
+
+
+void SpectrumAnalyzer::run()
+{
+    timer = new QTimer(this);
+    timer->setInterval(1000 / DISPLAY_FPS);
+
+    connect(timer, &QTimer::timeout, this, &SpectrumAnalyzer::timerTimeout);
+}
+
+
+// the tap is enabled only while the view is visible, the output skips it entirely otherwise
+void SpectrumAnalyzer::setVisible(bool visible)
+{
+    SpectrumTap::instance()->setEnabled(visible);
+    QMetaObject::invokeMethod(this, visible ? "startComputing" : "stopComputing", Qt::QueuedConnection);
+}
+
+
+void SpectrumAnalyzer::startComputing()
+{
+    QSettings settings;
+    bandCount = qBound(4, settings.value("options/spectrum_bands", DEFAULT_SPECTRUM_BANDS).toInt(), 128);
+
+    bandValuesMutex.lock();
+    bandValues.fill(0, bandCount);
+    bandValuesMutex.unlock();
+
+    if (timer != nullptr) {
+        timer->start();
+    }
+}
+
+
+void SpectrumAnalyzer::stopComputing()
+{
+    if (timer != nullptr) {
+        timer->stop();
+    }
+
+    bandValuesMutex.lock();
+    bandValues.clear();
+    bandValuesMutex.unlock();
+}
+
+
+void SpectrumAnalyzer::timerTimeout()
+{
+    int sampleRate = 44100;
+    if (!SpectrumTap::instance()->read(samples, FFT_SIZE, &sampleRate)) {
+        // nothing is playing
+        memset(samples, 0, sizeof(samples));
+    }
+
+    for (int i = 0; i < COMPLEX_SIZE; i++) {
+        real[bitReversed[i]]      = samples[i * 2] * window[i * 2];
+        imaginary[bitReversed[i]] = samples[i * 2 + 1] * window[i * 2 + 1];
+    }
+
+    fft();
+
+    // split into the spectra of the even and the odd samples, then combine them like one more butterfly would
+    // full scale sine is 0dB
+    float normalization = 1.0f / (windowGain * windowGain);
+    for (int k = 0; k < COMPLEX_SIZE; k++) {
+        int mirror = (COMPLEX_SIZE - k) & (COMPLEX_SIZE - 1);
+
+        float evenReal      = real[k] + real[mirror];
+        float evenImaginary = imaginary[k] - imaginary[mirror];
+        float oddReal       = imaginary[k] + imaginary[mirror];
+        float oddImaginary  = real[mirror] - real[k];
+
+        float spectrumReal      = evenReal + splitReal[k] * oddReal - splitImaginary[k] * oddImaginary;
+        float spectrumImaginary = evenImaginary + splitReal[k] * oddImaginary + splitImaginary[k] * oddReal;
+
+        power[k] = (spectrumReal * spectrumReal + spectrumImaginary * spectrumImaginary) * normalization;
+    }
+
+    // bands are evenly spaced on a logarithmic frequency scale, each shows the strongest bin in it
+    double highestFrequency = qMin(HIGHEST_FREQUENCY, sampleRate / 2.0);
+    double binsPerHertz     = static_cast<double>(FFT_SIZE) / sampleRate;
+
+    QVector<double> newValues(bandCount);
+    for (int band = 0; band < bandCount; band++) {
+        int firstBin = static_cast<int>(LOWEST_FREQUENCY * pow(highestFrequency / LOWEST_FREQUENCY, static_cast<double>(band) / bandCount) * binsPerHertz);
+        int lastBin  = static_cast<int>(LOWEST_FREQUENCY * pow(highestFrequency / LOWEST_FREQUENCY, static_cast<double>(band + 1) / bandCount) * binsPerHertz);
+
+        firstBin = qBound(1, firstBin, FFT_SIZE / 2 - 1);
+        lastBin  = qBound(firstBin, lastBin, FFT_SIZE / 2 - 1);
+
+        float strongest = 0;
+        for (int k = firstBin; k <= lastBin; k++) {
+            strongest = power[k] > strongest ? power[k] : strongest;
+        }
+
+        double decibel = 10.0 * log10(strongest + 1e-12);
+        newValues[band] = qBound(0.0, (decibel + DECIBEL_RANGE) / DECIBEL_RANGE, 1.0);
+    }
+
+    bandValuesMutex.lock();
+    if (bandValues.count() == bandCount) {
+        // bars rise immediately but fall gradually
+        for (int band = 0; band < bandCount; band++) {
+            bandValues[band] = qMax(newValues.at(band), bandValues.at(band) - FALL_PER_FRAME);
+        }
+    }
+    bandValuesMutex.unlock();
+}
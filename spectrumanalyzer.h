@@ -0,0 +1,88 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SPECTRUMANALYZER_H
+#define SPECTRUMANALYZER_H
+
+#include <QMetaObject>
+#include <QMutex>
+#include <QObject>
+#include <QSettings>
+#include <QtGlobal>
+#include <QtMath>
+#include <QTimer>
+#include <QVariantList>
+#include <QVector>
+
+#include "globals.h"
+#include "simd.h"
+#include "spectrumtap.h"
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// spectrum of what's being heard, computed on its own thread only while a spectrum view is visible
+class SpectrumAnalyzer : public QObject
+{
+    Q_OBJECT
+
+    public:
+
+        explicit SpectrumAnalyzer(QObject *parent = nullptr);
+
+        // these two are called from the UI thread
+        Q_INVOKABLE QVariantList bands();
+        Q_INVOKABLE void         setVisible(bool visible);
+
+
+    private:
+
+        static const     int    FFT_SIZE          = 2048;
+        static const     int    COMPLEX_SIZE      = FFT_SIZE / 2;
+        static const     int    DISPLAY_FPS       = 30;
+        static constexpr double LOWEST_FREQUENCY  = 30.0;
+        static constexpr double HIGHEST_FREQUENCY = 16000.0;
+        static constexpr double DECIBEL_RANGE     = 70.0;
+        static constexpr double FALL_PER_FRAME    = 0.04;
+
+        QTimer *timer;
+
+        // the real input is packed into a complex transform of half the size, even samples are the real part and odd samples are the imaginary part
+        float samples[FFT_SIZE];
+        float window[FFT_SIZE];
+        float real[COMPLEX_SIZE];
+        float imaginary[COMPLEX_SIZE];
+        float twiddleReal[COMPLEX_SIZE];
+        float twiddleImaginary[COMPLEX_SIZE];
+        float splitReal[COMPLEX_SIZE];
+        float splitImaginary[COMPLEX_SIZE];
+        float power[FFT_SIZE / 2];
+        int   bitReversed[COMPLEX_SIZE];
+        float windowGain;
+
+        int             bandCount;
+        QVector<double> bandValues;
+        QMutex          bandValuesMutex;
+
+        void fft();
+
+
+    public slots:
+
+        void run();
+
+
+    private slots:
+
+        void startComputing();
+        void stopComputing();
+        void timerTimeout();
+};
+
+#endif // SPECTRUMANALYZER_H
@@ -0,0 +1,123 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "spectrumtap.h"
+
+
+SpectrumTap::SpectrumTap()
+{
+    memset(ring, 0, sizeof(ring));
+
+    enabled       = 0;
+    writing       = 0;
+    source        = nullptr;
+    writtenFrames = 0;
+    latencyFrames = 0;
+    sampleRate    = 44100;
+}
+
+
+SpectrumTap *SpectrumTap::instance()
+{
+    // function-local static is thread safe since C++11
+    static SpectrumTap tap;
+    return &tap;
+}
+
+
+bool SpectrumTap::isEnabled()
+{
+    return enabled.loadAcquire() != 0;
+}
+
+
+// the frames that are being heard right now, false if they were already overwritten or not written yet
+bool SpectrumTap::read(float *samples, int frameCount, int *sampleRate)
+{
+    qint64 written = writtenFrames.loadAcquire();
+    qint64 end     = written - latencyFrames.loadAcquire();
+    qint64 start   = end - frameCount;
+
+    if ((start < 0) || (frameCount > RING_FRAMES)) {
+        return false;
+    }
+
+    for (int i = 0; i < frameCount; i++) {
+        samples[i] = ring[(start + i) & RING_MASK];
+    }
+
+    *sampleRate = this->sampleRate.loadAcquire();
+
+    // the writer might have lapped the copy meanwhile
+    return writtenFrames.loadAcquire() - RING_FRAMES <= start;
+}
+
+
+void SpectrumTap::setEnabled(bool enabled)
+{
+    this->enabled.storeRelease(enabled ? 1 : 0);
+}
+
+
+// only one track's output is tapped, during crossfade that's the one the peak meter shows
+void SpectrumTap::setSource(void *source)
+{
+    this->source.storeRelease(source);
+}
+
+
+void SpectrumTap::write(void *source, const void *data, int byteCount, QAudioFormat format, qint64 latencyMicroseconds)
+{
+    if (!isEnabled() || (source != this->source.loadAcquire())) {
+        return;
+    }
+
+    // another output is writing, dropping is better than waiting
+    if (!writing.testAndSetAcquire(0, 1)) {
+        return;
+    }
+
+    int    channelCount = qMax(format.channelCount(), 1);
+    int    frameCount   = format.framesForBytes(byteCount);
+    qint64 position     = writtenFrames.loadAcquire();
+
+    if (format.sampleType() == QAudioFormat::SignedInt) {
+        switch (format.sampleSize()) {
+            case 8:
+                convert<qint8>(static_cast<const qint8 *>(data), frameCount, channelCount, position, 0, 1.0 / 128);
+                break;
+            case 16:
+                convert<qint16>(static_cast<const qint16 *>(data), frameCount, channelCount, position, 0, 1.0 / 32768);
+                break;
+            case 32:
+                convert<qint32>(static_cast<const qint32 *>(data), frameCount, channelCount, position, 0, 1.0 / 2147483648.0);
+                break;
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::UnSignedInt) {
+        switch (format.sampleSize()) {
+            case 8:
+                convert<quint8>(static_cast<const quint8 *>(data), frameCount, channelCount, position, 128, 1.0 / 128);
+                break;
+            case 16:
+                convert<quint16>(static_cast<const quint16 *>(data), frameCount, channelCount, position, 32768, 1.0 / 32768);
+                break;
+            case 32:
+                convert<quint32>(static_cast<const quint32 *>(data), frameCount, channelCount, position, 2147483648.0, 1.0 / 2147483648.0);
+                break;
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::Float) {
+        convert<float>(static_cast<const float *>(data), frameCount, channelCount, position, 0, 1.0);
+    }
+
+    sampleRate.storeRelease(format.sampleRate());
+    latencyFrames.storeRelease(format.framesForDuration(qMax(latencyMicroseconds, static_cast<qint64>(0))));
+    writtenFrames.storeRelease(position + frameCount);
+
+    writing.storeRelease(0);
+}
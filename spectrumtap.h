@@ -0,0 +1,67 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef SPECTRUMTAP_H
+#define SPECTRUMTAP_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QAtomicPointer>
+#include <QAudioFormat>
+#include <QtGlobal>
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// lock-free copy of what the output writes, the output never waits for it and does nothing while it's disabled
+class SpectrumTap
+{
+    public:
+
+        static const int RING_FRAMES = 65536;
+
+        static SpectrumTap *instance();
+
+        void setEnabled(bool enabled);
+        bool isEnabled();
+        void setSource(void *source);
+
+        void write(void *source, const void *data, int byteCount, QAudioFormat format, qint64 latencyMicroseconds);
+        bool read(float *samples, int frameCount, int *sampleRate);
+
+
+    private:
+
+        static const int RING_MASK = RING_FRAMES - 1;
+
+        // mono, the average of the first two channels, scaled to -1..1
+        float ring[RING_FRAMES];
+
+        QAtomicInt             enabled;
+        QAtomicInt             writing;
+        QAtomicPointer<void>   source;
+        QAtomicInteger<qint64> writtenFrames;
+        QAtomicInteger<qint64> latencyFrames;
+        QAtomicInt             sampleRate;
+
+        SpectrumTap();
+
+        template <class T> void convert(const T *samples, int frameCount, int channelCount, qint64 ringPosition, double offset, double scale)
+        {
+            int rightOffset = channelCount > 1 ? 1 : 0;
+            for (int frame = 0; frame < frameCount; frame++) {
+                double left  = static_cast<double>(samples[frame * channelCount]) - offset;
+                double right = static_cast<double>(samples[frame * channelCount + rightOffset]) - offset;
+
+                ring[(ringPosition + frame) & RING_MASK] = static_cast<float>((left + right) * scale / 2);
+            }
+        }
+};
+
+#endif // SPECTRUMTAP_H
@@ -0,0 +1,127 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include <QAudioFormat>
+#include <QtMath>
+#include <QtTest>
+#include <QVector>
+
+#include "widestereodelay.h"
+
+
+class TestWideStereoDelay : public QObject
+{
+    Q_OBJECT
+
+    private:
+
+        static const     int    SAMPLE_RATE  = 44100;
+        static const     int    BLOCK_FRAMES = 256;
+        static const     int    MAX_STEP     = 500;
+        static constexpr double FREQUENCY    = 100.0;
+        static constexpr double AMPLITUDE    = 10000.0;
+
+        QAudioFormat    format();
+        qint16          input(int frame);
+        QVector<qint16> processBlocks(WideStereoDelay *wideStereoDelay, int *frame, int blockCount);
+
+
+    private slots:
+
+        void delayIsApplied();
+        void delaySetTwiceDoesNotJump();
+};
+
+
+QAudioFormat TestWideStereoDelay::format()
+{
+    QAudioFormat format;
+    format.setSampleRate(SAMPLE_RATE);
+    format.setChannelCount(2);
+    format.setSampleSize(16);
+    format.setSampleType(QAudioFormat::SignedInt);
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setCodec("audio/pcm");
+    return format;
+}
+
+
+// a low tone, so the right channel only steps a little from one frame to the next unless the delay jumps
+qint16 TestWideStereoDelay::input(int frame)
+{
+    return static_cast<qint16>(qRound(AMPLITUDE * qSin(2 * M_PI * FREQUENCY * frame / SAMPLE_RATE)));
+}
+
+
+// returns the right channel of what came out
+QVector<qint16> TestWideStereoDelay::processBlocks(WideStereoDelay *wideStereoDelay, int *frame, int blockCount)
+{
+    QVector<qint16> right;
+
+    for (int block = 0; block < blockCount; block++) {
+        QVector<qint16> samples(BLOCK_FRAMES * 2);
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            samples[i * 2]     = input(*frame + i);
+            samples[i * 2 + 1] = input(*frame + i);
+        }
+
+        wideStereoDelay->process(reinterpret_cast<char *>(samples.data()), BLOCK_FRAMES);
+
+        for (int i = 0; i < BLOCK_FRAMES; i++) {
+            right.append(samples.at(i * 2 + 1));
+        }
+        *frame += BLOCK_FRAMES;
+    }
+
+    return right;
+}
+
+
+void TestWideStereoDelay::delayIsApplied()
+{
+    WideStereoDelay wideStereoDelay(format(), 20.0);
+    int             frame = 0;
+
+    wideStereoDelay.setDelayMillisec(10.0);
+    processBlocks(&wideStereoDelay, &frame, 20);
+
+    int             start = frame;
+    QVector<qint16> right = processBlocks(&wideStereoDelay, &frame, 4);
+    for (int i = 0; i < right.count(); i++) {
+        QCOMPARE(right.at(i), input(start + i - SAMPLE_RATE / 100));
+    }
+}
+
+
+// the second change comes while the first crossfade is still running
+void TestWideStereoDelay::delaySetTwiceDoesNotJump()
+{
+    WideStereoDelay wideStereoDelay(format(), 20.0);
+    int             frame = 0;
+
+    QVector<qint16> right = processBlocks(&wideStereoDelay, &frame, 4);
+
+    wideStereoDelay.setDelayMillisec(5.0);
+    right.append(processBlocks(&wideStereoDelay, &frame, 1));
+    wideStereoDelay.setDelayMillisec(10.0);
+    right.append(processBlocks(&wideStereoDelay, &frame, 20));
+
+    for (int i = 1; i < right.count(); i++) {
+        QVERIFY2(qAbs(right.at(i) - right.at(i - 1)) <= MAX_STEP, qPrintable(QString("step of %1 at frame %2").arg(qAbs(right.at(i) - right.at(i - 1))).arg(i)));
+    }
+
+    int start = frame;
+    right     = processBlocks(&wideStereoDelay, &frame, 4);
+    for (int i = 0; i < right.count(); i++) {
+        QCOMPARE(right.at(i), input(start + i - SAMPLE_RATE / 100));
+    }
+}
+
+
+QTEST_APPLESS_MAIN(TestWideStereoDelay)
+
+#include "tst_widestereodelay.moc"
@@ -0,0 +1,23 @@
+#
+#    This file is part of Waver
+#    Copyright (C) 2021 Peter Papp
+#    Please visit https://launchpad.net/waver for details
+#
+
+
+QT += multimedia testlib
+QT -= gui
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_widestereodelay
+
+INCLUDEPATH += ../..
+
+HEADERS += \
+    ../../widestereodelay.h
+
+SOURCES += \
+    ../../widestereodelay.cpp \
+    tst_widestereodelay.cpp
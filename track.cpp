@@ -7,7 +7,7 @@
 #include "track.h"
 
 
-Track::Track(TrackInfo trackInfo, PeakCallback::PeakCallbackInfo peakCallbackInfo, DecodingCallback::DecodingCallbackInfo decodingCallbackInfo, QObject *parent) : QObject(parent)
+Track::Track(TrackInfo trackInfo, DecodingCallback::DecodingCallbackInfo decodingCallbackInfo, QObject *parent) : QObject(parent)
 {
     decoderThread.setObjectName("decoder");
     cacheThread.setObjectName("cache");
@@ -16,10 +16,8 @@ Track::Track(TrackInfo trackInfo, PeakCallback::PeakCallbackInfo peakCallbackInf
 
     this->trackInfo = trackInfo;
 
-    peakCallbackInfo.trackPointer     = static_cast<void *>(this);
     decodingCallbackInfo.trackPointer = static_cast<void *>(this);
 
-    this->peakCallbackInfo     = peakCallbackInfo;
     this->decodingCallbackInfo = decodingCallbackInfo;
 
     currentStatus            = Idle;
@@ -30,13 +28,25 @@ Track::Track(TrackInfo trackInfo, PeakCallback::PeakCallbackInfo peakCallbackInf
     posMilliseconds          = 0;
     decodingInfoLastSent     = 0;
     networkStartingLastState = false;
+    decoderFailed            = false;
+    diskCacheMicroseconds    = 0;
+    rangeSeeked              = false;
+    rangeStartMicroseconds   = 0;
+    streamUrl                = trackInfo.url;
+    reducedBitrate           = false;
+    compressedBytes          = 0;
+    analysisCached           = false;
+    segmentedAnalyzer        = nullptr;
 
     QSettings settings;
 
-    fadeDirection       = FadeDirectionNone;
     shortFadeBeginning  = false;
     shortFadeEnd        = false;
 
+    // read once here, fades are applied to every chunk
+    fadeSeconds = settings.value("options/fade_seconds", DEFAULT_FADE_SECONDS).toInt();
+    fadeCurve   = settings.value("options/fade_curve", DEFAULT_FADE_CURVE).toInt();
+
     updateFadeoutStartMilliseconds();
 
     fadeTags.append(settings.value("options/fade_tags", DEFAULT_FADE_TAGS).toString().split(","));
@@ -50,11 +60,18 @@ Track::Track(TrackInfo trackInfo, PeakCallback::PeakCallbackInfo peakCallbackInf
     desiredPCMFormat.setSampleSize(16);
     desiredPCMFormat.setSampleType(QAudioFormat::SignedInt);
 
-    setupDecoder();
+    fader = new Fader(desiredPCMFormat);
+    fader->setCurve(static_cast<Fader::Curve>(fadeCurve));
+
+    setupDecoder(0);
     setupCache();
     setupAnalyzer();
     setupEqualizer();
     setupOutput();
+
+    if (!loadCachedAnalysis() && trackInfo.attributes.contains("replayGain")) {
+        emit updateReplayGain(trackInfo.attributes.value("replayGain").toDouble());
+    }
 }
 
 
@@ -97,12 +114,15 @@ Track::~Track()
         delete equalizer;
     }
 
+    stopSegmentedAnalysis();
+
     analyzerThread.requestInterruption();
     analyzerThread.quit();
     analyzerThread.wait();
     if (analyzer != nullptr) {
-        disconnect(analyzer, &Analyzer::replayGain, this, &Track::analyzerReplayGain);
-        disconnect(analyzer, &Analyzer::silences,   this, &Track::analyzerSilences);
+        disconnect(analyzer, &Analyzer::replayGain,       this, &Track::analyzerReplayGain);
+        disconnect(analyzer, &Analyzer::silences,         this, &Track::analyzerSilences);
+        disconnect(analyzer, &Analyzer::analysisFinished, this, &Track::analyzerFinished);
 
         disconnect(this, &Track::bufferAvailableToAnalyzer, analyzer, &Analyzer::bufferAvailable);
         disconnect(this, &Track::decoderDone,               analyzer, &Analyzer::decoderDone);
@@ -111,15 +131,23 @@ Track::~Track()
         delete analyzer;
     }
 
+    // the analyzer might not have started at all
+    qDeleteAll(analyzerQueue);
+    analyzerQueue.clear();
+
     cacheThread.requestInterruption();
     cacheThread.quit();
     cacheThread.wait();
     if (cache != nullptr) {
-        disconnect(cache, &PCMCache::pcmChunk, this, &Track::pcmChunkFromCache);
-        disconnect(cache, &PCMCache::error,    this, &Track::cacheError);
+        disconnect(cache, &PCMCache::pcmChunk,        this, &Track::pcmChunkFromCache);
+        disconnect(cache, &PCMCache::error,           this, &Track::cacheError);
+        disconnect(cache, &PCMCache::diskCacheBuffer, this, &Track::bufferAvailableFromDiskCache);
+        disconnect(cache, &PCMCache::diskCacheLoaded, this, &Track::diskCacheLoaded);
+        disconnect(cache, &PCMCache::gapReached,      this, &Track::cacheGapReached);
 
         disconnect(this, &Track::cacheRequestNextPCMChunk,      cache, &PCMCache::requestNextPCMChunk);
         disconnect(this, &Track::cacheRequestTimestampPCMChunk, cache, &PCMCache::requestTimestampPCMChunk);
+        disconnect(this, &Track::cacheStoreToDisk,              cache, &PCMCache::storeToDiskCache);
 
         delete cache;
     }
@@ -137,128 +165,73 @@ Track::~Track()
 
         delete decoder;
     }
+    qDeleteAll(replacedDecoders);
+
+    delete fader;
 }
 
 
-void Track::analyzerReplayGain(double replayGain)
+QString Track::analysisCacheKey()
 {
-    emit updateReplayGain(replayGain);
+    return analysisCacheKey(diskCacheKey());
 }
 
 
-void Track::analyzerSilences(ReplayGainCalculator::Silences silences)
+QString Track::analysisCacheKey(QString diskCacheKey)
 {
-    this->silences = silences;
-    updateFadeoutStartMilliseconds();
+    // gains of the two engines are not interchangeable
+    if (!diskCacheKey.isEmpty() && isR128()) {
+        diskCacheKey.append("|r128");
+    }
+
+    return diskCacheKey;
 }
 
 
-void Track::applyFade(QByteArray *chunk)
+void Track::analyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences)
 {
-    double framesPerPercent = static_cast<double>(desiredPCMFormat.framesForDuration(getFadeDurationSeconds(fadeDirection) * 1000000)) / 100;
-    double framesPerSample  = 1.0 / desiredPCMFormat.channelCount();
-
-    int dataType = 0;
-    if (desiredPCMFormat.sampleType() == QAudioFormat::SignedInt) {
-        if (desiredPCMFormat.sampleSize() == 8) {
-            dataType = 1;
-        }
-        else if (desiredPCMFormat.sampleSize() == 16) {
-            dataType = 2;
-        }
-        else if (desiredPCMFormat.sampleSize() == 32) {
-            dataType = 3;
-        }
+    if (analysisCached || decoderFailed || rangeSeeked || trackInfo.attributes.contains("radio_station")) {
+        return;
     }
-    else if (desiredPCMFormat.sampleType() == QAudioFormat::UnSignedInt) {
-        if (desiredPCMFormat.sampleSize() == 8) {
-            dataType = 4;
-        }
-        else if (desiredPCMFormat.sampleSize() == 16) {
-            dataType = 5;
-        }
-        else if (desiredPCMFormat.sampleSize() == 32) {
-            dataType = 6;
-        }
+
+    // analyzer ran for silences only if replay gain came from tags
+    if (trackInfo.attributes.contains("replayGain")) {
+        replayGain = trackInfo.attributes.value("replayGain").toDouble();
     }
 
-    qint8   *int8;
-    qint16  *int16;
-    qint32  *int32;
-    quint8  *uint8;
-    quint16 *uint16;
-    quint32 *uint32;
-
-    // simple linear fade
-    char  *data      = chunk->data();
-    int    byteCount = 0;
-    while (byteCount < chunk->size()) {
-        if (dataType != 0) {
-            switch (dataType) {
-                case 1:
-                    int8  = (qint8 *)data;
-                    *int8 = (fadePercent * *int8) / 100;
-                    data      += 1;
-                    byteCount += 1;
-                    break;
-                case 2:
-                    int16  = (qint16 *)data;
-                    *int16 = (fadePercent * *int16) / 100;
-                    data      += 2;
-                    byteCount += 2;
-                    break;
-                case 3:
-                    int32  = (qint32 *)data;
-                    *int32 = (fadePercent * *int32) / 100;
-                    data      += 4;
-                    byteCount += 4;
-                    break;
-                case 4:
-                    uint8  = (quint8 *)data;
-                    *uint8 = (fadePercent * *uint8) / 100;
-                    data      += 1;
-                    byteCount += 1;
-                    break;
-                case 5:
-                    uint16  = (quint16 *)data;
-                    *uint16 = (fadePercent * *uint16) / 100;
-                    data      += 2;
-                    byteCount += 2;
-                    break;
-                case 6:
-                    uint32  = (quint32 *)data;
-                    *uint32 = (fadePercent * *uint32) / 100;
-                    data      += 4;
-                    byteCount += 4;
-            }
-        }
-        else {
-            byteCount += desiredPCMFormat.sampleSize() / 8;
-        }
+    AnalysisCache::instance()->store(analysisCacheKey(), { replayGain, peak, silences, decodedMicroseconds() / 1000 });
+}
 
-        fadeFrameCount += framesPerSample;
 
-        if (fadeFrameCount >= framesPerPercent) {
-            fadeFrameCount = 0;
+void Track::analyzerReplayGain(double replayGain)
+{
+    // segmented analysis might have finished first
+    if (analysisCached) {
+        return;
+    }
 
-            if ((fadeDirection == FadeDirectionIn) && (fadePercent < 100)) {
-                fadePercent++;
+    emit updateReplayGain(replayGain);
+}
 
-                if (fadePercent == 100) {
-                    fadeDirection = FadeDirectionNone;
-                }
-            }
 
-            if ((fadeDirection == FadeDirectionOut) && (fadePercent > 0)) {
-                fadePercent--;
+void Track::analyzerSilences(ReplayGainCalculator::Silences silences)
+{
+    if (analysisCached) {
+        return;
+    }
 
-                if (fadePercent == 0) {
-                    QTimer::singleShot(soundOutput->remainingMilliseconds() + PCMCache::BUFFER_CREATE_MILLISECONDS, this, SLOT(sendFinished()));
-                    break;
-                }
-            }
+    // analyzer sends only what's new, silence at end might be sent again when requested
+    foreach (ReplayGainCalculator::SilenceRange silence, silences) {
+        // analyzer didn't get the whole track after a range seek, its end is not the end of the track
+        if (rangeSeeked && (silence.type == ReplayGainCalculator::SilenceAtEnd)) {
+            continue;
+        }
+        if ((this->silences.count() > 0) && (this->silences.last().type == ReplayGainCalculator::SilenceAtEnd)) {
+            this->silences.removeLast();
         }
+        this->silences.append(silence);
     }
+    updateFadeoutStartMilliseconds();
 }
 
 
@@ -291,18 +264,47 @@ void Track::attributeRemove(QString key)
 
 void Track::bufferAvailableFromDecoder(QAudioBuffer *buffer)
 {
+    // sent by a decoder that was replaced by a range seek, belongs to the old write position
+    if (sender() != decoder) {
+        delete buffer;
+        return;
+    }
+
     if (QDateTime::currentMSecsSinceEpoch() >= (decodingInfoLastSent + DECODING_CB_DELAY_MILLISECONDS)) {
-        (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(decoder->downloadPercent(), decodedPercent(), this);
+        (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(downloadPercent(), decodedPercent(), this);
         decodingInfoLastSent = QDateTime::currentMSecsSinceEpoch();
     }
 
     cache->storeBuffer(buffer);
 
+    if (analysisCached || rangeSeeked) {
+        delete buffer;
+        return;
+    }
+
+    analyzerQueueMutex.lock();
+    analyzerQueue.append(buffer);
+    analyzerQueueMutex.unlock();
+
+    emit bufferAvailableToAnalyzer();
+}
+
+
+void Track::bufferAvailableFromDiskCache(QAudioBuffer *buffer)
+{
+    if (analysisCached) {
+        delete buffer;
+        requestDiskCacheBuffer();
+        return;
+    }
+
     analyzerQueueMutex.lock();
     analyzerQueue.append(buffer);
     analyzerQueueMutex.unlock();
 
     emit bufferAvailableToAnalyzer();
+
+    requestDiskCacheBuffer();
 }
 
 
@@ -312,6 +314,18 @@ void Track::cacheError(QString info, QString errorMessage)
 }
 
 
+// playback reached a part that was skipped by a range seek
+void Track::cacheGapReached(qint64 microseconds)
+{
+    if (currentStatus != Playing) {
+        return;
+    }
+
+    // the cache sends the chunk when it arrives
+    rangeSeek(microseconds);
+}
+
+
 void Track::changeStatus(Status status)
 {
     currentStatus = status;
@@ -319,6 +333,52 @@ void Track::changeStatus(Status status)
 }
 
 
+// the stream is requested at a lower bitrate when earlier downloads from the same server were too slow
+void Track::chooseStreamVariant()
+{
+    if (trackInfo.attributes.contains("radio_station")) {
+        return;
+    }
+
+    // the original is played from the compressed cache, a lower bitrate wouldn't save anything
+    if (isCompressedCacheHit()) {
+        return;
+    }
+
+    QUrl variant = AdaptiveBitrate::instance()->variantUrl(trackInfo.attributes.value("serverSettingsId").toString(), trackInfo.url);
+    if (variant == streamUrl) {
+        return;
+    }
+    streamUrl      = variant;
+    reducedBitrate = streamUrl != trackInfo.url;
+
+    // decoder thread is not started yet
+    decoder->setUrl(decoderUrl(0));
+    decoder->setCacheKey(compressedCacheKey(streamUrl));
+}
+
+
+// transcoding parameters are part of the key, the same song in another format is another file
+QString Track::compressedCacheKey(QUrl url)
+{
+    if (trackInfo.attributes.contains("radio_station") || !trackInfo.attributes.contains("serverSettingsId")) {
+        return "";
+    }
+
+    QUrlQuery query(url);
+    return QString("%1|%2|%3|%4").arg(diskCacheKey(), query.queryItemValue("format"), query.queryItemValue("bitrate"), query.queryItemValue("transcode_to"));
+}
+
+
+qint64 Track::decodedMicroseconds()
+{
+    if (isDiskCacheHit()) {
+        return diskCacheMicroseconds;
+    }
+    return rangeStartMicroseconds + decoder->getDecodedMicroseconds();
+}
+
+
 double Track::decodedPercent()
 {
     bool isRadio = trackInfo.attributes.contains("radio_station");
@@ -345,7 +405,9 @@ void Track::decoderError(QString info, QString errorMessage)
 {
     emit error(trackInfo.id, info, errorMessage);
 
-    if ((currentStatus == Playing) && ((decoder->getDecodedMicroseconds() / 1000 - 1000) > posMilliseconds)) {
+    decoderFailed = true;
+
+    if ((currentStatus == Playing) && ((decodedMicroseconds() / 1000 - 1000) > posMilliseconds)) {
         decoderFinished();
         return;
     }
@@ -356,22 +418,27 @@ void Track::decoderError(QString info, QString errorMessage)
 
 void Track::decoderFinished()
 {
+    // a track that was cut short or streamed at a lower bitrate must not be stored for later sessions
+    if (!isDiskCacheHit() && !decoderFailed && !reducedBitrate && (!trackInfo.attributes.contains("lengthMilliseconds") || (decodedMicroseconds() / 1000 >= getLengthMilliseconds() - DISK_CACHE_LENGTH_TOLERANCE_MILLISECONDS))) {
+        emit cacheStoreToDisk();
+    }
+
     decodingDone = true;
 
-    emit decoded(trackInfo.id, decoder->getDecodedMicroseconds() / 1000);
+    emit decoded(trackInfo.id, decodedMicroseconds() / 1000);
 
     emit decoderDone();
-    (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(decoder->downloadPercent(), decodedPercent(), this);
+    (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(downloadPercent(), decodedPercent(), this);
 
-    trackInfo.attributes.insert("lengthMilliseconds", decoder->getDecodedMicroseconds() / 1000);
+    trackInfo.attributes.insert("lengthMilliseconds", decodedMicroseconds() / 1000);
     emit trackInfoUpdated(trackInfo.id);
 
-    if ((silences.count() == 0) || (silences.last().type != ReplayGainCalculator::SilenceAtEnd)) {
+    if (!analysisCached && ((silences.count() == 0) || (silences.last().type != ReplayGainCalculator::SilenceAtEnd))) {
         QTimer::singleShot(100, this, &Track::requestSilencesUpdate);
     }
 
     if (currentStatus == Paused) {
-        emit playPosition(trackInfo.id, true, decoder->getDecodedMicroseconds() / 1000, posMilliseconds);
+        emit playPosition(trackInfo.id, true, decodedMicroseconds() / 1000, posMilliseconds);
     }
 
     updateFadeoutStartMilliseconds();
@@ -400,12 +467,67 @@ void Track::decoderNetworkStarting(bool starting)
 void Track::decoderNetworkBufferChanged()
 {
     if (QDateTime::currentMSecsSinceEpoch() >= (decodingInfoLastSent + DECODING_CB_DELAY_MILLISECONDS)) {
-        (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(decoder->downloadPercent(), decodedPercent(), this);
+        (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(downloadPercent(), decodedPercent(), this);
         decodingInfoLastSent = QDateTime::currentMSecsSinceEpoch();
     }
 }
 
 
+void Track::decoderNetworkThroughput(double bytesPerSecond, double streamBytesPerSecond)
+{
+    AdaptiveBitrate::instance()->reportThroughput(trackInfo.attributes.value("serverSettingsId").toString(), bytesPerSecond, streamBytesPerSecond, streamUrl == trackInfo.url);
+}
+
+
+// a song that was downloaded before is decoded from the disk, range requests always go to the server
+QUrl Track::decoderUrl(qint64 rangeStart)
+{
+    if (rangeStart > 0) {
+        return streamUrl;
+    }
+
+    QString compressedPath = DiskCache::compressedInstance()->lookup(compressedCacheKey(streamUrl));
+    if (!compressedPath.isEmpty()) {
+        return QUrl::fromLocalFile(compressedPath);
+    }
+
+    return streamUrl;
+}
+
+
+QString Track::diskCacheKey()
+{
+    if (trackInfo.attributes.contains("radio_station")) {
+        return "";
+    }
+
+    if (trackInfo.attributes.contains("serverSettingsId")) {
+        return QString("%1|%2").arg(trackInfo.attributes.value("serverSettingsId").toString(), trackInfo.id.split("|").at(0).mid(1));
+    }
+
+    if (trackInfo.url.isLocalFile()) {
+        return localFileCacheKey(trackInfo.url.toLocalFile());
+    }
+
+    return "";
+}
+
+
+void Track::diskCacheLoaded()
+{
+    decoderFinished();
+}
+
+
+double Track::downloadPercent()
+{
+    if (isDiskCacheHit()) {
+        return decoder->isFile() ? 0 : 1;
+    }
+    return decoder->downloadPercent();
+}
+
+
 QString Track::equalizerSettingsPrefix()
 {
     QString prefix = "eq";
@@ -434,7 +556,7 @@ void Track::equalizerReplayGainChanged(double current)
 
 qint64 Track::getDecodedMilliseconds()
 {
-    return decoder->getDecodedMicroseconds() / 1000;
+    return decodedMicroseconds() / 1000;
 }
 
 
@@ -456,15 +578,14 @@ int Track::getFadeDurationSeconds(FadeDirection fadeDirection)
         return SHORT_FADE_SECONDS;
     }
 
-    QSettings settings;
-    return settings.value("options/fade_seconds", DEFAULT_FADE_SECONDS).toInt();
+    return fadeSeconds;
 }
 
 
 qint64 Track::getLengthMilliseconds()
 {
     if (decodingDone) {
-        return decoder->getDecodedMicroseconds() / 1000;
+        return decodedMicroseconds() / 1000;
     }
 
     if (trackInfo.attributes.contains("lengthMilliseconds")) {
@@ -485,6 +606,12 @@ bool Track::getNetworkStartingLastState()
 }
 
 
+qint64 Track::getPCMMemoryUsage()
+{
+    return cache->memoryUsage();
+}
+
+
 qint64 Track::getPlayedMillseconds()
 {
     return posMilliseconds;
@@ -519,6 +646,25 @@ Track::TrackInfo Track::getTrackInfo()
 }
 
 
+bool Track::isAnalysisCached()
+{
+    return analysisCached;
+}
+
+
+bool Track::isCompressedCacheHit()
+{
+    QString cacheKey = compressedCacheKey(trackInfo.url);
+    return !cacheKey.isEmpty() && !DiskCache::compressedInstance()->lookup(cacheKey).isEmpty();
+}
+
+
+bool Track::isDiskCacheHit()
+{
+    return !diskCachePath.isEmpty();
+}
+
+
 bool Track::isDoFade()
 {
     if (fadeTags.contains("*")) {
@@ -534,6 +680,42 @@ bool Track::isDoFade()
 }
 
 
+bool Track::isR128()
+{
+    QSettings settings;
+    return settings.value("options/r128_loudness", DEFAULT_R128_LOUDNESS).toBool();
+}
+
+
+// results of an earlier analysis make the analyzer unnecessary
+bool Track::loadCachedAnalysis()
+{
+    analysisCached = AnalysisCache::instance()->load(analysisCacheKey(), &cachedAnalysis);
+
+    if (analysisCached) {
+        silences = cachedAnalysis.silences;
+        updateFadeoutStartMilliseconds();
+
+        if (!trackInfo.attributes.contains("lengthMilliseconds") && (cachedAnalysis.lengthMilliseconds > 0)) {
+            trackInfo.attributes.insert("lengthMilliseconds", cachedAnalysis.lengthMilliseconds);
+        }
+
+        // tags take precedence, the library scanner doesn't read them
+        emit updateReplayGain(trackInfo.attributes.contains("replayGain") ? trackInfo.attributes.value("replayGain").toDouble() : cachedAnalysis.replayGain);
+    }
+
+    return analysisCached;
+}
+
+
+// the size catches files rewritten in place with a preserved or coarse modification time
+QString Track::localFileCacheKey(QString filePath)
+{
+    QFileInfo fileInfo(filePath);
+    return QString("%1|%2|%3").arg(fileInfo.absoluteFilePath()).arg(fileInfo.size()).arg(fileInfo.lastModified().toMSecsSinceEpoch());
+}
+
+
 void Track::optionsUpdated()
 {
     QSettings settings;
@@ -541,6 +723,10 @@ void Track::optionsUpdated()
     fadeTags.clear();
     fadeTags.append(settings.value("options/fade_tags", DEFAULT_FADE_TAGS).toString().split(","));
 
+    fadeSeconds = settings.value("options/fade_seconds", DEFAULT_FADE_SECONDS).toInt();
+    fadeCurve   = settings.value("options/fade_curve", DEFAULT_FADE_CURVE).toInt();
+    fader->setCurve(static_cast<Fader::Curve>(fadeCurve));
+
     updateFadeoutStartMilliseconds();
 
     skipLongSilence             = settings.value("options/skip_long_silence", DEFAULT_SKIP_LONG_SILENCE).toBool();
@@ -569,7 +755,7 @@ void Track::optionsUpdated()
     }
 
     if (soundOutput != nullptr) {
-        soundOutput->wideStereoDelayChanged(settings.value("options/wide_stereo_delay_millisec").toInt());
+        soundOutput->wideStereoDelayChanged(settings.value("options/wide_stereo_delay_millisec", DEFAULT_WIDE_STEREO_DELAY_MILLISEC).toDouble());
     }
 }
 
@@ -589,13 +775,17 @@ void Track::outputNeedChunk()
 
 void Track::outputBufferUnderrun()
 {
-    if (decodingDone && (posMilliseconds >= (decoder->getDecodedMicroseconds() / 1000 - 1000))) {
+    if (decodingDone && (posMilliseconds >= (decodedMicroseconds() / 1000 - 1000))) {
         sendFinished();
         return;
     }
 
+    if (!decodingDone && !decoder->isFile()) {
+        AdaptiveBitrate::instance()->reportUnderrun(trackInfo.attributes.value("serverSettingsId").toString());
+    }
+
     emit info(trackInfo.id, tr("Buffer underrun, waiting..."));
-    decodedMillisecondsAtUnderrun = decoder->getDecodedMicroseconds() / 1000;
+    decodedMillisecondsAtUnderrun = decodedMicroseconds() / 1000;
     posMillisecondsAtUnderrun = posMilliseconds;
     QTimer::singleShot(UNDERRUN_DELAY_MILLISECONDS, this, SLOT(underrunTimeout()));
 }
@@ -616,7 +806,7 @@ void Track::outputPositionChanged(qint64 posMilliseconds)
     emit playPosition(trackInfo.id, decodingDone, getLengthMilliseconds(), posMilliseconds);
 
     if (!decodingDone) {
-        unsigned long delay = static_cast<unsigned long>(pow(4, log10(qMax(decoder->getDecodedMicroseconds() / 1000 - posMilliseconds, 1ll))));
+        unsigned long delay = static_cast<unsigned long>(pow(4, log10(qMax(decodedMicroseconds() / 1000 - posMilliseconds, 1ll))));
         #ifdef Q_OS_WINDOWS
             delay *= 3;
             if (trackInfo.attributes.contains("radio_station")) {
@@ -630,14 +820,16 @@ void Track::outputPositionChanged(qint64 posMilliseconds)
         trackInfo.title = radioTitlePositions.first().title;
         radioTitlePositions.removeFirst();
         emit trackInfoUpdated(trackInfo.id);
+
+        silences.clear();
         emit resetReplayGain();
     }
 
-    if (decodingDone && (posMilliseconds >= decoder->getDecodedMicroseconds() / 1000 - 50)) {
+    if (decodingDone && (posMilliseconds >= decodedMicroseconds() / 1000 - 50)) {
         sendFinished();
         return;
     }
-    if ((posMilliseconds >= fadeoutStartMilliseconds) && (fadeDirection == FadeDirectionOut)) {
+    if ((posMilliseconds >= fadeoutStartMilliseconds) && fader->isFadingOut()) {
         sendFadeoutStarted();
         return;
     }
@@ -666,14 +858,12 @@ void Track::pcmChunkFromCache(QByteArray chunk, qint64 startMicroseconds)
 
 void Track::pcmChunkFromEqualizer(TimedChunk chunk)
 {
-    if ((fadeDirection == FadeDirectionNone) && isDoFade() && ((chunk.startMicroseconds + desiredPCMFormat.durationForBytes(chunk.chunkPointer->size())) / 1000 >= fadeoutStartMilliseconds)) {
-        fadeDirection  = FadeDirectionOut;
-        fadePercent    = 100;
-        fadeFrameCount = 0;
+    if (fader->isIdle() && isDoFade() && ((chunk.startMicroseconds + desiredPCMFormat.durationForBytes(chunk.chunkPointer->size())) / 1000 >= fadeoutStartMilliseconds)) {
+        fader->fadeOut(getFadeDurationSeconds(FadeDirectionOut) * USEC_PER_SEC);
     }
 
-    if (fadeDirection != FadeDirectionNone) {
-        applyFade(chunk.chunkPointer);
+    if (fader->apply(chunk.chunkPointer->data(), chunk.chunkPointer->size())) {
+        QTimer::singleShot(soundOutput->remainingMilliseconds() + PCMCache::BUFFER_CREATE_MILLISECONDS, this, SLOT(sendFinished()));
     }
 
     outputQueueMutex.lock();
@@ -693,20 +883,84 @@ void Track::radioTitleCallback(QString title)
         decodingCompensation *= -1;
     #endif
 
-    radioTitlePositions.append({ decoder->getDecodedMicroseconds() + decodingCompensation, title });
+    radioTitlePositions.append({ decodedMicroseconds() + decodingCompensation, title });
+}
+
+
+// long remote tracks don't have to be downloaded up to the position, decoding restarts there with a range request
+bool Track::rangeSeek(qint64 microseconds)
+{
+    if (trackInfo.attributes.contains("radio_station") || isDiskCacheHit() || decoder->isFile()) {
+        return false;
+    }
+
+    qint64 lengthMicroseconds = getLengthMilliseconds() * 1000;
+    if ((microseconds < 0) || (microseconds >= lengthMicroseconds) || cache->isDecoded(microseconds)) {
+        return false;
+    }
+
+    // the decoder gets there soon anyway
+    qint64 decodedUntil = decodedMicroseconds();
+    if (!decodingDone && (microseconds >= decodedUntil) && (microseconds < decodedUntil + RANGE_SEEK_AHEAD_MILLISECONDS * 1000)) {
+        return false;
+    }
+
+    // only the decoder that downloads from the beginning knows these, so they're kept for later seeks
+    if ((compressedBytes <= 0) && !decoder->getSeekInfo(&seekTable, &compressedBytes)) {
+        return false;
+    }
+    if (!seekTable.isSeekable()) {
+        return false;
+    }
+
+    disconnect(&decoderThread, &QThread::started, decoder, &DecoderGeneric::run);
+
+    disconnect(decoder, &DecoderGeneric::bufferAvailable,      this, &Track::bufferAvailableFromDecoder);
+    disconnect(decoder, &DecoderGeneric::networkBufferChanged, this, &Track::decoderNetworkBufferChanged);
+    disconnect(decoder, &DecoderGeneric::networkStarting,      this, &Track::decoderNetworkStarting);
+    disconnect(decoder, &DecoderGeneric::networkThroughput,    this, &Track::decoderNetworkThroughput);
+    disconnect(decoder, &DecoderGeneric::finished,             this, &Track::decoderFinished);
+    disconnect(decoder, &DecoderGeneric::errorMessage,         this, &Track::decoderError);
+    disconnect(decoder, &DecoderGeneric::infoMessage,          this, &Track::decoderInfo);
+    disconnect(decoder, &DecoderGeneric::sessionExpired,       this, &Track::decoderSessionExpired);
+
+    disconnect(this, &Track::startDecode, decoder, &DecoderGeneric::start);
+
+    decoderThread.requestInterruption();
+    decoderThread.quit();
+    decoderThread.wait();
+
+    // buffers the old decoder already sent are still in the event queue, bufferAvailableFromDecoder drops them by their sender
+    // the old decoder is deleted only after them, so a new decoder can't get its address in the meantime
+    replacedDecoders.append(decoder);
+    QMetaObject::invokeMethod(this, [this]() {
+        delete replacedDecoders.takeFirst();
+    }, Qt::QueuedConnection);
+
+    rangeSeeked            = true;
+    rangeStartMicroseconds = desiredPCMFormat.durationForBytes(desiredPCMFormat.bytesForDuration(microseconds));
+    decodingDone           = false;
+
+    cache->setWritePosition(rangeStartMicroseconds);
+
+    setupDecoder(seekTable.byteOffset(static_cast<double>(microseconds) / lengthMicroseconds, compressedBytes));
+    decoderThread.start();
+    emit startDecode();
+
+    return true;
 }
 
 
 void Track::requestForBufferReplayGainInfo()
 {
-    (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(decoder->downloadPercent(), decodedPercent(), this);
+    (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(downloadPercent(), decodedPercent(), this);
     emit requestReplayGainInfo();
 }
 
 
 void Track::requestDecodingCallback()
 {
-    double dlp = decoder->downloadPercent();
+    double dlp = downloadPercent();
     double dcp = decodedPercent();
 
     if ((dlp > 0) || (dcp > 0)) {
@@ -715,9 +969,25 @@ void Track::requestDecodingCallback()
 }
 
 
+// the analyzer is fed from the mapped disk cache only as fast as it consumes, a cached analysis needs no copies at all
+void Track::requestDiskCacheBuffer()
+{
+    analyzerQueueMutex.lock();
+    int queued = analyzerQueue.count();
+    analyzerQueueMutex.unlock();
+
+    if (queued >= DISK_CACHE_QUEUED_BUFFERS) {
+        QTimer::singleShot(DISK_CACHE_POLL_MILLISECONDS, this, &Track::requestDiskCacheBuffer);
+        return;
+    }
+
+    emit cacheRequestDiskCacheBuffer(!analysisCached);
+}
+
+
 void Track::requestSilencesUpdate()
 {
-    if (soundOutput == nullptr) {
+    if ((soundOutput == nullptr) || rangeSeeked) {
         return;
     }
     if ((silences.count() > 0) && (silences.last().type == ReplayGainCalculator::SilenceAtEnd)) {
@@ -728,6 +998,28 @@ void Track::requestSilencesUpdate()
 }
 
 
+// segmented analysis is stopped when playing begins, so its gain never changes mid-playback
+void Track::segmentedAnalyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences, qint64 lengthMilliseconds)
+{
+    if (analysisCached || decoderFailed || (segmentedAnalyzer == nullptr)) {
+        return;
+    }
+
+    if (trackInfo.attributes.contains("replayGain")) {
+        replayGain = trackInfo.attributes.value("replayGain").toDouble();
+    }
+
+    AnalysisCache::instance()->store(analysisCacheKey(), { replayGain, peak, silences, lengthMilliseconds });
+    loadCachedAnalysis();
+
+    // the sequential analyzer won't be started, buffers held for it are not needed any more
+    analyzerQueueMutex.lock();
+    qDeleteAll(analyzerQueue);
+    analyzerQueue.clear();
+    analyzerQueueMutex.unlock();
+}
+
+
 void Track::sendFadeoutStarted()
 {
     if (fadeoutStartedSent) {
@@ -749,6 +1041,12 @@ void Track::sendFinished()
 }
 
 
+void Track::setMemoryRole(PCMMemoryBudget::Role memoryRole)
+{
+    cache->setMemoryRole(memoryRole);
+}
+
+
 void Track::setPosition(qint64 microSecond)
 {
     if (getStatus() != Playing) {
@@ -757,6 +1055,8 @@ void Track::setPosition(qint64 microSecond)
 
     emit pause();
     emit resume();
+
+    rangeSeek(microSecond);
     emit cacheRequestTimestampPCMChunk(microSecond / 1000);
 }
 
@@ -773,6 +1073,8 @@ void Track::setPosition(double percent)
 
         emit pause();
         emit resume();
+
+        rangeSeek(static_cast<qint64>(newPosition * 1000));
         emit cacheRequestTimestampPCMChunk(static_cast<long>(newPosition));
     }
 }
@@ -807,9 +1109,7 @@ void Track::setStatus(Status status)
         if ((currentStatus == Playing) && !stopping) {
             stopping = true;
 
-            fadeDirection       = FadeDirectionOut;
-            fadePercent         = 100;
-            fadeFrameCount      = 0;
+            fader->fadeOut(getFadeDurationSeconds(FadeDirectionOut) * USEC_PER_SEC);
             return;
         }
 
@@ -820,9 +1120,18 @@ void Track::setStatus(Status status)
     }
 
     if ((status == Decoding) && (currentStatus == Idle)) {
-        analyzerThread.start();
+        // look-ahead analysis might have finished since this track was created
+        if (!analysisCached && !loadCachedAnalysis()) {
+            startAnalysis(true);
+        }
         cacheThread.start();
-        decoderThread.start();
+        if (!isDiskCacheHit()) {
+            chooseStreamVariant();
+            decoderThread.start();
+        }
+        else {
+            requestDiskCacheBuffer();
+        }
 
         emit startDecode();
 
@@ -831,19 +1140,28 @@ void Track::setStatus(Status status)
     }
 
     if ((status == Playing) && (currentStatus == Idle)) {
-        analyzerThread.start();
+        cache->setMemoryRole(PCMMemoryBudget::Current);
+
+        // look-ahead analysis might have finished since this track was created
+        if (!analysisCached && !loadCachedAnalysis()) {
+            startAnalysis(false);
+        }
         equalizerThread.start();
         cacheThread.start();
-        decoderThread.start();
+        if (!isDiskCacheHit()) {
+            chooseStreamVariant();
+            decoderThread.start();
+        }
+        else {
+            requestDiskCacheBuffer();
+        }
         outputThread.start(QThread::HighestPriority);
 
         emit startDecode();
         emit playBegins();
 
         if (isDoFade()) {
-            fadeDirection       = FadeDirectionIn;
-            fadePercent         = 0;
-            fadeFrameCount      = 0;
+            fader->fadeIn(getFadeDurationSeconds(FadeDirectionIn) * USEC_PER_SEC);
         }
 
         if (equalizerQueue.size() > 0) {
@@ -855,21 +1173,29 @@ void Track::setStatus(Status status)
 
         changeStatus(Playing);
 
-        (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(decoder->downloadPercent(), decodedPercent(), this);
+        (decodingCallbackInfo.callbackObject->*decodingCallbackInfo.callbackMethod)(downloadPercent(), decodedPercent(), this);
 
         return;
     }
 
     if ((status == Playing) && (currentStatus == Decoding)) {
+        cache->setMemoryRole(PCMMemoryBudget::Current);
+
+        // segmented analysis didn't finish in time, the sequential analyzer takes over with the buffers held for it
+        if (segmentedAnalyzer != nullptr) {
+            stopSegmentedAnalysis();
+            if (!analysisCached) {
+                analyzerThread.start();
+            }
+        }
+
         equalizerThread.start();
         outputThread.start(QThread::HighestPriority);
 
         emit playBegins();
 
         if (isDoFade()) {
-            fadeDirection       = FadeDirectionIn;
-            fadePercent         = 0;
-            fadeFrameCount      = 0;
+            fader->fadeIn(getFadeDurationSeconds(FadeDirectionIn) * USEC_PER_SEC);
         }
 
         if (equalizerQueue.size() > 0) {
@@ -891,14 +1217,12 @@ void Track::setStatus(Status status)
     }
 
     if ((status == Playing) && (currentStatus == Paused)) {
-        if (decodingDone && (posMilliseconds >= decoder->getDecodedMicroseconds() / 1000 - 2500)) {
+        if (decodingDone && (posMilliseconds >= decodedMicroseconds() / 1000 - 2500)) {
             sendFinished();
             return;
         }
 
-        fadeDirection       = FadeDirectionIn;
-        fadePercent         = 0;
-        fadeFrameCount      = 0;
+        fader->fadeIn(getFadeDurationSeconds(FadeDirectionIn) * USEC_PER_SEC);
 
         emit resume();
 
@@ -920,12 +1244,15 @@ void Track::setupAnalyzer()
     analyzer = new Analyzer(desiredPCMFormat);
 
     analyzer->setBufferQueue(&analyzerQueue, &analyzerQueueMutex);
+    analyzer->setSilenceOnly(trackInfo.attributes.contains("replayGain"));
+    analyzer->setEngine(isR128() ? Analyzer::R128Engine : Analyzer::ReplayGainEngine);
     analyzer->moveToThread(&analyzerThread);
 
     connect(&analyzerThread, &QThread::started,  analyzer, &Analyzer::run);
 
-    connect(analyzer, &Analyzer::replayGain, this, &Track::analyzerReplayGain);
-    connect(analyzer, &Analyzer::silences,   this, &Track::analyzerSilences);
+    connect(analyzer, &Analyzer::replayGain,       this, &Track::analyzerReplayGain);
+    connect(analyzer, &Analyzer::silences,         this, &Track::analyzerSilences);
+    connect(analyzer, &Analyzer::analysisFinished, this, &Track::analyzerFinished);
 
     connect(this, &Track::bufferAvailableToAnalyzer,   analyzer, &Analyzer::bufferAvailable);
     connect(this, &Track::decoderDone,                 analyzer, &Analyzer::decoderDone);
@@ -936,21 +1263,35 @@ void Track::setupAnalyzer()
 
 void Track::setupCache()
 {
+    QString key   = diskCacheKey();
+    diskCachePath = DiskCache::pcmInstance()->lookup(key);
+    if (isDiskCacheHit()) {
+        diskCacheMicroseconds = desiredPCMFormat.durationForBytes(QFileInfo(diskCachePath).size());
+        trackInfo.attributes.insert("lengthMilliseconds", diskCacheMicroseconds / 1000);
+    }
+
     cache = new PCMCache(desiredPCMFormat, getLengthMilliseconds(), trackInfo.attributes.contains("radio_station"));
+    cache->setDiskCache(key, diskCachePath);
 
     cache->moveToThread(&cacheThread);
 
     connect(&cacheThread, &QThread::started, cache, &PCMCache::run);
 
-    connect(cache, &PCMCache::pcmChunk, this, &Track::pcmChunkFromCache);
-    connect(cache, &PCMCache::error,    this, &Track::cacheError);
+    connect(cache, &PCMCache::pcmChunk,        this, &Track::pcmChunkFromCache);
+    connect(cache, &PCMCache::error,           this, &Track::cacheError);
+    connect(cache, &PCMCache::diskCacheBuffer, this, &Track::bufferAvailableFromDiskCache);
+    connect(cache, &PCMCache::diskCacheLoaded, this, &Track::diskCacheLoaded);
+    connect(cache, &PCMCache::gapReached,      this, &Track::cacheGapReached);
 
     connect(this, &Track::cacheRequestNextPCMChunk,      cache, &PCMCache::requestNextPCMChunk);
     connect(this, &Track::cacheRequestTimestampPCMChunk, cache, &PCMCache::requestTimestampPCMChunk);
+    connect(this, &Track::cacheStoreToDisk,              cache, &PCMCache::storeToDiskCache);
+    connect(this, &Track::cacheRequestDiskCacheBuffer,   cache, &PCMCache::requestDiskCacheBuffer);
 }
 
 
-void Track::setupDecoder()
+// decoding starts from this byte of a remote track, zero is the beginning
+void Track::setupDecoder(qint64 rangeStart)
 {
     decoder = new DecoderGeneric({ this, (RadioTitleCallback::RadioTitleCallbackPointer)&Track::radioTitleCallback });
 
@@ -959,7 +1300,10 @@ void Track::setupDecoder()
         waitUnderBytes = 65536;
     #endif
 
-    decoder->setParameters(trackInfo.url, desiredPCMFormat, waitUnderBytes, trackInfo.attributes.contains("radio_station"), !trackInfo.attributes.contains("radio_station"));
+    decoder->setParameters(decoderUrl(rangeStart), desiredPCMFormat, waitUnderBytes, trackInfo.attributes.contains("radio_station"), !trackInfo.attributes.contains("radio_station") && (rangeStart == 0));
+    decoder->setRangeStart(rangeStart);
+    decoder->setCacheKey(compressedCacheKey(streamUrl));
+    decoder->setLengthMilliseconds(getLengthMilliseconds());
     decoder->moveToThread(&decoderThread);
 
     connect(&decoderThread, &QThread::started, decoder, &DecoderGeneric::run);
@@ -967,6 +1311,7 @@ void Track::setupDecoder()
     connect(decoder, &DecoderGeneric::bufferAvailable,      this, &Track::bufferAvailableFromDecoder);
     connect(decoder, &DecoderGeneric::networkBufferChanged, this, &Track::decoderNetworkBufferChanged);
     connect(decoder, &DecoderGeneric::networkStarting,      this, &Track::decoderNetworkStarting);
+    connect(decoder, &DecoderGeneric::networkThroughput,    this, &Track::decoderNetworkThroughput);
     connect(decoder, &DecoderGeneric::finished,             this, &Track::decoderFinished);
     connect(decoder, &DecoderGeneric::errorMessage,         this, &Track::decoderError);
     connect(decoder, &DecoderGeneric::infoMessage,          this, &Track::decoderInfo);
@@ -1017,7 +1362,7 @@ void Track::setupEqualizer()
 
 void Track::setupOutput()
 {
-    soundOutput = new SoundOutput(desiredPCMFormat, peakCallbackInfo);
+    soundOutput = new SoundOutput(desiredPCMFormat, static_cast<void *>(this));
     soundOutput->setBufferQueue(&outputQueue, &outputQueueMutex);
     soundOutput->moveToThread(&outputThread);
 
@@ -1034,9 +1379,41 @@ void Track::setupOutput()
 }
 
 
+// long lossless local files that are decoded ahead of playback are analyzed in parallel segments instead
+void Track::startAnalysis(bool allowSegmented)
+{
+    QSettings settings;
+    if (!allowSegmented || !settings.value("options/segmented_analysis", DEFAULT_SEGMENTED_ANALYSIS).toBool() || !trackInfo.url.isLocalFile() || !SegmentedAnalyzer::isSupported(trackInfo.url.toLocalFile())) {
+        analyzerThread.start();
+        return;
+    }
+
+    segmentedAnalyzer = new SegmentedAnalyzer(trackInfo.url.toLocalFile(), desiredPCMFormat);
+    segmentedAnalyzer->setSilenceOnly(trackInfo.attributes.contains("replayGain"));
+    segmentedAnalyzer->setEngine(isR128() ? Analyzer::R128Engine : Analyzer::ReplayGainEngine);
+
+    connect(segmentedAnalyzer, &SegmentedAnalyzer::finished, this, &Track::segmentedAnalyzerFinished);
+
+    segmentedAnalyzer->start();
+}
+
+
+void Track::stopSegmentedAnalysis()
+{
+    if (segmentedAnalyzer == nullptr) {
+        return;
+    }
+
+    disconnect(segmentedAnalyzer, &SegmentedAnalyzer::finished, this, &Track::segmentedAnalyzerFinished);
+
+    delete segmentedAnalyzer;
+    segmentedAnalyzer = nullptr;
+}
+
+
 void Track::underrunTimeout()
 {
-    if ((!decodingDone && (decoder != nullptr) && (decodedMillisecondsAtUnderrun >= decoder->getDecodedMicroseconds() / 1000)) || (decodingDone && (posMilliseconds == posMillisecondsAtUnderrun))) {
+    if ((!decodingDone && (decoder != nullptr) && (decodedMillisecondsAtUnderrun >= decodedMicroseconds() / 1000)) || (decodingDone && (posMilliseconds == posMillisecondsAtUnderrun))) {
         emit error(trackInfo.id, tr("Buffer underrun."), tr("Possible download interruption due to a network error."));
         sendFinished();
     }
@@ -9,9 +9,11 @@
 
 #include <QAudioFormat>
 #include <QDateTime>
+#include <QFileInfo>
 #include <QHash>
 #include <QList>
 #include <QMap>
+#include <QMetaObject>
 #include <QMutex>
 #include <QObject>
 #include <QRegExp>
@@ -21,16 +23,22 @@
 #include <QThread>
 #include <QTimer>
 #include <QUrl>
+#include <QUrlQuery>
 #include <QUuid>
 
+#include "adaptivebitrate.h"
+#include "analysiscache.h"
 #include "analyzer.h"
 #include "decodergeneric.h"
 #include "decodingcallback.h"
+#include "diskcache.h"
 #include "equalizer.h"
+#include "fader.h"
 #include "globals.h"
-#include "peakcallback.h"
 #include "pcmcache.h"
 #include "radiotitlecallback.h"
+#include "seektable.h"
+#include "segmentedanalyzer.h"
 #include "soundoutput.h"
 
 #ifdef QT_DEBUG
@@ -79,7 +87,7 @@ class Track : public QObject, RadioTitleCallback
         static const int EQ_CHOOSER_TRACK  = 2;
 
 
-        explicit Track(TrackInfo trackInfo, PeakCallback::PeakCallbackInfo peakCallbackInfo, DecodingCallback::DecodingCallbackInfo decodingCallbackInfo, QObject *parent = 0);
+        explicit Track(TrackInfo trackInfo, DecodingCallback::DecodingCallbackInfo decodingCallbackInfo, QObject *parent = 0);
         ~Track();
 
         Status  getStatus();
@@ -95,11 +103,20 @@ class Track : public QObject, RadioTitleCallback
         qint64          getDecodedMilliseconds();
         qint64          getLengthMilliseconds();
         qint64          getPlayedMillseconds();
+        qint64          getPCMMemoryUsage();
+        void            setMemoryRole(PCMMemoryBudget::Role memoryRole);
         int             getFadeDurationSeconds(FadeDirection fadeDirection);
         void            setShortFadeBeginning(bool shortFade);
         void            setShortFadeEnd(bool shortFade);
         QVector<double> getEqualizerBandCenterFrequencies();
         bool            getNetworkStartingLastState();
+        QString         analysisCacheKey();
+        bool            isAnalysisCached();
+        bool            isCompressedCacheHit();
+
+        static QString analysisCacheKey(QString diskCacheKey);
+        static QString localFileCacheKey(QString filePath);
+        static bool    isR128();
 
         void optionsUpdated();
         void requestDecodingCallback();
@@ -113,6 +130,11 @@ class Track : public QObject, RadioTitleCallback
         static const int  DECODING_CB_DELAY_MILLISECONDS = 40;
         static const int  UNDERRUN_DELAY_MILLISECONDS    = 5000;
         static const int  SHORT_FADE_SECONDS             = 2;
+        static const int  RANGE_SEEK_AHEAD_MILLISECONDS  = 20000;
+        static const int  DISK_CACHE_QUEUED_BUFFERS      = 4;
+        static const int  DISK_CACHE_POLL_MILLISECONDS   = 100;
+
+        static const qint64 DISK_CACHE_LENGTH_TOLERANCE_MILLISECONDS = 2000;
 
         struct RadioTitlePosition {
             qint64  microsecondsTimestamp;
@@ -122,7 +144,6 @@ class Track : public QObject, RadioTitleCallback
         TrackInfo   trackInfo;
         QStringList fadeTags;
 
-        PeakCallback::PeakCallbackInfo         peakCallbackInfo;
         DecodingCallback::DecodingCallbackInfo decodingCallbackInfo;
 
         QAudioFormat desiredPCMFormat;
@@ -147,6 +168,11 @@ class Track : public QObject, RadioTitleCallback
         Equalizer      *equalizer;
         SoundOutput    *soundOutput;
 
+        SegmentedAnalyzer *segmentedAnalyzer;
+
+        // replaced by range seeks, deleted after the buffers they had already sent
+        QVector<DecoderGeneric *> replacedDecoders;
+
         Status currentStatus;
         bool   stopping;
         bool   decodingDone;
@@ -154,13 +180,28 @@ class Track : public QObject, RadioTitleCallback
         bool   fadeoutStartedSent;
         qint64 decodingInfoLastSent;
         bool   networkStartingLastState;
+        bool   decoderFailed;
+
+        QString diskCachePath;
+        qint64  diskCacheMicroseconds;
+
+        QUrl streamUrl;
+        bool reducedBitrate;
+
+        bool      rangeSeeked;
+        qint64    rangeStartMicroseconds;
+        SeekTable seekTable;
+        qint64    compressedBytes;
+
+        bool                    analysisCached;
+        AnalysisCache::Analysis cachedAnalysis;
 
         bool          shortFadeBeginning;
         bool          shortFadeEnd;
         qint64        fadeoutStartMilliseconds;
-        FadeDirection fadeDirection;
-        qint64        fadePercent;
-        double        fadeFrameCount;
+        int           fadeSeconds;
+        int           fadeCurve;
+        Fader        *fader;
 
         qint64 decodedMillisecondsAtUnderrun;
         qint64 posMillisecondsAtUnderrun;
@@ -171,19 +212,31 @@ class Track : public QObject, RadioTitleCallback
         bool                           skipLongSilence;
         qint64                         skipLongSilenceMicroseconds;
 
-        void setupDecoder();
+        void setupDecoder(qint64 rangeStart);
         void setupCache();
         void setupAnalyzer();
         void setupEqualizer();
         void setupOutput();
 
+        QString diskCacheKey();
+        bool    isDiskCacheHit();
+        QString compressedCacheKey(QUrl url);
+        QUrl    decoderUrl(qint64 rangeStart);
+        void    chooseStreamVariant();
+        bool    loadCachedAnalysis();
+        void    startAnalysis(bool allowSegmented);
+        void    stopSegmentedAnalysis();
+
+        bool rangeSeek(qint64 microseconds);
+
         bool isDoFade();
         void updateFadeoutStartMilliseconds();
-        void applyFade(QByteArray *chunk);
 
         void changeStatus(Status status);
 
+        qint64  decodedMicroseconds();
         double  decodedPercent();
+        double  downloadPercent();
         QString equalizerSettingsPrefix();
 
 
@@ -195,6 +248,7 @@ class Track : public QObject, RadioTitleCallback
     private slots:
 
         void bufferAvailableFromDecoder(QAudioBuffer *buffer);
+        void bufferAvailableFromDiskCache(QAudioBuffer *buffer);
         void pcmChunkFromCache(QByteArray PCM, qint64 startMicroseconds);
         void pcmChunkFromEqualizer(TimedChunk chunk);
 
@@ -207,12 +261,18 @@ class Track : public QObject, RadioTitleCallback
         void decoderSessionExpired();
         void decoderNetworkStarting(bool starting);
         void decoderNetworkBufferChanged();
+        void decoderNetworkThroughput(double bytesPerSecond, double streamBytesPerSecond);
         void underrunTimeout();
 
         void cacheError(QString info, QString errorMessage);
+        void cacheGapReached(qint64 microseconds);
+        void diskCacheLoaded();
+        void requestDiskCacheBuffer();
 
+        void analyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences);
         void analyzerReplayGain(double replayGain);
         void analyzerSilences(ReplayGainCalculator::Silences silences);
+        void segmentedAnalyzerFinished(double replayGain, double peak, ReplayGainCalculator::Silences silences, qint64 lengthMilliseconds);
 
         void equalizerReplayGainChanged(double current);
 
@@ -244,6 +304,8 @@ class Track : public QObject, RadioTitleCallback
 
         void cacheRequestNextPCMChunk();
         void cacheRequestTimestampPCMChunk(long milliseconds);
+        void cacheStoreToDisk();
+        void cacheRequestDiskCacheBuffer(bool analyze);
 
         void bufferAvailableToAnalyzer();
         void requestSilencesFromAnalyzer(bool addFinalSilence);
@@ -50,14 +50,18 @@ Waver::Waver() : QObject()
 
     shuffleCountdownTimer = nullptr;
 
-    currentTrack  = nullptr;
-    previousTrack = nullptr;
+    currentTrack        = nullptr;
+    previousTrack       = nullptr;
+    crossfadeInProgress = false;
+
+    lookAheadAnalyzer = nullptr;
+    libraryScanner    = nullptr;
 
     lastPositionMilliseconds = 0;
+    preconnectedId           = "";
 
     QSettings settings;
     crossfadeTags.append(settings.value("options/crossfade_tags", DEFAULT_CROSSFADE_TAGS).toString().split(","));
-    peakFPSMax            = settings.value("options/max_peak_fps", DEFAULT_MAX_PEAK_FPS).toInt();
     peakDelayOn           = settings.value("options/peak_delay_on", DEFAULT_PEAK_DELAY_ON).toBool();
     peakDelayMilliseconds = settings.value("options/peak_delay_ms", DEFAULT_PEAK_DELAY_MS).toInt();
 
@@ -65,26 +69,12 @@ Waver::Waver() : QObject()
     shuffleServerIndex      = 0;
     shuffleFirstAfterStart  = true;
 
-    peakCallbackInfo.callbackObject = (PeakCallback *)this;
-    peakCallbackInfo.callbackMethod = (PeakCallback::PeakCallbackPointer)&Waver::peakCallback;
-    peakCallbackInfo.trackPointer   = nullptr;
-    peakCallbackInfo.peakFPS        = &peakFPS;
-    peakCallbackInfo.peakFPSMutex   = &peakFPSMutex;
-
-    peakUILagLastMS     = 0;
-    peakCallbackCount   = 0;
-    peakLagCount        = 0;
-    peakFPSNextIncrease = 0;
+    PeakRing::instance()->setReadDelay(peakDelayOn ? peakDelayMilliseconds * 1000 : 0);
 
     searchQueriesCounter    = 0;
     searchOperationsCounter = 0;
     searchResultsCounter    = 0;
 
-    peakFPSMutex.lock();
-    peakFPS           = peakFPSMax;
-    peakLagCheckCount = static_cast<int>(round(333.0 / (1000.0 / peakFPS)));
-    peakFPSMutex.unlock();
-
     decodingCallbackInfo.callbackObject = (DecodingCallback *)this;
     decodingCallbackInfo.callbackMethod = (DecodingCallback::DecodingCallbackPointer)&Waver::decodingCallback;
     decodingCallbackInfo.trackPointer   = nullptr;
@@ -120,13 +110,22 @@ Waver::~Waver()
         delete server;
     }
 
+    if (lookAheadAnalyzer != nullptr) {
+        delete lookAheadAnalyzer;
+        lookAheadAnalyzer = nullptr;
+    }
+    if (libraryScanner != nullptr) {
+        delete libraryScanner;
+        libraryScanner = nullptr;
+    }
+
     globalConstantsView->deleteLater();
 }
 
 
 void Waver::actionPlay(Track::TrackInfo trackInfo, bool allowCrossfade)
 {
-    Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+    Track *track = new Track(trackInfo, decodingCallbackInfo);
     connectTrackSignals(track);
 
     actionPlay(track, allowCrossfade);
@@ -147,6 +146,8 @@ void Waver::actionPlay(Track *track, bool allowCrossfade)
         previousTrack = currentTrack;
         currentTrack  = nullptr;
 
+        previousTrack->setMemoryRole(PCMMemoryBudget::Previous);
+
         if (!allowCrossfade || (crossfade == PlayNormal)) {
             previousTrack->setStatus(Track::Paused);
         }
@@ -270,8 +271,7 @@ void Waver::clearTrackUISignals()
     emit uiSetTrackAmpacheURL("");
     emit uiSetImage("qrc:/images/waver.png");
     emit uiSetStatusText(tr("Stopped"));
-    emit uiSetPeakMeter(0, 0, QDateTime::currentMSecsSinceEpoch() + 100);
-    emit uiSetPeakMeterReplayGain(0);
+    PeakRing::instance()->setReplayGain(0);
 }
 
 
@@ -319,6 +319,9 @@ void Waver::decodingCallback(double downloadPercent, double PCMPercent, void *tr
     for (int i = 0; i < playlist.size(); i++) {
         if (playlist.at(i) == trackPointer) {
             emit playlistDecoding(i, downloadPercent, PCMPercent);
+
+            qint64 memoryUsage = playlist.at(i)->getPCMMemoryUsage();
+            emit playlistBufferData(i, memoryUsage > 0 ? formatMemoryValue(memoryUsage) : "");
         }
     }
 }
@@ -656,7 +659,7 @@ void Waver::itemActionLocal(QString id, int action, QVariantMap extra)
             searchAction();
         }
 
-        Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+        Track *track = new Track(trackInfo, decodingCallbackInfo);
         connectTrackSignals(track);
 
         if (action == globalConstant("action_enqueue")) {
@@ -935,7 +938,7 @@ void Waver::itemActionSearchResult(QString id, int action, QVariantMap extra)
                 searchAction();
             }
 
-            Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+            Track *track = new Track(trackInfo, decodingCallbackInfo);
             connectTrackSignals(track);
 
             if (action == globalConstant("action_enqueue")) {
@@ -1355,7 +1358,7 @@ void Waver::itemActionServerItem(QString id, int action, QVariantMap extra)
                 return;
             }
 
-            Track *track = new Track(trackInfoFromIdExtra(id, extra), peakCallbackInfo, decodingCallbackInfo);
+            Track *track = new Track(trackInfoFromIdExtra(id, extra), decodingCallbackInfo);
             connectTrackSignals(track);
 
             if (action == globalConstant("action_enqueue")) {
@@ -1448,77 +1451,63 @@ void Waver::killPreviousTrack()
 }
 
 
-void Waver::nextButton()
+// next few idle tracks get analyzed before they start, remote tracks are left out because they would be downloaded twice
+void Waver::lookAheadUpdate()
 {
-    if (playlist.size() > 0) {
-        Track *track = playlist.first();
-        playlist.removeFirst();
-
-        actionPlay(track);
+    if (lookAheadAnalyzer == nullptr) {
+        return;
     }
-}
 
+    QSettings settings;
+    int       trackCount = settings.value("options/look_ahead_tracks", DEFAULT_LOOK_AHEAD_TRACKS).toInt();
 
-void Waver::pauseButton()
-{
-    if (currentTrack != nullptr) {
-        currentTrack->setStatus(Track::Paused);
-        emit notify(PlaybackStatus);
-    }
-}
+    LookAheadAnalyzer::Jobs jobs;
+    for (int i = 0; (i < playlist.count()) && (i < trackCount); i++) {
+        Track            *track     = playlist.at(i);
+        Track::TrackInfo  trackInfo = track->getTrackInfo();
 
+        if ((track->getStatus() != Track::Idle) || track->isAnalysisCached() || !trackInfo.url.isLocalFile()) {
+            continue;
+        }
 
-void Waver::peakCallback(double lPeak, double rPeak, qint64 delayMicroseconds, void *trackPointer)
-{
-    Track *track = currentTrack;
-    if (crossfadeInProgress) {
-        track = previousTrack;
-    }
+        QString key = track->analysisCacheKey();
+        if (key.isEmpty() || AnalysisCache::instance()->contains(key)) {
+            continue;
+        }
 
-    if (track != trackPointer) {
-        return;
-    }
-    if (track == nullptr) {
-        emit uiSetPeakMeter(1, 1, QDateTime::currentMSecsSinceEpoch());
-        return;
+        jobs.append({ key, trackInfo.url, trackInfo.attributes.contains("replayGain"), trackInfo.attributes.value("replayGain").toDouble() });
     }
 
-    peakCallbackCount++;
+    lookAheadAnalyzer->setJobs(jobs);
+}
 
-    qint64 delayMilliseconds = delayMicroseconds / 1000 + (peakDelayOn ? peakDelayMilliseconds : 0);
-    qint64 scheduledTime     = QDateTime::currentMSecsSinceEpoch() + delayMilliseconds;
 
-    QTimer::singleShot(delayMilliseconds, this, [this, lPeak, rPeak, scheduledTime] () {
-        emit uiSetPeakMeter(1 - lPeak, 1 - rPeak, scheduledTime);
-    });
+// spectrum and level history follow the track that's being heard, during crossfade that's the one fading out
+void Waver::meterSourceUpdate()
+{
+    Track *track = crossfadeInProgress ? previousTrack : currentTrack;
 
-    if (peakCallbackCount % peakLagCheckCount == 0) {
-        if (peakUILagLastMS > 0) {
-            peakFPSMutex.lock();
-            peakFPS             = qMax(static_cast<qint64>(1), static_cast<qint64>(round(1000.0 / (1000.0 / peakFPS + peakUILagLastMS))));
-            peakLagCheckCount   = qMax(static_cast<int>(1), static_cast<int>(round(333.0 / (1000.0 / peakFPS))));
-            peakFPSNextIncrease = peakCallbackCount + static_cast<qint64>(round(500.0 / (1000.0 / peakFPS)));
-            peakFPSMutex.unlock();
+    PeakRing::instance()->setSource(track);
+    SpectrumTap::instance()->setSource(track);
+}
 
-            peakUILagLastMS = 0;
-            peakLagCount    = 0;
 
+void Waver::nextButton()
+{
+    if (playlist.size() > 0) {
+        Track *track = playlist.first();
+        playlist.removeFirst();
 
-        }
-    }
-    if ((peakFPS < peakFPSMax) && (peakCallbackCount >= peakFPSNextIncrease)) {
-        peakFPSMutex.lock();
-        peakFPS++;
-        peakFPSNextIncrease = peakCallbackCount + static_cast<qint64>(round(150.0 / (1000.0 / peakFPS)));
-        peakFPSMutex.unlock();
+        actionPlay(track);
     }
 }
 
 
-void Waver::peakUILag(int lagMS)
+void Waver::pauseButton()
 {
-    if (lagMS > peakUILagLastMS) {
-        peakUILagLastMS = lagMS;
+    if (currentTrack != nullptr) {
+        currentTrack->setStatus(Track::Paused);
+        emit notify(PlaybackStatus);
     }
 }
 
@@ -1872,6 +1861,9 @@ void Waver::playlistUpdated()
         playlist.at(i)->requestDecodingCallback();
     }
 
+    lookAheadUpdate();
+    prefetchUpdate();
+
     if (totalMilliSeconds <= 0) {
         emit playlistTotalTime("");
     }
@@ -1903,6 +1895,32 @@ void Waver::ppButton()
 }
 
 
+// beginning of the next few remote tracks is downloaded in advance
+void Waver::prefetchUpdate()
+{
+    QSettings settings;
+    int       trackCount = settings.value("options/prefetch_tracks", DEFAULT_PREFETCH_TRACKS).toInt();
+    qint64    storeBytes = settings.value("options/prefetch_mb", DEFAULT_PREFETCH_MB).toLongLong() * 1024 * 1024;
+
+    QList<QUrl> urls;
+    for (int i = 0; (i < playlist.count()) && (urls.count() < trackCount); i++) {
+        Track::TrackInfo trackInfo = playlist.at(i)->getTrackInfo();
+
+        if (trackInfo.url.isLocalFile() || trackInfo.attributes.contains("radio_station")) {
+            continue;
+        }
+        if (playlist.at(i)->isCompressedCacheHit()) {
+            continue;
+        }
+
+        // the same variant the track will ask for when it starts
+        urls.append(AdaptiveBitrate::instance()->variantUrl(trackInfo.attributes.value("serverSettingsId").toString(), trackInfo.url));
+    }
+
+    PrefetchScheduler::instance()->setQueue(urls, storeBytes);
+}
+
+
 void Waver::previousButton(int index)
 {
     if (history.count() <= index) {
@@ -1914,7 +1932,7 @@ void Waver::previousButton(int index)
 
     int i = 0;
     while ((i < index) && (i < history.count())) {
-        Track *track = new Track(history.at(i), peakCallbackInfo, decodingCallbackInfo);
+        Track *track = new Track(history.at(i), decodingCallbackInfo);
         connectTrackSignals(track);
         playlist.prepend(track);
         i++;
@@ -2061,17 +2079,32 @@ void Waver::requestOptions()
     optionsObj.insert("starting_index_days", settings.value("options/starting_index_days", DEFAULT_STARTING_INDEX_DAYS));
     optionsObj.insert("alphabet_limit", settings.value("options/alphabet_limit", DEFAULT_ALPHABET_LIMIT));
     optionsObj.insert("font_size", settings.value("options/font_size", DEFAULT_FONT_SIZE));
-    optionsObj.insert("wide_stereo", settings.value("options/wide_stereo_delay_millisec", DEFAULT_WIDE_STEREO_DELAY_MILLISEC));
+    optionsObj.insert("wide_stereo", settings.value("options/wide_stereo_delay_millisec", DEFAULT_WIDE_STEREO_DELAY_MILLISEC).toDouble());
     optionsObj.insert("skip_long_silence", settings.value("options/skip_long_silence", DEFAULT_SKIP_LONG_SILENCE).toBool());
     optionsObj.insert("skip_long_silence_seconds", settings.value("options/skip_long_silence_seconds", DEFAULT_SKIP_LONG_SILENCE_SECONDS));
+    optionsObj.insert("pcm_disk_cache", settings.value("options/pcm_disk_cache", DEFAULT_PCM_DISK_CACHE).toBool());
+    optionsObj.insert("pcm_disk_cache_mb", settings.value("options/pcm_disk_cache_mb", DEFAULT_PCM_DISK_CACHE_MB));
+    optionsObj.insert("compressed_disk_cache", settings.value("options/compressed_disk_cache", DEFAULT_COMPRESSED_DISK_CACHE).toBool());
+    optionsObj.insert("compressed_disk_cache_mb", settings.value("options/compressed_disk_cache_mb", DEFAULT_COMPRESSED_DISK_CACHE_MB));
+    optionsObj.insert("r128_loudness", settings.value("options/r128_loudness", DEFAULT_R128_LOUDNESS).toBool());
+    optionsObj.insert("look_ahead_tracks", settings.value("options/look_ahead_tracks", DEFAULT_LOOK_AHEAD_TRACKS));
+    optionsObj.insert("look_ahead_cpu_percent", settings.value("options/look_ahead_cpu_percent", DEFAULT_LOOK_AHEAD_CPU_PERCENT));
+    optionsObj.insert("library_scan", settings.value("options/library_scan", DEFAULT_LIBRARY_SCAN).toBool());
+    optionsObj.insert("segmented_analysis", settings.value("options/segmented_analysis", DEFAULT_SEGMENTED_ANALYSIS).toBool());
+    optionsObj.insert("http2", settings.value("options/http2", DEFAULT_HTTP2).toBool());
+    optionsObj.insert("prefetch_tracks", settings.value("options/prefetch_tracks", DEFAULT_PREFETCH_TRACKS));
+    optionsObj.insert("prefetch_mb", settings.value("options/prefetch_mb", DEFAULT_PREFETCH_MB));
+    optionsObj.insert("adaptive_bitrate", settings.value("options/adaptive_bitrate", DEFAULT_ADAPTIVE_BITRATE).toBool());
+    optionsObj.insert("download_connections", settings.value("options/download_connections", DEFAULT_DOWNLOAD_CONNECTIONS));
 
     optionsObj.insert("fade_tags", settings.value("options/fade_tags", DEFAULT_FADE_TAGS));
     optionsObj.insert("crossfade_tags", settings.value("options/crossfade_tags", DEFAULT_CROSSFADE_TAGS));
     optionsObj.insert("fade_seconds", settings.value("options/fade_seconds", DEFAULT_FADE_SECONDS).toInt());
+    optionsObj.insert("fade_curve", settings.value("options/fade_curve", DEFAULT_FADE_CURVE).toInt());
 
-    optionsObj.insert("max_peak_fps", settings.value("options/max_peak_fps", DEFAULT_MAX_PEAK_FPS));
     optionsObj.insert("peak_delay_on", settings.value("options/peak_delay_on", DEFAULT_PEAK_DELAY_ON).toBool());
     optionsObj.insert("peak_delay_ms", settings.value("options/peak_delay_ms", DEFAULT_PEAK_DELAY_MS));
+    optionsObj.insert("spectrum_bands", settings.value("options/spectrum_bands", DEFAULT_SPECTRUM_BANDS));
 
     QVariantList genres;
     QStringList  added;
@@ -2118,6 +2151,8 @@ void Waver::run()
     shuffleCountdownTimer->setInterval(1000);
     connect(shuffleCountdownTimer, &QTimer::timeout, this, &Waver::shuffleCountdown);
 
+    lookAheadAnalyzer = new LookAheadAnalyzer();
+
     emit explorerAddItem(QString("%1A").arg(UI_ID_PREFIX_SEARCH), QVariant::fromValue(nullptr), tr("Search"), "qrc:/icons/search.ico", QVariantMap({}), false, false, false, false);
 
 
@@ -2142,6 +2177,11 @@ void Waver::run()
         emit explorerAddItem(id, QVariant::fromValue(nullptr), QFileInfo(localDirs.at(i)).baseName(), "qrc:/icons/local.ico", QVariantMap({{ "path", path }}), true, false, false, false);
     }
 
+    libraryScanner = new LibraryScanner();
+    if (settings.value("options/library_scan", DEFAULT_LIBRARY_SCAN).toBool()) {
+        libraryScanner->start(localDirs);
+    }
+
     // servers
 
     int serversSize = settings.beginReadArray("servers");
@@ -2629,7 +2669,7 @@ void Waver::serverOperationFinished(AmpacheServer::OpCode opCode, AmpacheServer:
                 }
                 else {
                     if (!playlistContains(newId)) {
-                        Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+                        Track *track = new Track(trackInfo, decodingCallbackInfo);
                         connectTrackSignals(track);
 
                         if (originalAction.compare("action_enqueue") == 0) {
@@ -2704,7 +2744,7 @@ void Waver::serverOperationFinished(AmpacheServer::OpCode opCode, AmpacheServer:
                     }
                     else {
                         if (!playlistContains(newId)) {
-                            Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+                            Track *track = new Track(trackInfo, decodingCallbackInfo);
                             connectTrackSignals(track);
 
                             if (originalAction.compare("action_enqueue") == 0) {
@@ -2774,7 +2814,7 @@ void Waver::serverOperationFinished(AmpacheServer::OpCode opCode, AmpacheServer:
                                 trackInfo.attributes.insert("server_playlist_index", opData.value("server_playlist_index"));
                             }
 
-                            Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+                            Track *track = new Track(trackInfo, decodingCallbackInfo);
                             connectTrackSignals(track);
                             playlist.replace(i, track);
                         }
@@ -2917,7 +2957,7 @@ void Waver::serverOperationFinished(AmpacheServer::OpCode opCode, AmpacheServer:
                         actionPlay(trackInfo);
                     }
                     else {
-                        Track *track = new Track(trackInfo, peakCallbackInfo, decodingCallbackInfo);
+                        Track *track = new Track(trackInfo, decodingCallbackInfo);
                         connectTrackSignals(track);
                         playlist.append(track);
                     }
@@ -3007,6 +3047,13 @@ void Waver::shutdown()
     stopByShutdown = true;
     stopButton();
 
+    if (lookAheadAnalyzer != nullptr) {
+        lookAheadAnalyzer->setJobs({});
+    }
+    if (libraryScanner != nullptr) {
+        libraryScanner->stop();
+    }
+
     shutdownMutex.lock();
     shutdownCompleted = true;
     shutdownMutex.unlock();
@@ -3032,6 +3079,7 @@ void Waver::startNextTrack()
 
     if (isCrossfade(previousTrack, currentTrack) != PlayNormal) {
         crossfadeInProgress = true;
+        meterSourceUpdate();
         QTimer::singleShot(currentTrack->getFadeDurationSeconds(Track::FadeDirectionOut) * 1000 / 2, this, &Waver::startNextTrackUISignals);
     }
     else {
@@ -3047,6 +3095,7 @@ void Waver::startNextTrackUISignals()
     }
 
     crossfadeInProgress = false;
+    meterSourceUpdate();
 
     Track::TrackInfo trackInfo = getCurrentTrackInfo();
 
@@ -3246,6 +3295,9 @@ void Waver::trackFadeoutStarted(QString id)
 
         previousTrack = currentTrack;
         currentTrack  = nullptr;
+
+        previousTrack->setMemoryRole(PCMMemoryBudget::Previous);
+
         startNextTrack();
     }
 }
@@ -3362,6 +3414,21 @@ Track::TrackInfo Waver::trackInfoFromFilePath(QString filePath)
         trackInfo.attributes.insert("lengthMilliseconds", fileRef.audioProperties()->lengthInMilliseconds());
     }
 
+    // track gain is preferred, album gain is used only if there's no track gain
+    if (!fileRef.isNull()) {
+        TagLib::PropertyMap properties = fileRef.file()->properties();
+        foreach (QString replayGainKey, QStringList({ "REPLAYGAIN_TRACK_GAIN", "REPLAYGAIN_ALBUM_GAIN" })) {
+            if (properties.contains(QStringToTString(replayGainKey)) && !properties[QStringToTString(replayGainKey)].isEmpty()) {
+                bool   OK         = false;
+                double replayGain = TStringToQString(properties[QStringToTString(replayGainKey)].front()).remove(QRegExp("\\s*dB\\s*$", Qt::CaseInsensitive)).trimmed().toDouble(&OK);
+                if (OK) {
+                    trackInfo.attributes.insert("replayGain", replayGain);
+                    break;
+                }
+            }
+        }
+    }
+
 #endif
 
     if (trackInfo.title.isEmpty() || trackInfo.artist.isEmpty() || trackInfo.album.isEmpty()) {
@@ -3432,6 +3499,15 @@ Track::TrackInfo Waver::trackInfoFromIdExtra(QString id, QVariantMap extra)
         trackInfo.attributes.insert("flag", "true");
     }
 
+    // servers without replay gain data send zero
+    foreach (QString replayGainKey, QStringList({ "replaygain_track_gain", "replaygain_album_gain" })) {
+        double replayGain = extra.value(replayGainKey, 0).toDouble(&OK);
+        if (OK && (replayGain != 0)) {
+            trackInfo.attributes.insert("replayGain", replayGain);
+            break;
+        }
+    }
+
     int srvIndex = serverIndex(id.split("|").last());
     if (srvIndex >= 0) {
         trackInfo.attributes.insert("serverSettingsId", servers.at(srvIndex)->getSettingsId().toString());
@@ -3485,8 +3561,15 @@ void Waver::trackPlayPosition(QString id, bool decoderFinished, long knownDurati
 
     emit uiSetTrackPosition(QDateTime::fromMSecsSinceEpoch(positionMilliseconds).toUTC().toString("hh:mm:ss"), positionPercent);
 
+    // the next track's server gets a warm connection shortly before its decoding starts
+    if ((track == currentTrack) && (knownDurationMilliseconds > 0) && (playlist.size() > 0) && (playlist.at(0)->getStatus() == Track::Idle) && (playlist.at(0)->getTrackInfo().id.compare(preconnectedId) != 0) && (knownDurationMilliseconds - positionMilliseconds <= 20000 + PRECONNECT_AHEAD_MILLISEC + playlist.at(0)->getFadeDurationSeconds(Track::FadeDirectionIn) * 1000)) {
+        preconnectedId = playlist.at(0)->getTrackInfo().id;
+        NetworkPool::instance()->preconnect(playlist.at(0)->getTrackInfo().url);
+    }
+
     if ((track == currentTrack) && (knownDurationMilliseconds > 0) && (playlist.size() > 0) && (playlist.at(0)->getStatus() == Track::Idle) && (knownDurationMilliseconds - positionMilliseconds <= 20000 + playlist.at(0)->getFadeDurationSeconds(Track::FadeDirectionIn) * 1000)) {
         playlist.at(0)->setStatus(Track::Decoding);
+        lookAheadUpdate();
     }
 
     if (autoRefresh && (autoRefreshLastDay != QDateTime::currentDateTime().date().day()) && (QDateTime::currentMSecsSinceEpoch() >= autoRefreshLastActionTimestamp + AUTO_REFRESH_NO_ACTION_DELAY_MILLISEC)) {
@@ -3509,7 +3592,7 @@ void Waver::trackReplayGainInfo(QString id, double current)
         if (current > 6) {
             current = 6;
         }
-        emit uiSetPeakMeterReplayGain((current + 12) / 18);
+        PeakRing::instance()->setReplayGain((current + 12) / 18);
     }
 }
 
@@ -3585,7 +3668,6 @@ void Waver::updatedOptions(QString optionsJSON)
         server->setShuffleTags(genres);
     }
 
-    peakFPSMax            = options.value("max_peak_fps").toInt();
     peakDelayOn           = options.value("peak_delay_on").toBool();
     peakDelayMilliseconds = options.value("peak_delay_ms").toInt();
     autoRefresh           = options.value("auto_refresh").toBool();
@@ -3615,13 +3697,14 @@ void Waver::updatedOptions(QString optionsJSON)
     settings.setValue("options/search_action_filter", options.value("search_action_filter").toInt());
     settings.setValue("options/search_action_count_max", options.value("search_action_count_max").toInt());
 
-    settings.setValue("options/max_peak_fps", peakFPSMax);
     settings.setValue("options/peak_delay_on", peakDelayOn);
     settings.setValue("options/peak_delay_ms", peakDelayMilliseconds);
+    settings.setValue("options/spectrum_bands", options.value("spectrum_bands").toInt());
 
     settings.setValue("options/fade_tags", options.value("fade_tags").toString());
     settings.setValue("options/crossfade_tags", options.value("crossfade_tags").toString());
     settings.setValue("options/fade_seconds", options.value("fade_seconds").toInt());
+    settings.setValue("options/fade_curve", options.value("fade_curve").toInt());
     settings.setValue("options/starting_index_apply", options.value("starting_index_apply").toBool());
     settings.setValue("options/starting_index_days", options.value("starting_index_days").toLongLong());
     settings.setValue("options/auto_refresh", options.value("auto_refresh").toBool());
@@ -3629,9 +3712,33 @@ void Waver::updatedOptions(QString optionsJSON)
     settings.setValue("options/title_curly_special", options.value("title_curly_special").toBool());
     settings.setValue("options/alphabet_limit", options.value("alphabet_limit").toInt());
     settings.setValue("options/font_size", options.value("font_size").toInt());
-    settings.setValue("options/wide_stereo_delay_millisec", options.value("wide_stereo").toInt());
+    settings.setValue("options/wide_stereo_delay_millisec", options.value("wide_stereo").toDouble());
     settings.setValue("options/skip_long_silence", options.value("skip_long_silence").toBool());
     settings.setValue("options/skip_long_silence_seconds", options.value("skip_long_silence_seconds").toInt());
+    settings.setValue("options/pcm_disk_cache", options.value("pcm_disk_cache").toBool());
+    settings.setValue("options/pcm_disk_cache_mb", options.value("pcm_disk_cache_mb").toInt());
+    settings.setValue("options/compressed_disk_cache", options.value("compressed_disk_cache").toBool());
+    settings.setValue("options/compressed_disk_cache_mb", options.value("compressed_disk_cache_mb").toInt());
+    settings.setValue("options/r128_loudness", options.value("r128_loudness").toBool());
+    settings.setValue("options/look_ahead_tracks", options.value("look_ahead_tracks").toInt());
+    settings.setValue("options/look_ahead_cpu_percent", options.value("look_ahead_cpu_percent").toInt());
+
+    if ((libraryScanner != nullptr) && (options.value("library_scan").toBool() != settings.value("options/library_scan", DEFAULT_LIBRARY_SCAN).toBool())) {
+        if (options.value("library_scan").toBool()) {
+            libraryScanner->start(localDirs);
+        }
+        else {
+            libraryScanner->stop();
+        }
+    }
+    settings.setValue("options/library_scan", options.value("library_scan").toBool());
+    settings.setValue("options/segmented_analysis", options.value("segmented_analysis").toBool());
+    settings.setValue("options/http2", options.value("http2").toBool());
+    settings.setValue("options/prefetch_tracks", options.value("prefetch_tracks").toInt());
+    settings.setValue("options/prefetch_mb", options.value("prefetch_mb").toInt());
+    settings.setValue("options/adaptive_bitrate", options.value("adaptive_bitrate").toBool());
+    settings.setValue("options/download_connections", options.value("download_connections").toInt());
+    prefetchUpdate();
 
     if (!options.value("eq_disable").toBool()) {
         settings.setValue("eq/on",  options.value("eq_on").toBool());
@@ -3700,11 +3807,7 @@ void Waver::updatedOptions(QString optionsJSON)
         }
     }
 
-    if (peakFPS > peakFPSMax) {
-        peakFPSMutex.lock();
-        peakFPS = peakFPSMax;
-        peakFPSMutex.unlock();
-    }
+    PeakRing::instance()->setReadDelay(peakDelayOn ? peakDelayMilliseconds * 1000 : 0);
 
     if (currentTrack != nullptr) {
         currentTrack->optionsUpdated();
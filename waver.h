@@ -49,15 +49,21 @@
     #include <QDebug>
 #endif
 
+#include "adaptivebitrate.h"
 #include "ampacheserver.h"
 #include "decodingcallback.h"
 #include "filescanner.h"
 #include "filesearcher.h"
-#include "peakcallback.h"
+#include "libraryscanner.h"
+#include "lookaheadanalyzer.h"
+#include "networkpool.h"
+#include "peakring.h"
+#include "prefetchscheduler.h"
+#include "spectrumtap.h"
 #include "track.h"
 
 
-class Waver : public QObject, PeakCallback, DecodingCallback
+class Waver : public QObject, DecodingCallback
 {
     Q_OBJECT
 
@@ -71,7 +77,6 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         long             getLastPositionMilliseconds();
         bool             isShutdownCompleted();
 
-        void peakCallback(double lPeak, double rPeak, qint64 delayMicroseconds, void *trackPointer);
         void decodingCallback(double downloadPercent, double PCMPercent, void *trackPointer);
 
 
@@ -128,6 +133,8 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         static const int SEARCH_TARGET_SONGS = 0;
         static const int SEARCH_TARGET_REST  = 1;
 
+        static const int PRECONNECT_AHEAD_MILLISEC = 10000;
+
         static const int AUTO_REFRESH_NO_ACTION_DELAY_MILLISEC = 60 * 1000;
         static const int AUTO_REFRESH_BROWSE                   = 0;
         static const int AUTO_REFRESH_PLAYLISTS                = 1;
@@ -156,17 +163,8 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         QQuickView *globalConstantsView;
         QObject    *globalConstants;
 
-        PeakCallbackInfo peakCallbackInfo;
-        qint64           peakCallbackCount;
-        qint64           peakFPS;
-        QMutex           peakFPSMutex;
-        qint64           peakFPSMax;
-        int              peakUILagLastMS;
-        int              peakLagCheckCount;
-        qint64           peakLagCount;
-        qint64           peakFPSNextIncrease;
-        bool             peakDelayOn;
-        qint64           peakDelayMilliseconds;
+        bool   peakDelayOn;
+        qint64 peakDelayMilliseconds;
 
         DecodingCallbackInfo decodingCallbackInfo;
 
@@ -177,6 +175,10 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         long                     lastPositionMilliseconds;
         QStringList              crossfadeTags;
         bool                     crossfadeInProgress;
+        QString                  preconnectedId;
+
+        LookAheadAnalyzer *lookAheadAnalyzer;
+        LibraryScanner    *libraryScanner;
 
         QTimer *shuffleCountdownTimer;
         double  shuffleCountdownPercent;
@@ -226,6 +228,9 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         void          connectTrackSignals(Track *track, bool newConnect = true);
         CrossfadeMode isCrossfade(Track *track1, Track *track2);
         void          killPreviousTrack();
+        void          lookAheadUpdate();
+        void          meterSourceUpdate();
+        void          prefetchUpdate();
 
         void startShuffleCountdown();
         void stopShuffleCountdown();
@@ -287,8 +292,6 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         void updatedOptions(QString optionsJSON);
         void requestEQ(int eqChooser);
 
-        void peakUILag(int lagMS);
-
         void shutdown();
 
 
@@ -337,8 +340,6 @@ class Waver : public QObject, PeakCallback, DecodingCallback
         void uiSetTrackDecoding(QVariant downloadPercent, QVariant pcmPercent);
         void uiSetTrackTags(QVariant tagsText);
         void uiSetTrackAmpacheURL(QVariant ampacheURL);
-        void uiSetPeakMeter(QVariant leftPercent, QVariant rightPercent, QVariant scheduledTimeMS);
-        void uiSetPeakMeterReplayGain(QVariant gainPercent);
         void uiSetShuffleCountdown(QVariant percent);
         void uiSetFontSize(QVariant fontSize);
 
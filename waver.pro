@@ -11,55 +11,98 @@ CONFIG += c++11
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x051210
 
 HEADERS += \
+    adaptivebitrate.h \
     ampacheserver.h \
+    analysiscache.h \
     analyzer.h \
+    blockmeter.h \
+    chunkrope.h \
     coefficientlist.h \
     decodergeneric.h \
     decodergenericnetworksource.h \
     decodingcallback.h \
+    diskcache.h \
     equalizer.h \
+    fader.h \
     filescanner.h \
     filesearcher.h \
     globals.h \
+    icydemuxer.h \
     iirfilter.h \
     iirfiltercallback.h \
     iirfilterchain.h \
+    libraryscanner.h \
+    lookaheadanalyzer.h \
+    loudnesscalculator.h \
+    networkpool.h \
     notificationshandler.h \
     outputfeeder.h \
     pcmcache.h \
-    peakcallback.h \
+    pcmmemorybudget.h \
+    peakreader.h \
+    peakring.h \
+    prefetchscheduler.h \
     radiotitlecallback.h \
     replaygaincoefficients.h \
     replaygaincalculator.h \
+    seektable.h \
+    segmentedanalyzer.h \
+    segmentsource.h \
+    silencescanner.h \
+    simd.h \
     soundoutput.h \
+    spectrumanalyzer.h \
+    spectrumtap.h \
     track.h \
     waver.h \
-    waverapplication.h
+    waverapplication.h \
+    widestereodelay.h
 
 SOURCES += \
+    adaptivebitrate.cpp \
     ampacheserver.cpp \
+    analysiscache.cpp \
     analyzer.cpp \
+    blockmeter.cpp \
+    chunkrope.cpp \
     coefficientlist.cpp \
     decodergeneric.cpp \
     decodergenericnetworksource.cpp \
     decodingcallback.cpp \
+    diskcache.cpp \
     equalizer.cpp \
+    fader.cpp \
     filescanner.cpp \
     filesearcher.cpp \
+    icydemuxer.cpp \
     iirfilter.cpp \
     iirfiltercallback.cpp \
     iirfilterchain.cpp \
+    libraryscanner.cpp \
+    lookaheadanalyzer.cpp \
+    loudnesscalculator.cpp \
+    networkpool.cpp \
     main.cpp \
     notificationshandler.cpp \
     outputfeeder.cpp \
     pcmcache.cpp \
-    peakcallback.cpp \
+    pcmmemorybudget.cpp \
+    peakreader.cpp \
+    peakring.cpp \
+    prefetchscheduler.cpp \
     radiotitlecallback.cpp \
     replaygaincalculator.cpp \
+    seektable.cpp \
+    segmentedanalyzer.cpp \
+    segmentsource.cpp \
+    silencescanner.cpp \
     soundoutput.cpp \
+    spectrumanalyzer.cpp \
+    spectrumtap.cpp \
     track.cpp \
     waver.cpp \
-    waverapplication.cpp
+    waverapplication.cpp \
+    widestereodelay.cpp
 
 RESOURCES += \
     res.qrc
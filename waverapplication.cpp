@@ -10,8 +10,11 @@ WaverApplication::WaverApplication(int &argc, char **argv) : QGuiApplication(arg
 {
     qRegisterMetaType<TimedChunk>("TimedChunk");
 
-    waverThread = nullptr;
-    waver       = nullptr;
+    waverThread      = nullptr;
+    waver            = nullptr;
+    spectrumThread   = nullptr;
+    spectrumAnalyzer = nullptr;
+    peakReader       = nullptr;
 
     setOrganizationName("4phun");
     setOrganizationDomain("pppphun.com");
@@ -46,6 +49,12 @@ WaverApplication::~WaverApplication()
         waverThread->wait();
         waverThread->deleteLater();
     }
+
+    if (spectrumThread != nullptr) {
+        spectrumThread->quit();
+        spectrumThread->wait();
+        spectrumThread->deleteLater();
+    }
 }
 
 
@@ -62,6 +71,21 @@ void WaverApplication::setQmlApplicationEngine(QQmlApplicationEngine *qmlApplica
     QObject::connect(waverThread, &QThread::started, waver, &Waver::run);
     QObject::connect(waverThread, &QThread::finished, waver, &Waver::deleteLater);
 
+    spectrumThread   = new QThread();
+    spectrumAnalyzer = new SpectrumAnalyzer();
+
+    spectrumThread->setObjectName("spectrumThread");
+    spectrumAnalyzer->moveToThread(spectrumThread);
+
+    QObject::connect(spectrumThread, &QThread::started, spectrumAnalyzer, &SpectrumAnalyzer::run);
+    QObject::connect(spectrumThread, &QThread::finished, spectrumAnalyzer, &SpectrumAnalyzer::deleteLater);
+
+    peakReader = new PeakReader(this);
+
+    // polled by the peak meter and the spectrum view at display rate
+    this->qmlApplicationEngine->rootContext()->setContextProperty("peakReader", peakReader);
+    this->qmlApplicationEngine->rootContext()->setContextProperty("spectrumAnalyzer", spectrumAnalyzer);
+
     QQuickWindow *uiMainWindow = qobject_cast<QQuickWindow *>(this->qmlApplicationEngine->rootObjects().at(0));
 
     QObject::connect(waver, SIGNAL(explorerAddItem(QVariant,QVariant,QVariant,QVariant,QVariant,QVariant,QVariant,QVariant,QVariant)), uiMainWindow, SLOT(explorerAddItem(QVariant,QVariant,QVariant,QVariant,QVariant,QVariant,QVariant,QVariant,QVariant)));
@@ -81,8 +105,6 @@ void WaverApplication::setQmlApplicationEngine(QQmlApplicationEngine *qmlApplica
     QObject::connect(waver, SIGNAL(uiSetTempImage(QVariant)), uiMainWindow, SLOT(setTempImage(QVariant)));
     QObject::connect(waver, SIGNAL(uiSetStatusText(QVariant)), uiMainWindow, SLOT(setStatusText(QVariant)));
     QObject::connect(waver, SIGNAL(uiSetStatusTempText(QVariant)), uiMainWindow, SLOT(setStatusTempText(QVariant)));
-    QObject::connect(waver, SIGNAL(uiSetPeakMeter(QVariant,QVariant,QVariant)), uiMainWindow, SLOT(setPeakMeter(QVariant,QVariant,QVariant)));
-    QObject::connect(waver, SIGNAL(uiSetPeakMeterReplayGain(QVariant)), uiMainWindow, SLOT(setPeakMeterReplayGain(QVariant)));
     QObject::connect(waver, SIGNAL(uiSetShuffleCountdown(QVariant)), uiMainWindow, SLOT(setShuffleCountdown(QVariant)));
     QObject::connect(waver, SIGNAL(uiSetFavorite(QVariant)), uiMainWindow, SLOT(setFavorite(QVariant)));
     QObject::connect(waver, SIGNAL(uiShowSearchCriteria()), uiMainWindow, SLOT(showSearchCriteria()));
@@ -103,6 +125,7 @@ void WaverApplication::setQmlApplicationEngine(QQmlApplicationEngine *qmlApplica
     QObject::connect(waver, SIGNAL(playlistBusy(QVariant,QVariant)), uiMainWindow, SLOT(playlistBusy(QVariant,QVariant)));
     QObject::connect(waver, SIGNAL(playlistDecoding(QVariant,QVariant,QVariant)), uiMainWindow, SLOT(playlistDecoding(QVariant,QVariant,QVariant)));
     QObject::connect(waver, SIGNAL(playlistBigBusy(QVariant)), uiMainWindow, SLOT(playlistBigBusy(QVariant)));
+    QObject::connect(waver, SIGNAL(playlistBufferData(QVariant,QVariant)), uiMainWindow, SLOT(playlistBufferData(QVariant,QVariant)));
     QObject::connect(waver, SIGNAL(playlistTotalTime(QVariant)), uiMainWindow, SLOT(playlistTotalTime(QVariant)));
     QObject::connect(waver, SIGNAL(playlistSelected(QVariant,QVariant)), uiMainWindow, SLOT(playlistSelected(QVariant,QVariant)));
 
@@ -136,7 +159,6 @@ void WaverApplication::setQmlApplicationEngine(QQmlApplicationEngine *qmlApplica
     QObject::connect(waver,        SIGNAL(uiHistoryRemove(QVariant)),     uiMainWindow, SLOT(historyRemove(QVariant)));
     QObject::connect(waver,        SIGNAL(uiRaise()),                     uiMainWindow, SLOT(bringToFront()));
     QObject::connect(waver,        SIGNAL(uiSetIsSnap(QVariant)),         uiMainWindow, SLOT(quickStartGuideSetIsSnap(QVariant)));
-    QObject::connect(uiMainWindow, SIGNAL(peakUILag(int)),                waver,        SLOT(peakUILag(int)));
     QObject::connect(uiMainWindow, SIGNAL(saveGeometry(int,int,int,int)), this,         SLOT(uiSaveGeometry(int,int,int,int)));
 
     QObject::connect(waver,        SIGNAL(explorerGetSearchResult(QVariant,QVariant)), uiMainWindow, SLOT(explorerGetSearchResult(QVariant,QVariant)));
@@ -150,6 +172,7 @@ void WaverApplication::setQmlApplicationEngine(QQmlApplicationEngine *qmlApplica
     notificationsHandler = new NotificationsHandler(waver);
 
     waverThread->start();
+    spectrumThread->start();
 }
 
 
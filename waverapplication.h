@@ -10,6 +10,7 @@
 #include <QGuiApplication>
 #include <QIcon>
 #include <QQmlApplicationEngine>
+#include <QQmlContext>
 #include <QQuickStyle>
 #include <QQuickWindow>
 #include <QSettings>
@@ -19,6 +20,8 @@
 
 #include "globals.h"
 #include "notificationshandler.h"
+#include "peakreader.h"
+#include "spectrumanalyzer.h"
 #include "waver.h"
 
 
@@ -45,6 +48,10 @@ class WaverApplication : public QGuiApplication
         QThread *waverThread;
         Waver   *waver;
 
+        QThread          *spectrumThread;
+        SpectrumAnalyzer *spectrumAnalyzer;
+        PeakReader       *peakReader;
+
         NotificationsHandler *notificationsHandler;
 
 
@@ -0,0 +1,219 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#include "widestereodelay.h"
+
+
+WideStereoDelay::WideStereoDelay(QAudioFormat format, double maxDelayMillisec)
+{
+    this->format = format;
+
+    channelCount  = format.channelCount();
+    sampleBytes   = qMax(format.sampleSize() / 8, 1);
+    bytesPerFrame = qMax(format.bytesPerFrame(), 1);
+
+    maxDelayFrames = qCeil(maxDelayMillisec * format.sampleRate() / 1000);
+    ringFrames     = maxDelayFrames + CHUNK_FRAMES;
+    ringPosition   = 0;
+
+    ring.resize(ringFrames * sampleBytes);
+    rightChannel.resize(CHUNK_FRAMES * sampleBytes);
+    delayed.resize(CHUNK_FRAMES * sampleBytes);
+    fadingFrom.resize(CHUNK_FRAMES * sampleBytes);
+
+    delayFrames         = 0;
+    pendingDelayFrames  = 0;
+    previousDelayFrames = 0;
+    crossfadeFrames     = qMax(format.framesForDuration(CROSSFADE_MICROSECONDS), 1);
+    crossfadeRemaining  = 0;
+
+    clear();
+}
+
+
+// for example after pause, so old audio doesn't come back on the right channel
+void WideStereoDelay::clear()
+{
+    ring.fill(0);
+    ringPosition       = 0;
+    crossfadeRemaining = 0;
+
+    // unsigned formats are silent in the middle of their range
+    if ((format.sampleType() == QAudioFormat::UnSignedInt) && (sampleBytes == 1)) {
+        ring.fill(static_cast<char>(0x80));
+    }
+    else if (format.sampleType() == QAudioFormat::UnSignedInt) {
+        for (int frame = 0; frame < ringFrames; frame++) {
+            char *sample = ring.data() + frame * sampleBytes;
+            if (format.byteOrder() == QAudioFormat::LittleEndian) {
+                sample[sampleBytes - 1] = static_cast<char>(0x80);
+            }
+            else {
+                sample[0] = static_cast<char>(0x80);
+            }
+        }
+    }
+}
+
+
+void WideStereoDelay::crossfade(char *to, const char *from, int frameCount)
+{
+    if (format.sampleType() == QAudioFormat::SignedInt) {
+        switch (sampleBytes) {
+            case 1:
+                crossfade<qint8>(reinterpret_cast<qint8 *>(to), reinterpret_cast<const qint8 *>(from), frameCount);
+                return;
+            case 2:
+                crossfade<qint16>(reinterpret_cast<qint16 *>(to), reinterpret_cast<const qint16 *>(from), frameCount);
+                return;
+            case 4:
+                crossfade<qint32>(reinterpret_cast<qint32 *>(to), reinterpret_cast<const qint32 *>(from), frameCount);
+                return;
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::UnSignedInt) {
+        switch (sampleBytes) {
+            case 1:
+                crossfade<quint8>(reinterpret_cast<quint8 *>(to), reinterpret_cast<const quint8 *>(from), frameCount);
+                return;
+            case 2:
+                crossfade<quint16>(reinterpret_cast<quint16 *>(to), reinterpret_cast<const quint16 *>(from), frameCount);
+                return;
+            case 4:
+                crossfade<quint32>(reinterpret_cast<quint32 *>(to), reinterpret_cast<const quint32 *>(from), frameCount);
+                return;
+        }
+    }
+    else if (format.sampleType() == QAudioFormat::Float) {
+        crossfade<float>(reinterpret_cast<float *>(to), reinterpret_cast<const float *>(from), frameCount);
+        return;
+    }
+
+    // unknown format, switch without fading
+    crossfadeRemaining = 0;
+}
+
+
+void WideStereoDelay::deinterleave(const char *frames, char *right, int frameCount)
+{
+    switch (sampleBytes) {
+        case 1:
+            deinterleave<quint8>(reinterpret_cast<const quint8 *>(frames), reinterpret_cast<quint8 *>(right), frameCount);
+            break;
+        case 2:
+            deinterleave<quint16>(reinterpret_cast<const quint16 *>(frames), reinterpret_cast<quint16 *>(right), frameCount);
+            break;
+        case 4:
+            deinterleave<quint32>(reinterpret_cast<const quint32 *>(frames), reinterpret_cast<quint32 *>(right), frameCount);
+            break;
+        default:
+            for (int frame = 0; frame < frameCount; frame++) {
+                memcpy(right + frame * sampleBytes, frames + frame * bytesPerFrame + sampleBytes, sampleBytes);
+            }
+    }
+}
+
+
+void WideStereoDelay::interleave(const char *right, char *frames, int frameCount)
+{
+    switch (sampleBytes) {
+        case 1:
+            interleave<quint8>(reinterpret_cast<const quint8 *>(right), reinterpret_cast<quint8 *>(frames), frameCount);
+            break;
+        case 2:
+            interleave<quint16>(reinterpret_cast<const quint16 *>(right), reinterpret_cast<quint16 *>(frames), frameCount);
+            break;
+        case 4:
+            interleave<quint32>(reinterpret_cast<const quint32 *>(right), reinterpret_cast<quint32 *>(frames), frameCount);
+            break;
+        default:
+            for (int frame = 0; frame < frameCount; frame++) {
+                memcpy(frames + frame * bytesPerFrame + sampleBytes, right + frame * sampleBytes, sampleBytes);
+            }
+    }
+}
+
+
+void WideStereoDelay::process(char *data, int frameCount)
+{
+    if (channelCount < 2) {
+        return;
+    }
+
+    int done = 0;
+    while (done < frameCount) {
+        int   chunkFrames = qMin(CHUNK_FRAMES, frameCount - done);
+        char *frames      = data + done * bytesPerFrame;
+
+        startPendingDelay();
+
+        // the ring is kept up to date even without delay, so a new delay can fade in from real audio
+        deinterleave(frames, rightChannel.data(), chunkFrames);
+        ringWrite(rightChannel.constData(), chunkFrames);
+
+        if ((delayFrames > 0) || (crossfadeRemaining > 0)) {
+            ringRead(delayed.data(), chunkFrames, delayFrames);
+            if (crossfadeRemaining > 0) {
+                ringRead(fadingFrom.data(), chunkFrames, previousDelayFrames);
+                crossfade(delayed.data(), fadingFrom.constData(), chunkFrames);
+            }
+            interleave(delayed.constData(), frames, chunkFrames);
+        }
+
+        done += chunkFrames;
+    }
+}
+
+
+// the chunk that ends the given number of frames before the last written one
+void WideStereoDelay::ringRead(char *destination, int frameCount, int delayFrames)
+{
+    int start = ringPosition - frameCount - delayFrames;
+    while (start < 0) {
+        start += ringFrames;
+    }
+
+    int firstPart = qMin(frameCount, ringFrames - start);
+
+    memcpy(destination, ring.constData() + start * sampleBytes, firstPart * sampleBytes);
+    if (firstPart < frameCount) {
+        memcpy(destination + firstPart * sampleBytes, ring.constData(), (frameCount - firstPart) * sampleBytes);
+    }
+}
+
+
+void WideStereoDelay::ringWrite(const char *source, int frameCount)
+{
+    int firstPart = qMin(frameCount, ringFrames - ringPosition);
+
+    memcpy(ring.data() + ringPosition * sampleBytes, source, firstPart * sampleBytes);
+    if (firstPart < frameCount) {
+        memcpy(ring.data(), source + firstPart * sampleBytes, (frameCount - firstPart) * sampleBytes);
+    }
+
+    ringPosition = (ringPosition + frameCount) % ringFrames;
+}
+
+
+// fractions of a millisecond are kept, rounded to the nearest frame
+void WideStereoDelay::setDelayMillisec(double delayMillisec)
+{
+    pendingDelayFrames = qBound(0, qRound(delayMillisec * format.sampleRate() / 1000), maxDelayFrames);
+}
+
+
+// once a crossfade is over only the current delay is heard, the next one can start at any chunk boundary
+void WideStereoDelay::startPendingDelay()
+{
+    if ((crossfadeRemaining > 0) || (pendingDelayFrames == delayFrames)) {
+        return;
+    }
+
+    previousDelayFrames = delayFrames;
+    delayFrames         = pendingDelayFrames;
+    crossfadeRemaining  = crossfadeFrames;
+}
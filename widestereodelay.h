@@ -0,0 +1,97 @@
+/*
+    This file is part of Waver
+    Copyright (C) 2021 Peter Papp
+    Please visit https://launchpad.net/waver for details
+*/
+
+
+#ifndef WIDESTEREODELAY_H
+#define WIDESTEREODELAY_H
+
+#include <QAudioFormat>
+#include <QByteArray>
+#include <QtGlobal>
+#include <QtMath>
+
+#ifdef QT_DEBUG
+    #include <QDebug>
+#endif
+
+
+// delays the right channel by a few milliseconds, changing the delay crossfades between the old and the new one
+class WideStereoDelay
+{
+    public:
+
+        explicit WideStereoDelay(QAudioFormat format, double maxDelayMillisec);
+
+        void setDelayMillisec(double delayMillisec);
+        void clear();
+        void process(char *data, int frameCount);
+
+
+    private:
+
+        static const int CHUNK_FRAMES           = 1024;
+        static const int CROSSFADE_MICROSECONDS = 20 * 1000;
+
+        QAudioFormat format;
+        int          channelCount;
+        int          sampleBytes;
+        int          bytesPerFrame;
+
+        // right channel only, whole chunks go in and out with at most two memcpy's each
+        QByteArray ring;
+        int        ringFrames;
+        int        ringPosition;
+        int        maxDelayFrames;
+
+        QByteArray rightChannel;
+        QByteArray delayed;
+        QByteArray fadingFrom;
+
+        // a change that comes during a crossfade waits for it to finish, so the next fade starts from what is heard
+        int delayFrames;
+        int pendingDelayFrames;
+        int previousDelayFrames;
+        int crossfadeFrames;
+        int crossfadeRemaining;
+
+        void startPendingDelay();
+        void ringRead(char *destination, int frameCount, int delayFrames);
+        void ringWrite(const char *source, int frameCount);
+
+        void crossfade(char *to, const char *from, int frameCount);
+        void deinterleave(const char *frames, char *right, int frameCount);
+        void interleave(const char *right, char *frames, int frameCount);
+
+        // strided copies of one channel, the type only sets the width so signedness doesn't matter here
+        template <class T> void deinterleave(const T *samples, T *right, int frameCount)
+        {
+            for (int frame = 0; frame < frameCount; frame++) {
+                right[frame] = samples[frame * channelCount + 1];
+            }
+        }
+
+        template <class T> void interleave(const T *right, T *samples, int frameCount)
+        {
+            for (int frame = 0; frame < frameCount; frame++) {
+                samples[frame * channelCount + 1] = right[frame];
+            }
+        }
+
+        template <class T> void crossfade(T *to, const T *from, int frameCount)
+        {
+            for (int frame = 0; frame < frameCount; frame++) {
+                double gain = crossfadeRemaining > 0 ? 1.0 - static_cast<double>(crossfadeRemaining) / crossfadeFrames : 1.0;
+
+                to[frame] = static_cast<T>(from[frame] + (static_cast<double>(to[frame]) - from[frame]) * gain);
+
+                if (crossfadeRemaining > 0) {
+                    crossfadeRemaining--;
+                }
+            }
+        }
+};
+
+#endif // WIDESTEREODELAY_H